@@ -6,12 +6,17 @@ IncludeDir["VulkanSDK"] = "%{VULKAN_SDK}/"
 IncludeDir["glm"] = "ext/glm"
 IncludeDir["BOOST"] = "%{BOOST_SDK}"
 
+newoption {
+    trigger = "embed-assets",
+    description = "Link assets.pak into the executable instead of loading it from next to it"
+}
+
 workspace "Calculator"
     configurations {"Debug", "Release"}
     project "Calculator"
         kind "WindowedApp"
         language "C++"
-        cppdialect "C++17"
+        cppdialect "C++20"
         targetdir "bin/"
         objdir "bin-int/%{prj.name}"
         staticruntime "off"
@@ -35,5 +40,30 @@ workspace "Calculator"
             "%{IncludeDir.VulkanSDK}/Lib/vulkan-1",
         }
 
+        -- Loaded on first use, so the software renderer fallback still starts without a Vulkan loader installed
+        filter "system:windows"
+            links { "delayimp" }
+            linkoptions { "/DELAYLOAD:vulkan-1.dll" }
+
+        -- The software renderer presents through MIT-SHM
+        filter "system:linux"
+            links { "X11", "Xext" }
+
+        filter {}
+
+        -- Fonts and icons are packed by tools/AssetPack
+        dependson { "AssetPack" }
+
+        filter "not options:embed-assets"
+            postbuildcommands { '"%{cfg.targetdir}/AssetPack" --root "%{wks.location}" -o "%{cfg.targetdir}/assets.pak"' }
+
+        filter "options:embed-assets"
+            defines { "CALCULATOR_EMBED_ASSETS" }
+            files { "bin-int/generated/AssetPackBlob.cpp" }
+            prebuildcommands { '"%{cfg.targetdir}/AssetPack" --root "%{wks.location}" --cpp "%{wks.location}/bin-int/generated/AssetPackBlob.cpp"' }
+
+        filter {}
+
 include "ext/imgui.lua"
-include "ext/glfw.lua"
\ No newline at end of file
+include "ext/glfw.lua"
+include "tools/AssetPack/AssetPack.lua"
\ No newline at end of file
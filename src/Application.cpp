@@ -7,18 +7,38 @@
 #define GLFW_INCLUDE_NONE
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 #include "Application.h"
+#include "Assets/AssetPack.h"
+#include "Assets/FontAtlasCache.h"
+#include "Assets/GlyphRanges.h"
+#include "Assets/SdfFont.h"
+#include "Core/Files.h"
+#include "Profiling/FrameProfiler.h"
+#include "Profiling/Trace.h"
+#include "Core/StartupTasks.h"
+#include "Renderer/DescriptorAllocator.h"
+#include "Renderer/FrameCapture.h"
+#include "Renderer/FramePacer.h"
+#include "Renderer/FrameScheduler.h"
+#include "Renderer/HostAllocator.h"
+#include "Renderer/OffscreenTarget.h"
+#include "Renderer/PipelineCache.h"
+#include "Renderer/RenderThread.h"
+#include "Renderer/SdfText.h"
+#include "Renderer/SoftwarePresenter.h"
+#include "Renderer/SoftwareRasterizer.h"
 
-#include "../misc/fonts/Droid.embed"
-#include "../misc/fonts/Roboto-Medium.embed"
-#include "../misc/fonts/Salsa.embed"
 #include <iostream>
+#include <time.h>
 
 #if defined(_MSC_VER) && (_MSC_VER >= 1900) && !defined(IMGUI_DISABLE_WIN32_FUNCTIONS)
 #pragma comment(lib, "legacy_stdio_definitions")
@@ -29,29 +49,130 @@
 #define IMGUI_VULKAN_DEBUG_REPORT
 #endif
 
-static VkAllocationCallbacks *g_Allocator = NULL;
+// Every Vulkan object is created through these callbacks, so the driver's host memory shows up in the profiler
+static Calculator::HostAllocator g_HostAllocator;
+static const VkAllocationCallbacks *g_Allocator = g_HostAllocator.Callbacks();
 static VkInstance g_Instance = VK_NULL_HANDLE;
+static uint32_t g_InstanceApiVersion = VK_API_VERSION_1_0; // Asked for at vkCreateInstance, caps what the device may use
 static VkPhysicalDevice g_PhysicalDevice = VK_NULL_HANDLE;
 static VkDevice g_Device = VK_NULL_HANDLE;
 static uint32_t g_QueueFamily = (uint32_t)-1;
 static VkQueue g_Queue = VK_NULL_HANDLE;
 static VkDebugReportCallbackEXT g_DebugReport = VK_NULL_HANDLE;
 static VkPipelineCache g_PipelineCache = VK_NULL_HANDLE;
+static bool g_PipelineCacheHit = false;
 static VkDescriptorPool g_DescriptorPool = VK_NULL_HANDLE;
+static constexpr uint32_t IMGUI_DESCRIPTOR_SETS = 1;
+static Calculator::DescriptorAllocator g_TextureDescriptors;
+
+// GPU timestamps around the main render pass, two queries per swapchain image
+static VkQueryPool g_TimestampQueryPool = VK_NULL_HANDLE;
+static float g_TimestampPeriod = 0.0f; // Nanoseconds per tick
+static uint64_t g_TimestampMask = 0;   // 0 when the graphics queue has no timestamp support
+static std::vector<bool> s_TimestampWritten;
 
 static ImGui_ImplVulkanH_Window g_MainWindowData;
+static bool g_TimelineSemaphores = false; // Device supports and enabled the timelineSemaphore feature
+static Calculator::FrameScheduler s_FrameScheduler;
+static VkSemaphore s_RenderCompleteSemaphore = VK_NULL_HANDLE; // Signaled by the last FrameRender, waited on by FramePresent
 static int g_MinImageCount = 2;
-static bool g_SwapChainRebuild = false;
-
-// Per-frame-in-flight
+static Calculator::OffscreenTarget s_OffscreenTarget; // Fills g_MainWindowData in headless mode
+// With the software renderer no Vulkan object exists at all, the draw data is rasterized on the CPU
+static bool s_Software = false;
+static Calculator::SoftwareRasterizer s_Rasterizer;
+static Calculator::SoftwarePresenter s_Presenter;
+static Calculator::SoftwareTexture s_FontTexture;
+static std::atomic<bool> g_SwapChainRebuild{false};
+
+// With the render thread, FrameRender/FramePresent run there while the main thread renders the platform windows
+static Calculator::RenderThread s_RenderThread;
+static std::mutex s_QueueMutex; // g_Queue must be externally synchronized
+static uint32_t s_SlowPresentMs = 0;
+
+// Per swapchain image. Only grown, a swapchain rebuild empties the inner vectors but keeps their storage.
 static std::vector<std::vector<VkCommandBuffer>> s_AllocatedCommandBuffers;
-static std::vector<std::vector<std::function<void()>>> s_ResourceFreeQueue;
+static std::vector<uint64_t> s_FrameSerials; // Submission serial the image's fence signals
 
-// Unlike g_MainWindowData.FrameIndex, this is not the the swapchain image index
-// and is always guaranteed to increase (eg. 0, 1, 2, 0, 1, 2)
-static uint32_t s_CurrentFrameIndex = 0;
+// Every vkQueueSubmit gets the next serial. Submissions on one queue complete in order, so a signaled fence means
+// every serial up to its own is done.
+static std::atomic<uint64_t> s_SubmitSerial{1}; // Serial of the submission being recorded
+static uint64_t s_CompletedSerial = 0;
+static Calculator::ResourceReleaseRing s_ReleaseRing;
+static Calculator::FrameCapture s_FrameCapture;
+static Calculator::TaskExecutor s_Tasks;
+static bool s_SwapchainCopies = false; // The swapchain images can be copied from, for s_FrameCapture
 
 static Calculator::Application *s_Instance = nullptr;
+static Calculator::FramePacer s_FramePacer;
+static Calculator::FrameProfiler s_FrameProfiler;
+
+// Printable ASCII covers the titlebar, the key labels and the profiler overlay
+static const ImWchar UI_GLYPH_RANGES[] = {0x0020, 0x007E, 0};
+static constexpr auto DISPLAY_GLYPH_RANGES = Calculator::GlyphRangesFromChars(Calculator::DISPLAY_CHARS);
+
+struct FontSource
+{
+    const char *Name;
+    const char *Asset; // Entry in the asset pack
+    float SizePixels;  // SDF fonts are always baked at SDF_FONT_SIZE
+    const ImWchar *GlyphRanges;
+    bool Sdf;
+    bool Lazy; // Added to the atlas by Application::GetFont on first use, instead of at startup
+};
+
+// In atlas order
+static const FontSource FONT_SOURCES[] = {
+    {"droid", "fonts/droid.ttf", 16.0f, UI_GLYPH_RANGES, false, true},
+    {"salsa", "fonts/salsa.ttf", 40.0f, UI_GLYPH_RANGES, false, false},
+    {"roboto", "fonts/roboto-medium.ttf", 40.0f, UI_GLYPH_RANGES, false, true},
+    {"salsa-sdf", "fonts/salsa.ttf", Calculator::SDF_FONT_SIZE, DISPLAY_GLYPH_RANGES.Data, true, false},
+};
+static_assert(IM_ARRAYSIZE(FONT_SOURCES) <= 32, "Application::m_FontSet is a 32 bit mask");
+
+// Changes whenever the set of fonts, their data, sizes or glyphs do, which invalidates the font atlas cache
+static uint64_t GetFontAtlasKey(const Calculator::AssetPack &assets, uint32_t fontSet)
+{
+    const int sdfParams[] = {(int)Calculator::SDF_FONT_SIZE, Calculator::SDF_PADDING};
+    uint64_t key = Calculator::HashBytes(sdfParams, sizeof(sdfParams));
+    for (int i = 0; i < IM_ARRAYSIZE(FONT_SOURCES); i++)
+    {
+        const FontSource &source = FONT_SOURCES[i];
+        const Calculator::AssetPackEntry *entry = assets.Find(source.Asset);
+        if ((fontSet & (1u << i)) == 0 || entry == nullptr)
+            continue;
+        key = Calculator::HashBytes(&entry->Hash, sizeof(entry->Hash), key);
+        key = Calculator::HashBytes(&source.SizePixels, sizeof(source.SizePixels), key);
+        for (const ImWchar *range = source.GlyphRanges; *range != 0; range++)
+            key = Calculator::HashBytes(range, sizeof(*range), key);
+    }
+    return key;
+}
+
+// Points config at the TTF data: in place when stored uncompressed, else decompressed into memory the atlas owns
+static bool LoadFontData(const Calculator::AssetPack &assets, const char *name, ImFontConfig &config)
+{
+    const Calculator::AssetPackEntry *entry = assets.Find(name);
+    if (entry == nullptr)
+    {
+        fprintf(stderr, "[assets] Missing %s\n", name);
+        return false;
+    }
+    config.FontDataSize = (int)entry->Size;
+    if (const uint8_t *data = assets.Map(*entry))
+    {
+        config.FontData = (void *)data;
+        config.FontDataOwnedByAtlas = false;
+        return true;
+    }
+    config.FontData = IM_ALLOC((size_t)entry->Size);
+    config.FontDataOwnedByAtlas = true;
+    if (!assets.Read(*entry, config.FontData))
+    {
+        IM_FREE(config.FontData);
+        return false;
+    }
+    return true;
+}
 
 void check_vk_result(VkResult err)
 {
@@ -76,14 +197,29 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_report(VkDebugReportFlagsEXT flags,
 }
 #endif // IMGUI_VULKAN_DEBUG_REPORT
 
-static void SetupVulkan(const char **extensions, uint32_t extensions_count)
+// Without a window there is no surface to present to, and the device is created without VK_KHR_swapchain
+static void SetupVulkan(const char **extensions, uint32_t extensions_count, bool presentation)
 {
+    PROFILE_SCOPE("SetupVulkan");
     VkResult err;
 
     // Create Vulkan Instance
     {
+        // Timeline semaphores are core in 1.2, ask for it when the loader has it
+        uint32_t api_version = VK_API_VERSION_1_0;
+        auto enumerate_instance_version = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(NULL, "vkEnumerateInstanceVersion");
+        if (enumerate_instance_version != NULL && enumerate_instance_version(&api_version) == VK_SUCCESS && api_version >= VK_API_VERSION_1_2)
+            api_version = VK_API_VERSION_1_2;
+        else
+            api_version = VK_API_VERSION_1_0;
+        VkApplicationInfo app_info = {};
+        app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        app_info.apiVersion = api_version;
+        g_InstanceApiVersion = api_version;
+
         VkInstanceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        create_info.pApplicationInfo = &app_info;
         create_info.enabledExtensionCount = extensions_count;
         create_info.ppEnabledExtensionNames = extensions;
 #ifdef IMGUI_VULKAN_DEBUG_REPORT
@@ -152,6 +288,20 @@ static void SetupVulkan(const char **extensions, uint32_t extensions_count)
 
         g_PhysicalDevice = gpus[use_gpu];
         free(gpus);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+        // vkGetPhysicalDeviceFeatures2 and the 1.2 feature structs need both the instance and the device at 1.2
+        if (g_InstanceApiVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2)
+        {
+            VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {};
+            timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+            VkPhysicalDeviceFeatures2 features = {};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &timeline_features;
+            vkGetPhysicalDeviceFeatures2(g_PhysicalDevice, &features);
+            g_TimelineSemaphores = timeline_features.timelineSemaphore == VK_TRUE;
+        }
     }
 
     // Select graphics queue family
@@ -166,13 +316,19 @@ static void SetupVulkan(const char **extensions, uint32_t extensions_count)
                 g_QueueFamily = i;
                 break;
             }
-        free(queues);
         IM_ASSERT(g_QueueFamily != (uint32_t)-1);
+
+        uint32_t valid_bits = queues[g_QueueFamily].timestampValidBits;
+        g_TimestampMask = valid_bits >= 64 ? ~0ull : ((1ull << valid_bits) - 1);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+        g_TimestampPeriod = properties.limits.timestampPeriod;
+        free(queues);
     }
 
     // Create Logical Device (with 1 queue)
     {
-        int device_extension_count = 1;
+        int device_extension_count = presentation ? 1 : 0;
         const char *device_extensions[] = {"VK_KHR_swapchain"};
         const float queue_priority[] = {1.0f};
         VkDeviceQueueCreateInfo queue_info[1] = {};
@@ -180,8 +336,12 @@ static void SetupVulkan(const char **extensions, uint32_t extensions_count)
         queue_info[0].queueFamilyIndex = g_QueueFamily;
         queue_info[0].queueCount = 1;
         queue_info[0].pQueuePriorities = queue_priority;
+        VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {};
+        timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timeline_features.timelineSemaphore = VK_TRUE;
         VkDeviceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        create_info.pNext = g_TimelineSemaphores ? &timeline_features : NULL;
         create_info.queueCreateInfoCount = sizeof(queue_info) / sizeof(queue_info[0]);
         create_info.pQueueCreateInfos = queue_info;
         create_info.enabledExtensionCount = device_extension_count;
@@ -191,36 +351,133 @@ static void SetupVulkan(const char **extensions, uint32_t extensions_count)
         vkGetDeviceQueue(g_Device, g_QueueFamily, 0, &g_Queue);
     }
 
-    // Create Descriptor Pool
+    // Create Pipeline Cache, seeded from the previous run on this device
+    g_PipelineCache = Calculator::CreatePipelineCache(g_PhysicalDevice, g_Device, g_Allocator, &g_PipelineCacheHit);
+
+    // Create Descriptor Pools. The ImGui backend allocates the font atlas set from init_info.DescriptorPool, and
+    // UploadFonts moves it into g_TextureDescriptors right after, so the backend's pool holds one set at most.
+    // Every texture set lives in g_TextureDescriptors, which grows on demand and reports its high-water mark.
     {
         VkDescriptorPoolSize pool_sizes[] =
             {
-                {VK_DESCRIPTOR_TYPE_SAMPLER, 1000},
-                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000},
-                {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000},
-                {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000},
-                {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000},
-                {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000},
-                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000},
-                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000},
-                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000},
-                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000},
-                {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000}};
+                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, IMGUI_DESCRIPTOR_SETS}};
         VkDescriptorPoolCreateInfo pool_info = {};
         pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-        pool_info.maxSets = 1000 * IM_ARRAYSIZE(pool_sizes);
+        pool_info.maxSets = IMGUI_DESCRIPTOR_SETS;
         pool_info.poolSizeCount = (uint32_t)IM_ARRAYSIZE(pool_sizes);
         pool_info.pPoolSizes = pool_sizes;
         err = vkCreateDescriptorPool(g_Device, &pool_info, g_Allocator, &g_DescriptorPool);
         check_vk_result(err);
+
+        VkDescriptorPoolSize texture_set = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+        g_TextureDescriptors.Init(g_Device, g_Allocator, &texture_set, 1, 4);
+    }
+}
+
+// The backend creates its swapchain for rendering only, so recording frames means creating it again with the same
+// parameters plus TRANSFER_SRC, and pointing the existing frames at the new images. Nothing has been submitted to
+// the swapchain the backend just created. Should the new one come with a different number of images, the backend's
+// is restored and frames are not recorded.
+static bool AddSwapchainTransferSource(ImGui_ImplVulkanH_Window *wd)
+{
+    PROFILE_SCOPE("AddSwapchainTransferSource");
+    VkSurfaceCapabilitiesKHR caps;
+    VkResult err = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(g_PhysicalDevice, wd->Surface, &caps);
+    check_vk_result(err);
+    if ((caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0)
+    {
+        fprintf(stderr, "[capture] The surface does not allow copying from its images, frames are not recorded\n");
+        return false;
+    }
+
+    VkSwapchainCreateInfoKHR info = {};
+    info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    info.surface = wd->Surface;
+    info.minImageCount = std::max<uint32_t>(g_MinImageCount, caps.minImageCount);
+    if (caps.maxImageCount != 0)
+        info.minImageCount = std::min(info.minImageCount, caps.maxImageCount);
+    info.imageFormat = wd->SurfaceFormat.format;
+    info.imageColorSpace = wd->SurfaceFormat.colorSpace;
+    info.imageExtent.width = wd->Width;
+    info.imageExtent.height = wd->Height;
+    info.imageArrayLayers = 1;
+    info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    info.presentMode = wd->PresentMode;
+    info.clipped = VK_TRUE;
+    info.oldSwapchain = wd->Swapchain;
+    VkSwapchainKHR swapchain;
+    err = vkCreateSwapchainKHR(g_Device, &info, g_Allocator, &swapchain);
+    check_vk_result(err);
+
+    uint32_t image_count = 0;
+    err = vkGetSwapchainImagesKHR(g_Device, swapchain, &image_count, nullptr);
+    check_vk_result(err);
+    if (image_count != wd->ImageCount)
+    {
+        // The old swapchain is retired and can no longer be used, the backend builds everything again from scratch
+        vkDestroySwapchainKHR(g_Device, swapchain, g_Allocator);
+        for (uint32_t i = 0; i < wd->ImageCount; i++)
+        {
+            vkDestroyFramebuffer(g_Device, wd->Frames[i].Framebuffer, g_Allocator);
+            vkDestroyImageView(g_Device, wd->Frames[i].BackbufferView, g_Allocator);
+            wd->Frames[i].Framebuffer = VK_NULL_HANDLE;
+            wd->Frames[i].BackbufferView = VK_NULL_HANDLE;
+        }
+        vkDestroySwapchainKHR(g_Device, wd->Swapchain, g_Allocator);
+        wd->Swapchain = VK_NULL_HANDLE;
+        ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_PhysicalDevice, g_Device, wd, g_QueueFamily, g_Allocator, wd->Width, wd->Height, g_MinImageCount);
+        fprintf(stderr, "[capture] Could not recreate the swapchain with %u images, frames are not recorded\n", wd->ImageCount);
+        return false;
+    }
+    std::vector<VkImage> images(image_count);
+    err = vkGetSwapchainImagesKHR(g_Device, swapchain, &image_count, images.data());
+    check_vk_result(err);
+
+    for (uint32_t i = 0; i < image_count; i++)
+    {
+        ImGui_ImplVulkanH_Frame *fd = &wd->Frames[i];
+        vkDestroyFramebuffer(g_Device, fd->Framebuffer, g_Allocator);
+        vkDestroyImageView(g_Device, fd->BackbufferView, g_Allocator);
+        fd->Backbuffer = images[i];
+
+        VkImageViewCreateInfo view_info = {};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = wd->SurfaceFormat.format;
+        view_info.components.r = VK_COMPONENT_SWIZZLE_R;
+        view_info.components.g = VK_COMPONENT_SWIZZLE_G;
+        view_info.components.b = VK_COMPONENT_SWIZZLE_B;
+        view_info.components.a = VK_COMPONENT_SWIZZLE_A;
+        view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        view_info.image = fd->Backbuffer;
+        err = vkCreateImageView(g_Device, &view_info, g_Allocator, &fd->BackbufferView);
+        check_vk_result(err);
+
+        VkFramebufferCreateInfo framebuffer_info = {};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = wd->RenderPass;
+        framebuffer_info.attachmentCount = 1;
+        framebuffer_info.pAttachments = &fd->BackbufferView;
+        framebuffer_info.width = wd->Width;
+        framebuffer_info.height = wd->Height;
+        framebuffer_info.layers = 1;
+        err = vkCreateFramebuffer(g_Device, &framebuffer_info, g_Allocator, &fd->Framebuffer);
+        check_vk_result(err);
     }
+    vkDestroySwapchainKHR(g_Device, wd->Swapchain, g_Allocator);
+    wd->Swapchain = swapchain;
+    return true;
 }
 
 // All the ImGui_ImplVulkanH_XXX structures/functions are optional helpers used by the demo.
 // Your real engine/app may not use them.
-static void SetupVulkanWindow(ImGui_ImplVulkanH_Window *wd, VkSurfaceKHR surface, int width, int height)
+static void SetupVulkanWindow(ImGui_ImplVulkanH_Window *wd, VkSurfaceKHR surface, int width, int height, VkPresentModeKHR present_mode)
 {
+    PROFILE_SCOPE("SetupVulkanWindow");
     wd->Surface = surface;
 
     // Check for WSI support
@@ -237,23 +494,49 @@ static void SetupVulkanWindow(ImGui_ImplVulkanH_Window *wd, VkSurfaceKHR surface
     const VkColorSpaceKHR requestSurfaceColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
     wd->SurfaceFormat = ImGui_ImplVulkanH_SelectSurfaceFormat(g_PhysicalDevice, wd->Surface, requestSurfaceImageFormat, (size_t)IM_ARRAYSIZE(requestSurfaceImageFormat), requestSurfaceColorSpace);
 
-    // Select Present Mode
+    // Select Present Mode, the requested one first
 #ifdef IMGUI_UNLIMITED_FRAME_RATE
-    VkPresentModeKHR present_modes[] = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR};
+    VkPresentModeKHR present_modes[] = {present_mode, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR};
 #else
-    VkPresentModeKHR present_modes[] = {VK_PRESENT_MODE_FIFO_KHR};
+    VkPresentModeKHR present_modes[] = {present_mode, VK_PRESENT_MODE_FIFO_KHR};
 #endif
     wd->PresentMode = ImGui_ImplVulkanH_SelectPresentMode(g_PhysicalDevice, wd->Surface, &present_modes[0], IM_ARRAYSIZE(present_modes));
-    // printf("[vulkan] Selected PresentMode = %d\n", wd->PresentMode);
+    if (wd->PresentMode != present_mode)
+        fprintf(stderr, "[vulkan] PresentMode %d not supported, using %d\n", present_mode, wd->PresentMode);
 
     // Create SwapChain, RenderPass, Framebuffer, etc.
     IM_ASSERT(g_MinImageCount >= 2);
     ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_PhysicalDevice, g_Device, wd, g_QueueFamily, g_Allocator, width, height, g_MinImageCount);
+    if (s_FrameCapture.IsActive())
+        s_SwapchainCopies = AddSwapchainTransferSource(wd);
+}
+
+// Called again whenever the swapchain is recreated, as the image count may change
+static void CreateTimestampQueries(uint32_t image_count)
+{
+    if (g_TimestampMask == 0)
+        return;
+    if (g_TimestampQueryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(g_Device, g_TimestampQueryPool, g_Allocator);
+
+    VkQueryPoolCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = image_count * 2;
+    VkResult err = vkCreateQueryPool(g_Device, &info, g_Allocator, &g_TimestampQueryPool);
+    check_vk_result(err);
+    s_TimestampWritten.assign(image_count, false);
 }
 
 static void CleanupVulkan()
 {
+    Calculator::SavePipelineCache(g_PhysicalDevice, g_Device, g_PipelineCache);
+    vkDestroyPipelineCache(g_Device, g_PipelineCache, g_Allocator);
+    if (g_TimestampQueryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(g_Device, g_TimestampQueryPool, g_Allocator);
     vkDestroyDescriptorPool(g_Device, g_DescriptorPool, g_Allocator);
+    g_TextureDescriptors.Destroy();
+    s_FrameScheduler.Destroy();
 
 #ifdef IMGUI_VULKAN_DEBUG_REPORT
     // Remove the debug report callback
@@ -267,57 +550,141 @@ static void CleanupVulkan()
 
 static void CleanupVulkanWindow()
 {
-    ImGui_ImplVulkanH_DestroyWindow(g_Instance, g_Device, &g_MainWindowData, g_Allocator);
+    if (g_MainWindowData.Swapchain == VK_NULL_HANDLE)
+        s_OffscreenTarget.Destroy();
+    else
+        ImGui_ImplVulkanH_DestroyWindow(g_Instance, g_Device, &g_MainWindowData, g_Allocator);
+}
+
+// Valid once the slot's last frame has completed
+static bool ReadGpuTime(uint32_t slot, float *ms)
+{
+    if (g_TimestampQueryPool == VK_NULL_HANDLE || !s_TimestampWritten[slot])
+        return false;
+    uint64_t timestamps[2];
+    VkResult err = vkGetQueryPoolResults(g_Device, g_TimestampQueryPool, slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (err != VK_SUCCESS)
+        return false;
+    *ms = (float)(((timestamps[1] - timestamps[0]) & g_TimestampMask) * g_TimestampPeriod / 1.0e6);
+    return true;
 }
 
-static void FrameRender(ImGui_ImplVulkanH_Window *wd, ImDrawData *draw_data)
+// Without waiting. The timeline's counter is read every frame already, with fences only the current image's has been
+// waited for, so the others are asked whether their submission has completed too.
+static uint64_t PollCompletedSerial(ImGui_ImplVulkanH_Window *wd)
+{
+    uint64_t completed = s_CompletedSerial;
+    if (s_FrameScheduler.IsEnabled())
+        return completed;
+    for (uint32_t i = 0; i < wd->ImageCount; i++)
+        if (s_FrameSerials[i] > completed && vkGetFenceStatus(g_Device, wd->Frames[i].Fence) == VK_SUCCESS)
+            completed = s_FrameSerials[i];
+    return completed;
+}
+
+// With the frame scheduler, per-frame state is indexed by its frame slot, otherwise by the swapchain image index.
+// Runs on the render thread when there is one, so everything measured goes to timings rather than the profiler.
+// Headless, wd holds the images of an OffscreenTarget: they are used in turn, with nothing to acquire or present.
+static void FrameRender(ImGui_ImplVulkanH_Window *wd, ImDrawData *draw_data, Calculator::FrameTimings *timings)
 {
     VkResult err;
-    VkSemaphore image_acquired_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
-    VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
-    err = vkAcquireNextImageKHR(g_Device, wd->Swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE, &wd->FrameIndex);
-    if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
+    bool timeline = s_FrameScheduler.IsEnabled();
+    bool offscreen = wd->Swapchain == VK_NULL_HANDLE;
+    Calculator::FrameScheduler::Frame *frame = nullptr;
+    VkSemaphore image_acquired_semaphore = VK_NULL_HANDLE;
+    if (s_FramePacer.IsEnabled())
+        s_FramePacer.BeginSwapchainWait();
+    if (timeline)
     {
-        g_SwapChainRebuild = true;
-        return;
+        // Wait for the slot before acquiring, its acquire semaphore is only free once its last submission has run
+        PROFILE_SCOPE("vkWaitSemaphores");
+        uint64_t wait_ns;
+        frame = &s_FrameScheduler.BeginFrame(&wait_ns);
+        timings->GpuWaitMs += (float)(wait_ns / 1.0e6);
+        image_acquired_semaphore = frame->ImageAcquired;
+    }
+    else if (!offscreen)
+        image_acquired_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
+    if (offscreen)
+        wd->FrameIndex = timeline ? frame->Index % wd->ImageCount : (wd->FrameIndex + 1) % wd->ImageCount;
+    else
+    {
+        {
+            PROFILE_SCOPE("vkAcquireNextImageKHR");
+            err = vkAcquireNextImageKHR(g_Device, wd->Swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE, &wd->FrameIndex);
+        }
+        if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
+        {
+            g_SwapChainRebuild = true;
+            return;
+        }
+        check_vk_result(err);
     }
-    check_vk_result(err);
-
-    s_CurrentFrameIndex = (s_CurrentFrameIndex + 1) % g_MainWindowData.ImageCount;
 
     ImGui_ImplVulkanH_Frame *fd = &wd->Frames[wd->FrameIndex];
+    uint32_t slot;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    if (timeline)
     {
+        if (s_FramePacer.IsEnabled())
+            s_FramePacer.EndSwapchainWait();
+        slot = frame->Index;
+        command_pool = frame->CommandPool;
+        command_buffer = frame->CommandBuffer;
+        s_RenderCompleteSemaphore = offscreen ? VK_NULL_HANDLE : s_FrameScheduler.GetRenderComplete(wd->FrameIndex);
+        s_CompletedSerial = std::max(s_CompletedSerial, s_FrameScheduler.GetCompletedSerial());
+    }
+    else
+    {
+        PROFILE_SCOPE("vkWaitForFences");
+        uint64_t wait_start = InputClockNow();
         err = vkWaitForFences(g_Device, 1, &fd->Fence, VK_TRUE, UINT64_MAX); // wait indefinitely instead of periodically checking
         check_vk_result(err);
+        timings->GpuWaitMs += (float)((InputClockNow() - wait_start) / 1.0e6);
 
         err = vkResetFences(g_Device, 1, &fd->Fence);
         check_vk_result(err);
+        if (s_FramePacer.IsEnabled())
+            s_FramePacer.EndSwapchainWait();
+        slot = wd->FrameIndex;
+        command_pool = fd->CommandPool;
+        command_buffer = fd->CommandBuffer;
+        s_RenderCompleteSemaphore = offscreen ? VK_NULL_HANDLE : wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
+        s_CompletedSerial = std::max(s_CompletedSerial, s_FrameSerials[slot]);
     }
 
+    // The wait guarantees the previous use of this slot's queries has completed
+    ReadGpuTime(slot, &timings->GpuMs);
+
     {
-        // Free resources in queue
-        for (auto &func : s_ResourceFreeQueue[s_CurrentFrameIndex])
-            func();
-        s_ResourceFreeQueue[s_CurrentFrameIndex].clear();
+        // Free resources whose last use has completed
+        s_ReleaseRing.Collect(s_CompletedSerial);
     }
+    if (s_FrameCapture.IsActive())
+        s_FrameCapture.Poll(PollCompletedSerial(wd));
     {
-        // Free command buffers allocated by Application::GetCommandBuffer
-        // These use g_MainWindowData.FrameIndex and not s_CurrentFrameIndex because they're tied to the swapchain image index
-        auto &allocatedCommandBuffers = s_AllocatedCommandBuffers[wd->FrameIndex];
+        // Free command buffers allocated for this slot
+        auto &allocatedCommandBuffers = s_AllocatedCommandBuffers[slot];
         if (allocatedCommandBuffers.size() > 0)
         {
-            vkFreeCommandBuffers(g_Device, fd->CommandPool, (uint32_t)allocatedCommandBuffers.size(), allocatedCommandBuffers.data());
+            vkFreeCommandBuffers(g_Device, command_pool, (uint32_t)allocatedCommandBuffers.size(), allocatedCommandBuffers.data());
             allocatedCommandBuffers.clear();
         }
 
-        err = vkResetCommandPool(g_Device, fd->CommandPool, 0);
+        err = vkResetCommandPool(g_Device, command_pool, 0);
         check_vk_result(err);
         VkCommandBufferBeginInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        err = vkBeginCommandBuffer(fd->CommandBuffer, &info);
+        err = vkBeginCommandBuffer(command_buffer, &info);
         check_vk_result(err);
     }
+    if (g_TimestampQueryPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(command_buffer, g_TimestampQueryPool, slot * 2, 2);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, g_TimestampQueryPool, slot * 2);
+    }
     {
         VkRenderPassBeginInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -327,39 +694,88 @@ static void FrameRender(ImGui_ImplVulkanH_Window *wd, ImDrawData *draw_data)
         info.renderArea.extent.height = wd->Height;
         info.clearValueCount = 1;
         info.pClearValues = &wd->ClearValue;
-        vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer, &info, VK_SUBPASS_CONTENTS_INLINE);
     }
 
     // Record dear imgui primitives into command buffer
     if (draw_data != nullptr)
-        ImGui_ImplVulkan_RenderDrawData(draw_data, fd->CommandBuffer);
+    {
+        PROFILE_SCOPE("ImGui_ImplVulkan_RenderDrawData");
+        Calculator::SetSdfTextCommandBuffer(command_buffer);
+        ImGui_ImplVulkan_RenderDrawData(draw_data, command_buffer);
+        Calculator::SetSdfTextCommandBuffer(VK_NULL_HANDLE);
+    }
 
     // Submit command buffer
-    vkCmdEndRenderPass(fd->CommandBuffer);
+    vkCmdEndRenderPass(command_buffer);
+    if (g_TimestampQueryPool != VK_NULL_HANDLE)
     {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, g_TimestampQueryPool, slot * 2 + 1);
+        s_TimestampWritten[slot] = true;
+    }
+    if (s_FrameCapture.IsActive() && (offscreen || s_SwapchainCopies))
+    {
+        // The offscreen render pass leaves its image in TRANSFER_SRC, a swapchain image is in PRESENT_SRC
+        VkImageLayout layout = offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        s_FrameCapture.RecordCopy(command_buffer, fd->Backbuffer, layout, wd->SurfaceFormat.format, wd->Width, wd->Height, s_SubmitSerial.load());
+    }
+    {
+        PROFILE_SCOPE("vkQueueSubmit");
+        uint64_t serial = s_SubmitSerial.load();
         VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        // Offscreen nothing waits for the render to complete, so only the timeline is signaled
+        VkSemaphore signal_semaphores[2];
+        uint64_t signal_values[2];
+        uint32_t signal_count = 0;
+        if (!offscreen)
+        {
+            signal_semaphores[signal_count] = s_RenderCompleteSemaphore;
+            signal_values[signal_count++] = 0;
+        }
+        if (timeline)
+        {
+            signal_semaphores[signal_count] = s_FrameScheduler.GetTimeline();
+            signal_values[signal_count++] = serial;
+        }
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.signalSemaphoreValueCount = signal_count;
+        timeline_info.pSignalSemaphoreValues = signal_values;
         VkSubmitInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        info.waitSemaphoreCount = 1;
+        info.pNext = timeline ? &timeline_info : nullptr;
+        info.waitSemaphoreCount = offscreen ? 0 : 1;
         info.pWaitSemaphores = &image_acquired_semaphore;
         info.pWaitDstStageMask = &wait_stage;
         info.commandBufferCount = 1;
-        info.pCommandBuffers = &fd->CommandBuffer;
-        info.signalSemaphoreCount = 1;
-        info.pSignalSemaphores = &render_complete_semaphore;
+        info.pCommandBuffers = &command_buffer;
+        info.signalSemaphoreCount = signal_count;
+        info.pSignalSemaphores = signal_semaphores;
 
-        err = vkEndCommandBuffer(fd->CommandBuffer);
+        err = vkEndCommandBuffer(command_buffer);
         check_vk_result(err);
-        err = vkQueueSubmit(g_Queue, 1, &info, fd->Fence);
+        {
+            std::lock_guard<std::mutex> lock(s_QueueMutex);
+            err = vkQueueSubmit(g_Queue, 1, &info, timeline ? VK_NULL_HANDLE : fd->Fence);
+        }
         check_vk_result(err);
+        timings->SubmitTime = InputClockNow();
+        s_SubmitSerial.store(serial + 1);
+        if (timeline)
+            frame->Serial = serial;
+        else
+            s_FrameSerials[slot] = serial;
     }
 }
 
-static void FramePresent(ImGui_ImplVulkanH_Window *wd)
+static void FramePresent(ImGui_ImplVulkanH_Window *wd, Calculator::FrameTimings *timings)
 {
     if (g_SwapChainRebuild)
         return;
-    VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
+    // Stress mode standing in for a compositor or driver that blocks in vkQueuePresentKHR
+    if (s_SlowPresentMs > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(s_SlowPresentMs));
+    VkSemaphore render_complete_semaphore = s_RenderCompleteSemaphore;
     VkPresentInfoKHR info = {};
     info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     info.waitSemaphoreCount = 1;
@@ -367,16 +783,57 @@ static void FramePresent(ImGui_ImplVulkanH_Window *wd)
     info.swapchainCount = 1;
     info.pSwapchains = &wd->Swapchain;
     info.pImageIndices = &wd->FrameIndex;
-    VkResult err = vkQueuePresentKHR(g_Queue, &info);
+    PROFILE_SCOPE("vkQueuePresentKHR");
+    VkResult err;
+    {
+        std::lock_guard<std::mutex> lock(s_QueueMutex);
+        err = vkQueuePresentKHR(g_Queue, &info);
+    }
     if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
     {
         g_SwapChainRebuild = true;
         return;
     }
     check_vk_result(err);
+    timings->PresentTime = InputClockNow();
     wd->SemaphoreIndex = (wd->SemaphoreIndex + 1) % wd->ImageCount; // Now we can use the next set of semaphores
 }
 
+// Skips frames while the main thread has a swapchain rebuild pending, it pauses this thread for the rebuild
+static void RenderThreadFrame(Calculator::RenderFrame &frame)
+{
+    PROFILE_SCOPE("RenderThreadFrame");
+    // The main thread may be waiting for this frame to be taken before it builds the next one
+    glfwPostEmptyEvent();
+    if (g_SwapChainRebuild)
+        return;
+    uint64_t start = InputClockNow();
+    FrameRender(&g_MainWindowData, frame.DrawData.Get(), &frame.Timings);
+    uint64_t rendered = InputClockNow();
+    FramePresent(&g_MainWindowData, &frame.Timings);
+    frame.Timings.FrameRenderMs = (float)((rendered - start) / 1.0e6);
+    frame.Timings.FramePresentMs = (float)((InputClockNow() - rendered) / 1.0e6);
+}
+
+// Per-frame state is indexed by frame slot with the frame scheduler and by swapchain image without it
+static uint32_t GetFrameSlotCount()
+{
+    return s_FrameScheduler.IsEnabled() ? std::max(s_FrameScheduler.GetFramesInFlight(), g_MainWindowData.ImageCount) : g_MainWindowData.ImageCount;
+}
+
+// The new frames have not been submitted yet, and the device was idled before they were created, so everything
+// released so far is safe to free. The command pools that held the old command buffers are gone.
+static void ResizeFrameTracking(uint32_t imageCount)
+{
+    for (auto &buffers : s_AllocatedCommandBuffers)
+        buffers.clear();
+    if (s_AllocatedCommandBuffers.size() < imageCount)
+        s_AllocatedCommandBuffers.resize(imageCount);
+    s_FrameSerials.assign(std::max<size_t>(s_FrameSerials.size(), imageCount), 0);
+    s_CompletedSerial = s_SubmitSerial.load() - 1;
+    s_ReleaseRing.Collect(s_CompletedSerial);
+}
+
 static void glfw_error_callback(int error, const char *description)
 {
     fprintf(stderr, "Glfw Error %d: %s\n", error, description);
@@ -385,13 +842,150 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
     if (width > 0 && height > 0)
     {
+        s_RenderThread.Pause();
         ImGui_ImplVulkan_SetMinImageCount(g_MinImageCount);
         ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_PhysicalDevice, g_Device, &g_MainWindowData, g_QueueFamily, g_Allocator, width, height, g_MinImageCount);
+        if (s_FrameCapture.IsActive())
+            s_SwapchainCopies = AddSwapchainTransferSource(&g_MainWindowData);
         g_MainWindowData.FrameIndex = 0;
-        s_AllocatedCommandBuffers.clear();
-        s_AllocatedCommandBuffers.resize(g_MainWindowData.ImageCount);
+        s_FrameScheduler.OnSwapchainCreated(g_MainWindowData.ImageCount);
+        ResizeFrameTracking(GetFrameSlotCount());
+        CreateTimestampQueries(GetFrameSlotCount());
         g_SwapChainRebuild = false;
+        s_RenderThread.Resume();
+    }
+}
+
+// Only the keys the calculator reacts to are translated, everything else becomes ImGuiKey_None.
+// Main-row keys typed with a modifier are left to the char callback (eg. Shift+8 types '*')
+static ImGuiKey glfw_key_to_imgui_key(int key, int mods)
+{
+    if (mods & (GLFW_MOD_CONTROL | GLFW_MOD_ALT | GLFW_MOD_SUPER))
+        return ImGuiKey_None;
+    if (key >= GLFW_KEY_KP_0 && key <= GLFW_KEY_KP_9)
+        return (ImGuiKey)(ImGuiKey_Keypad0 + (key - GLFW_KEY_KP_0));
+
+    switch (key)
+    {
+    case GLFW_KEY_KP_DECIMAL: return ImGuiKey_KeypadDecimal;
+    case GLFW_KEY_KP_DIVIDE: return ImGuiKey_KeypadDivide;
+    case GLFW_KEY_KP_MULTIPLY: return ImGuiKey_KeypadMultiply;
+    case GLFW_KEY_KP_SUBTRACT: return ImGuiKey_KeypadSubtract;
+    case GLFW_KEY_KP_ADD: return ImGuiKey_KeypadAdd;
+    case GLFW_KEY_KP_ENTER: return ImGuiKey_KeypadEnter;
+    case GLFW_KEY_BACKSPACE: return ImGuiKey_Backspace;
+    case GLFW_KEY_ESCAPE: return ImGuiKey_Escape;
     }
+
+    if (mods & GLFW_MOD_SHIFT)
+        return ImGuiKey_None;
+    if (key >= GLFW_KEY_0 && key <= GLFW_KEY_9)
+        return (ImGuiKey)(ImGuiKey_0 + (key - GLFW_KEY_0));
+    if (key == GLFW_KEY_PERIOD)
+        return ImGuiKey_Period;
+    return ImGuiKey_None;
+}
+
+// Uploads the atlas ImGui's IO points at. Waits for the device, so only call outside of a frame.
+static void UploadFonts(ImGui_ImplVulkanH_Window *wd)
+{
+    // Use any command queue
+    VkCommandPool command_pool = wd->Frames[wd->FrameIndex].CommandPool;
+    VkCommandBuffer command_buffer = wd->Frames[wd->FrameIndex].CommandBuffer;
+
+    VkResult err = vkResetCommandPool(g_Device, command_pool, 0);
+    check_vk_result(err);
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    err = vkBeginCommandBuffer(command_buffer, &begin_info);
+    check_vk_result(err);
+
+    Calculator::ReleaseImGuiFontsTexture(g_TextureDescriptors);
+    ImGui_ImplVulkan_CreateFontsTexture();
+    Calculator::AdoptImGuiFontsTexture(g_TextureDescriptors);
+
+    VkSubmitInfo end_info = {};
+    end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    end_info.commandBufferCount = 1;
+    end_info.pCommandBuffers = &command_buffer;
+    err = vkEndCommandBuffer(command_buffer);
+    check_vk_result(err);
+    err = vkQueueSubmit(g_Queue, 1, &end_info, VK_NULL_HANDLE);
+    check_vk_result(err);
+
+    err = vkDeviceWaitIdle(g_Device);
+    check_vk_result(err);
+}
+
+static void UploadFontsSoftware(ImFontAtlas *atlas)
+{
+    unsigned char *pixels;
+    int width, height;
+    atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+    s_FontTexture.SetRGBA32(pixels, width, height);
+    atlas->SetTexID(s_FontTexture.GetTexID());
+}
+
+// Rasterizes the main viewport into the presenter's framebuffer, which follows the draw data's size
+static void RenderSoftware(ImDrawData *draw_data, const VkClearValue &clear)
+{
+    int width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+    int height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+    Calculator::SoftwareFramebuffer target = s_Presenter.Acquire(width, height);
+    if (target.Pixels == nullptr)
+        return;
+    auto channel = [&clear](int i)
+    { return (uint32_t)(std::min(std::max(clear.color.float32[i], 0.0f), 1.0f) * 255.0f + 0.5f); };
+    s_Rasterizer.Render(draw_data, target, channel(2) | channel(1) << 8 | channel(0) << 16 | channel(3) << 24);
+}
+
+// The last software frame as tightly packed RGBA8 rows
+static bool ReadbackSoftware(std::vector<uint8_t> &pixels)
+{
+    const Calculator::SoftwareFramebuffer &fb = s_Presenter.GetFramebuffer();
+    if (fb.Pixels == nullptr)
+        return false;
+    pixels.resize((size_t)fb.Width * fb.Height * 4);
+    uint8_t *out = pixels.data();
+    for (int y = 0; y < fb.Height; y++)
+    {
+        for (const uint32_t *p = fb.Pixels + (size_t)y * fb.Stride, *end = p + fb.Width; p < end; p++, out += 4)
+        {
+            out[0] = (uint8_t)(*p >> 16);
+            out[1] = (uint8_t)(*p >> 8);
+            out[2] = (uint8_t)*p;
+            out[3] = (uint8_t)(*p >> 24);
+        }
+    }
+    return true;
+}
+
+// Nearest rank percentiles of a whole run, samples is sorted in place
+static void PrintFrameTimes(FILE *out, const char *name, std::vector<float> &samples)
+{
+    if (samples.empty())
+    {
+        fprintf(out, "[headless] %-8s no samples\n", name);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](float p)
+    { return samples[std::min(samples.size() - 1, (size_t)(p * (samples.size() - 1) + 0.5f))]; };
+    fprintf(out, "[headless] %-8s p50 %7.3f ms  p90 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+            name, percentile(0.5f), percentile(0.9f), percentile(0.99f), samples.back());
+}
+
+// Binary PPM, which about every image viewer opens and which needs no encoder
+static bool WritePpm(const char *path, const std::vector<uint8_t> &rgba, int width, int height)
+{
+    char header[32];
+    int header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> data(header, header + header_size);
+    data.reserve(data.size() + (size_t)width * height * 3);
+    for (size_t i = 0; i + 4 <= rgba.size(); i += 4)
+        data.insert(data.end(), rgba.begin() + i, rgba.begin() + i + 3);
+    return Calculator::WriteFileAtomic(path, data.data(), data.size());
 }
 
 namespace Calculator
@@ -406,59 +1000,199 @@ namespace Calculator
 
     void Application::Init()
     {
-        // Setup GLFW window
-        glfwSetErrorCallback(glfw_error_callback);
-        if (!glfwInit())
+        TraceSetThreadName("Main");
+        PROFILE_SCOPE("Application::Init");
+        m_InitStart = TraceClockNow();
+        // Headless there is no GLFW at all, so it runs without a display or a GPU (eg. on lavapipe)
+        const bool headless = m_Specification.HeadlessFrames > 0;
+        s_Software = m_Specification.SoftwareRenderer;
+
+        // Setup GLFW
+        uint32_t extensions_count = 0;
+        const char **extensions = nullptr;
+        if (!headless)
         {
-            std::cerr << "Could not initalize GLFW!\n";
-            return;
+            glfwSetErrorCallback(glfw_error_callback);
+            if (!glfwInit())
+            {
+                std::cerr << "Could not initalize GLFW!\n";
+                return;
+            }
+            if (!s_Software && !glfwVulkanSupported())
+            {
+                fprintf(stderr, "[startup] Vulkan is not available, falling back to the software renderer\n");
+                s_Software = true;
+            }
+            if (!s_Software)
+                extensions = glfwGetRequiredInstanceExtensions(&extensions_count);
+        }
+        if (s_Software && m_Specification.RenderThread)
+        {
+            fprintf(stderr, "[startup] --render-thread has no effect with the software renderer\n");
+            m_Specification.RenderThread = false;
         }
 
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        // glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-        glfwWindowHint(GLFW_TITLEBAR, GLFW_FALSE);
-        m_Window = glfwCreateWindow(m_Specification.Width, m_Specification.Height, m_Specification.Name.c_str(), nullptr, NULL);
+        // Steps that do not need the window run on workers while the main thread creates it.
+        // GLFW window calls stay on the main thread. The font atlas is built standalone and only handed to
+        // ImGui::CreateContext once finished, so no ImGui context exists while two threads use ImGui's allocator.
+        g_HostAllocator.SetLimit((uint64_t)m_Specification.HostMemoryLimitMiB * 1024 * 1024);
+        s_Tasks.Start(0);
+        StartupTasks tasks;
+        StartupTasks::TaskId vulkanTask = tasks.Async(
+            "SetupVulkan", {},
+            [extensions, extensions_count, headless]()
+            {
+                if (!s_Software)
+                    SetupVulkan(extensions, extensions_count, !headless);
+            });
 
-        // Setup Vulkan
-        if (!glfwVulkanSupported())
         {
-            std::cerr << "GLFW: Vulkan not supported!\n";
-            return;
+            StartupTasks::Step step(tasks, "Open asset pack");
+            m_Assets.OpenDefault();
         }
-        uint32_t extensions_count = 0;
-        const char **extensions = glfwGetRequiredInstanceExtensions(&extensions_count);
-        SetupVulkan(extensions, extensions_count);
-        glfwSetFramebufferSizeCallback(m_Window, framebuffer_size_callback);
-        // Create Window Surface
-        VkSurfaceKHR surface;
-        VkResult err = glfwCreateWindowSurface(g_Instance, m_Window, g_Allocator, &surface);
-        check_vk_result(err);
 
+        GLFWimage icon = {};
+        std::vector<uint8_t> iconPixels;
+        StartupTasks::TaskId iconTask = tasks.Async(
+            "Read window icon", {},
+            [this, &icon, &iconPixels]()
+            {
+                const AssetPackEntry *entry = m_Assets.Find("icons/app");
+                if (entry == nullptr || entry->Kind != AssetKind::ImageRGBA8)
+                    return;
+                iconPixels.resize(entry->Size);
+                if (!m_Assets.Read(*entry, iconPixels.data()))
+                    return;
+                icon.width = (int)entry->Width;
+                icon.height = (int)entry->Height;
+                icon.pixels = iconPixels.data();
+            });
+
+        StartupTasks::TaskId fontTask = tasks.Async(
+            "Build font atlas", {},
+            [this]()
+            {
+                m_FontAtlas = IM_NEW(ImFontAtlas)();
+                m_FontSet = 0;
+                for (int i = 0; i < IM_ARRAYSIZE(FONT_SOURCES); i++)
+                    if (!FONT_SOURCES[i].Lazy)
+                        m_FontSet |= 1u << i;
+                buildFonts(true);
+            });
+
+        if (headless)
         {
-            GLFWimage image;
-            image.pixels = stbi_load("../images/calc.png", &image.width, &image.height, 0, 4);
-            glfwSetWindowIcon(m_Window, 1, &image);
-            stbi_image_free(image.pixels);
+            if (m_Specification.RenderThread)
+                fprintf(stderr, "[startup] --render-thread has no effect with --headless\n");
+        }
+        else
+        {
+            StartupTasks::Step step(tasks, "Create window");
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+            // glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+            glfwWindowHint(GLFW_TITLEBAR, GLFW_FALSE);
+            m_Window = glfwCreateWindow(m_Specification.Width, m_Specification.Height, m_Specification.Name.c_str(), nullptr, NULL);
+
+            const GLFWvidmode *video_mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+            // The pacer times the swapchain waits, which the render thread does on its own schedule
+            if (m_Specification.LowLatency && (m_Specification.RenderThread || s_Software))
+                fprintf(stderr, "[startup] --low-latency has no effect with --render-thread or the software renderer\n");
+            s_FramePacer.Configure(m_Specification.LowLatency && !m_Specification.RenderThread && !s_Software, video_mode ? video_mode->refreshRate : 60);
         }
 
-        // Create Framebuffers
-        int w, h;
-        glfwGetFramebufferSize(m_Window, &w, &h);
+        tasks.Wait(vulkanTask);
+        VkResult err;
         ImGui_ImplVulkanH_Window *wd = &g_MainWindowData;
-        SetupVulkanWindow(wd, surface, w, h);
+        // Before the swapchain is created, which is then created so its images can be copied
+        if (!m_Specification.RecordPath.empty())
+        {
+            if (s_Software)
+                fprintf(stderr, "[capture] --record needs the Vulkan renderer\n");
+            else if (!s_FrameCapture.Start(m_Specification.RecordPath.c_str(), g_PhysicalDevice, g_Device, g_Allocator))
+                fprintf(stderr, "[capture] Could not create %s\n", m_Specification.RecordPath.c_str());
+        }
+        if (s_Software)
+        {
+            StartupTasks::Step step(tasks, "Create software renderer");
+            s_Rasterizer.Init(m_Specification.SoftwareThreads);
+            if (!s_Presenter.Init(m_Window))
+            {
+                fprintf(stderr, "[software] Could not present to the window\n");
+                exit(-1);
+            }
+        }
+        else if (headless)
+        {
+            StartupTasks::Step step(tasks, "Create offscreen target");
+            // One image per frame in flight, so an image is never rendered to while an earlier frame still uses it
+            uint32_t image_count = std::max(std::min(m_Specification.FramesInFlight, FrameScheduler::MAX_FRAMES_IN_FLIGHT), 2u);
+            if (!s_OffscreenTarget.Create(wd, g_PhysicalDevice, g_Device, g_QueueFamily, g_Allocator, m_Specification.Width, m_Specification.Height, image_count))
+            {
+                fprintf(stderr, "[headless] Could not create a %dx%d offscreen target\n", m_Specification.Width, m_Specification.Height);
+                exit(-1);
+            }
+        }
+        else
+        {
+            StartupTasks::Step step(tasks, "Create surface and swapchain");
+            glfwSetFramebufferSizeCallback(m_Window, framebuffer_size_callback);
+            // Create Window Surface
+            VkSurfaceKHR surface;
+            err = glfwCreateWindowSurface(g_Instance, m_Window, g_Allocator, &surface);
+            check_vk_result(err);
+
+            // Create Framebuffers
+            int w, h;
+            glfwGetFramebufferSize(m_Window, &w, &h);
+            SetupVulkanWindow(wd, surface, w, h, m_Specification.PresentMode);
+        }
+        if (!s_Software)
+        {
+            StartupTasks::Step step(tasks, "Create frame resources");
+            if (g_TimelineSemaphores && m_Specification.FramesInFlight > 0)
+                s_FrameScheduler.Init(g_Device, g_QueueFamily, g_Allocator, m_Specification.FramesInFlight);
+            if (!headless)
+                s_FrameScheduler.OnSwapchainCreated(wd->ImageCount);
+            ResizeFrameTracking(GetFrameSlotCount());
+            CreateTimestampQueries(GetFrameSlotCount());
+        }
+        m_ShowProfiler = m_Specification.ShowProfiler;
+        if (!m_Specification.InputLogPath.empty() && !m_InputLog.Open(m_Specification.InputLogPath.c_str()))
+            fprintf(stderr, "[input] Could not create %s\n", m_Specification.InputLogPath.c_str());
+        if (!m_Specification.ReplayPath.empty() && !m_InputReplay.Open(m_Specification.ReplayPath.c_str(), m_Specification.ReplayUnthrottled))
+            fprintf(stderr, "[replay] %s is not a session log\n", m_Specification.ReplayPath.c_str());
+        // A result arriving a frame later than it did when recording would show up as a mismatch
+        m_Calculator.SetSynchronousEvaluation(m_InputReplay.IsOpen());
+        m_Calculator.SetReportPastes(m_Specification.StartupTiming);
+        m_Calculator.SetTasks(&s_Tasks);
+
+        tasks.Wait(iconTask);
+        if (icon.pixels && m_Window != nullptr)
+        {
+            StartupTasks::Step step(tasks, "Set window icon");
+            glfwSetWindowIcon(m_Window, 1, &icon);
+        }
 
-        s_AllocatedCommandBuffers.resize(wd->ImageCount);
-        s_ResourceFreeQueue.resize(wd->ImageCount);
+        tasks.Wait(fontTask);
+        StartupTasks::Step imguiStep(tasks, "Setup ImGui");
 
         // Setup Dear ImGui context
         IMGUI_CHECKVERSION();
-        ImGui::CreateContext();
+        ImGui::CreateContext(m_FontAtlas);
         ImGuiIO &io = ImGui::GetIO();
         (void)io;
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard; // Enable Keyboard Controls
         // io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
         io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;   // Enable Docking
-        io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable; // Enable Multi-Viewport / Platform Windows
+        // The software renderer only draws the main viewport
+        if (!headless && !s_Software)
+            io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable; // Enable Multi-Viewport / Platform Windows
+        if (headless)
+        {
+            // No platform backend sets these, and a benchmark run must not depend on or change imgui.ini
+            io.DisplaySize = ImVec2((float)m_Specification.Width, (float)m_Specification.Height);
+            io.IniFilename = nullptr;
+        }
         // io.ConfigViewportsNoAutoMerge = true;
         // io.ConfigViewportsNoTaskBarIcon = true;
 
@@ -474,66 +1208,275 @@ namespace Calculator
             style.Colors[ImGuiCol_WindowBg].w = 1.0f;
         }
 
-        glfwSetTitlebarHitTestCallback(
-            m_Window,
-            [](GLFWwindow *window, int x, int y, int *hit)
-            { *hit = m_TitleBarHovered; });
-
-        // Setup Platform/Renderer backends
-        ImGui_ImplGlfw_InitForVulkan(m_Window, true);
-        ImGui_ImplVulkan_InitInfo init_info = {};
-        init_info.Instance = g_Instance;
-        init_info.PhysicalDevice = g_PhysicalDevice;
-        init_info.Device = g_Device;
-        init_info.QueueFamily = g_QueueFamily;
-        init_info.Queue = g_Queue;
-        init_info.PipelineCache = g_PipelineCache;
-        init_info.DescriptorPool = g_DescriptorPool;
-        init_info.Subpass = 0;
-        init_info.MinImageCount = g_MinImageCount;
-        init_info.ImageCount = wd->ImageCount;
-        init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
-        init_info.Allocator = g_Allocator;
-        init_info.CheckVkResultFn = check_vk_result;
-        ImGui_ImplVulkan_Init(&init_info, wd->RenderPass);
-
-        io.Fonts->AddFontDefault();
-        m_FontMap["droid"] = io.Fonts->AddFontFromMemoryCompressedTTF((void *)Droid_compressed_data, sizeof(Droid_compressed_data), 16.0f, NULL);
-        m_FontMap["salsa"] = io.Fonts->AddFontFromMemoryCompressedTTF((void *)SalsaFont_compressed_data, sizeof(SalsaFont_compressed_data), 40.0f, NULL);
-        m_FontMap["roboto"] = io.Fonts->AddFontFromMemoryCompressedTTF((void *)g_RobotoMedium_compressed_data, sizeof(g_RobotoMedium_compressed_data), 40.0f, NULL);
-        io.FontDefault = m_FontMap["salsa"];
-
-        // Upload Fonts
-        {
-            // Use any command queue
-            VkCommandPool command_pool = wd->Frames[wd->FrameIndex].CommandPool;
-            VkCommandBuffer command_buffer = wd->Frames[wd->FrameIndex].CommandBuffer;
-
-            err = vkResetCommandPool(g_Device, command_pool, 0);
-            check_vk_result(err);
-            VkCommandBufferBeginInfo begin_info = {};
-            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-            err = vkBeginCommandBuffer(command_buffer, &begin_info);
-            check_vk_result(err);
+        if (!headless)
+        {
+            glfwSetTitlebarHitTestCallback(
+                m_Window,
+                [](GLFWwindow *window, int x, int y, int *hit)
+                { *hit = m_TitleBarHovered; });
+
+            // Calculator input is queued from the GLFW callbacks so nothing typed between two frames is lost.
+            // These must be installed before the ImGui backend, which chains to them.
+            glfwSetKeyCallback(
+                m_Window,
+                [](GLFWwindow *window, int key, int scancode, int action, int mods)
+                {
+                    InputEvent event = {InputEventType::Key};
+                    event.Down = action != GLFW_RELEASE;
+                    event.Key = glfw_key_to_imgui_key(key, mods);
+                    event.Timestamp = InputClockNow();
+                    s_Instance->m_InputQueue.Push(event);
+                    if (key == GLFW_KEY_V && action == GLFW_PRESS && (mods & (GLFW_MOD_CONTROL | GLFW_MOD_SUPER)))
+                    {
+                        // Copied right away, GLFW keeps the text only until the clipboard is read again
+                        const char *text = glfwGetClipboardString(window);
+                        if (text != nullptr)
+                            s_Instance->m_InputQueue.PushPaste(text, event.Timestamp);
+                    }
+                });
+            glfwSetCharCallback(
+                m_Window,
+                [](GLFWwindow *window, unsigned int c)
+                {
+                    InputEvent event = {InputEventType::Char};
+                    event.Char = c;
+                    event.Timestamp = InputClockNow();
+                    s_Instance->m_InputQueue.Push(event);
+                });
+            glfwSetMouseButtonCallback(
+                m_Window,
+                [](GLFWwindow *window, int button, int action, int mods)
+                {
+                    double x, y;
+                    glfwGetCursorPos(window, &x, &y);
+                    InputEvent event = {InputEventType::MouseButton};
+                    event.Down = action == GLFW_PRESS;
+                    event.Button = button;
+                    event.MousePos = ImVec2((float)x, (float)y);
+                    event.Timestamp = InputClockNow();
+                    s_Instance->m_InputQueue.Push(event);
+                });
+            glfwSetCursorPosCallback(
+                m_Window,
+                [](GLFWwindow *window, double x, double y)
+                {
+                    InputEvent event = {InputEventType::MouseMove};
+                    event.MousePos = ImVec2((float)x, (float)y);
+                    event.Timestamp = InputClockNow();
+                    s_Instance->m_InputQueue.Push(event);
+                });
+            glfwSetCursorEnterCallback(
+                m_Window,
+                [](GLFWwindow *window, int entered)
+                {
+                    if (entered)
+                        return;
+                    InputEvent event = {InputEventType::MouseMove};
+                    event.MousePos = ImVec2(-FLT_MAX, -FLT_MAX);
+                    event.Timestamp = InputClockNow();
+                    s_Instance->m_InputQueue.Push(event);
+                });
+
+            // Setup Platform/Renderer backends
+            if (s_Software)
+                ImGui_ImplGlfw_InitForOther(m_Window, true);
+            else
+                ImGui_ImplGlfw_InitForVulkan(m_Window, true);
+        }
+        if (s_Software)
+        {
+            io.BackendRendererName = "software";
+            io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+        }
+        else
+        {
+            ImGui_ImplVulkan_InitInfo init_info = {};
+            init_info.Instance = g_Instance;
+            init_info.PhysicalDevice = g_PhysicalDevice;
+            init_info.Device = g_Device;
+            init_info.QueueFamily = g_QueueFamily;
+            init_info.Queue = g_Queue;
+            init_info.PipelineCache = g_PipelineCache;
+            init_info.DescriptorPool = g_DescriptorPool;
+            init_info.Subpass = 0;
+            init_info.MinImageCount = g_MinImageCount;
+            init_info.ImageCount = GetFrameSlotCount(); // The backend rotates this many vertex buffers, one per frame in flight
+            init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+            init_info.Allocator = g_Allocator;
+            init_info.CheckVkResultFn = check_vk_result;
+            ImGui_ImplVulkan_Init(&init_info, wd->RenderPass);
+            if (!CreateSdfTextPipeline(wd->RenderPass))
+                fprintf(stderr, "[vulkan] SDF text pipeline unavailable, using the bitmap font\n");
+        }
+        applyFonts();
+        imguiStep.End();
 
-            ImGui_ImplVulkan_CreateFontsTexture();
+        {
+            StartupTasks::Step step(tasks, "Upload fonts");
+            if (s_Software)
+                UploadFontsSoftware(m_FontAtlas);
+            else
+                UploadFonts(wd);
+        }
 
-            VkSubmitInfo end_info = {};
-            end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-            end_info.commandBufferCount = 1;
-            end_info.pCommandBuffers = &command_buffer;
-            err = vkEndCommandBuffer(command_buffer);
-            check_vk_result(err);
-            err = vkQueueSubmit(g_Queue, 1, &end_info, VK_NULL_HANDLE);
-            check_vk_result(err);
+        tasks.WaitAll();
+        if (m_Specification.StartupTiming)
+        {
+            tasks.PrintTimings(stdout);
+            printFontStats(stdout);
+            if (s_Software)
+                printf("[software] %u raster threads, presenting through %s\n", s_Rasterizer.GetThreadCount(), s_Presenter.GetMethod());
+            else if (s_FrameScheduler.IsEnabled())
+                printf("[vulkan] timeline semaphore frame scheduling, %u frames in flight\n", s_FrameScheduler.GetFramesInFlight());
+            else
+                printf("[vulkan] fence frame scheduling, one frame in flight per swapchain image (%u)\n", g_MainWindowData.ImageCount);
+        }
+    }
 
-            err = vkDeviceWaitIdle(g_Device);
-            check_vk_result(err);
-            //            ImGui_ImplVulkan_DestroyFontUploadObjects();
+    // Fonts are built from the sources in m_FontSet, through the font atlas cache of that set.
+    // Runs on a startup thread before the ImGui context exists, or between frames when a lazy font is added.
+    void Application::buildFonts(bool useCache)
+    {
+        PROFILE_SCOPE("Application::buildFonts");
+        if (!useCache || !loadCachedFonts())
+        {
+            uint64_t key = GetFontAtlasKey(m_Assets, m_FontSet);
+            m_FontMap.clear();
+            SdfFontBuilder sdf;
+            bool complete = true;
+            for (int i = 0; i < IM_ARRAYSIZE(FONT_SOURCES); i++)
+            {
+                const FontSource &source = FONT_SOURCES[i];
+                if ((m_FontSet & (1u << i)) == 0)
+                    continue;
+                ImFontConfig config;
+                config.SizePixels = source.SizePixels;
+                config.GlyphRanges = source.GlyphRanges;
+                snprintf(config.Name, sizeof(config.Name), "%s, %.0fpx", source.Name, source.SizePixels);
+                if (!LoadFontData(m_Assets, source.Asset, config))
+                {
+                    complete = false;
+                    continue;
+                }
+                m_FontMap[source.Name] = source.Sdf ? sdf.AddFont(m_FontAtlas, config) : m_FontAtlas->AddFont(&config);
+            }
+            // Without the asset pack everything falls back to ImGui's built-in font
+            if (m_FontAtlas->Fonts.empty())
+                m_FontAtlas->AddFontDefault();
+            m_FontAtlas->Build();
+            sdf.Finish(m_FontAtlas);
+            if (useCache && complete)
+                SaveFontAtlasCache(m_FontAtlas, m_FontSet, key);
+        }
+
+        // Convert now, ImGui_ImplVulkan_CreateFontsTexture then only uploads
+        unsigned char *pixels;
+        int width, height;
+        m_FontAtlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+    }
+
+    // Restores the atlas of the fonts in m_FontSet into the empty atlas, false if no cache was written for them
+    bool Application::loadCachedFonts()
+    {
+        if (!LoadFontAtlasCache(m_FontAtlas, m_FontSet, GetFontAtlasKey(m_Assets, m_FontSet)))
+            return false;
+        m_FontMap.clear();
+        int font = 0;
+        for (int i = 0; i < IM_ARRAYSIZE(FONT_SOURCES); i++)
+            if (m_FontSet & (1u << i))
+                m_FontMap[FONT_SOURCES[i].Name] = m_FontAtlas->Fonts[font++];
+        unsigned char *pixels;
+        int width, height;
+        m_FontAtlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+        return true;
+    }
+
+    void Application::applyFonts()
+    {
+        auto salsa = m_FontMap.find("salsa");
+        ImGui::GetIO().FontDefault = salsa != m_FontMap.end() ? salsa->second : nullptr;
+        auto sdf = m_FontMap.find("salsa-sdf");
+        if (IsSdfTextAvailable() && sdf != m_FontMap.end())
+            m_Calculator.SetDisplayFont(sdf->second, true);
+        else
+            m_Calculator.SetDisplayFont(nullptr, false);
+    }
+
+    // The atlas is rebuilt from scratch, a restored cache has no font data to add to. m_FontSet already has the
+    // requested lazy fonts, and the atlas of that set is cached on its own, so launches still start with the
+    // startup fonts and only the first reload of a set pays for rasterizing it.
+    void Application::reloadFonts()
+    {
+        PROFILE_SCOPE("Application::reloadFonts");
+        uint64_t start = InputClockNow();
+        m_FontReload = false;
+        s_RenderThread.Pause();
+        if (!s_Software)
+        {
+            check_vk_result(vkDeviceWaitIdle(g_Device));
+            ReleaseImGuiFontsTexture(g_TextureDescriptors);
+            ImGui_ImplVulkan_DestroyFontsTexture();
+        }
+        m_FontAtlas->Clear();
+        buildFonts(true);
+        applyFonts();
+        if (s_Software)
+            UploadFontsSoftware(m_FontAtlas);
+        else
+            UploadFonts(&g_MainWindowData);
+        s_RenderThread.Resume();
+        if (m_Specification.StartupTiming)
+        {
+            printf("[fonts] rebuilt with the lazy fonts in %.1f ms\n", (InputClockNow() - start) / 1.0e6);
+            printFontStats(stdout);
         }
     }
 
+    void Application::printFontStats(FILE *out) const
+    {
+        int glyphs = 0;
+        for (const ImFont *font : m_FontAtlas->Fonts)
+            glyphs += font->Glyphs.Size;
+        fprintf(out, "[fonts] %d fonts, %d glyphs, atlas %dx%d (%d KiB as RGBA32)\n",
+                m_FontAtlas->Fonts.Size, glyphs, m_FontAtlas->TexWidth, m_FontAtlas->TexHeight,
+                m_FontAtlas->TexWidth * m_FontAtlas->TexHeight * 4 / 1024);
+    }
+
+    ResourceReleaseRing &Application::getReleaseRing()
+    {
+        return s_ReleaseRing;
+    }
+
+    // The serial of the last frame a resource used right now can be in. With the render thread that is two ahead of
+    // the submission being recorded: the frame waiting in its mailbox and the one the main thread is building. A
+    // frame is one submission, and a frame dropped from the mailbox only makes the release later than needed.
+    uint64_t Application::getSubmitSerial()
+    {
+        uint64_t serial = s_SubmitSerial.load(std::memory_order_acquire);
+        return s_RenderThread.IsRunning() ? serial + 2 : serial;
+    }
+
+    TaskExecutor &Application::GetTasks()
+    {
+        return s_Tasks;
+    }
+
+    ImFont *Application::GetFont(const std::string &name)
+    {
+        auto it = m_FontMap.find(name);
+        if (it != m_FontMap.end())
+            return it->second;
+        for (int i = 0; i < IM_ARRAYSIZE(FONT_SOURCES); i++)
+        {
+            if (name == FONT_SOURCES[i].Name && (m_FontSet & (1u << i)) == 0)
+            {
+                m_FontSet |= 1u << i;
+                m_FontReload = true;
+            }
+        }
+        return ImGui::GetIO().FontDefault;
+    }
+
     void Application::Run()
     {
         m_Running = true;
@@ -541,83 +1484,376 @@ namespace Calculator
         ImGui_ImplVulkanH_Window *wd = &g_MainWindowData;
         ImGuiIO &io = ImGui::GetIO();
         ImVec4 clear_color = ImVec4(32 / 255.0, 32 / 255.0, 33 / 255.0, 1.00f);
+        wd->ClearValue.color.float32[0] = clear_color.x * clear_color.w;
+        wd->ClearValue.color.float32[1] = clear_color.y * clear_color.w;
+        wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
+        wd->ClearValue.color.float32[3] = clear_color.w;
+        if (m_Specification.HeadlessFrames > 0)
+        {
+            runHeadless();
+            return;
+        }
+        double lastLatencyReport = glfwGetTime();
+        bool firstFrame = true;
+        s_SlowPresentMs = m_Specification.SlowPresentMs;
+        if (m_Specification.RenderThread)
+            s_RenderThread.Start(RenderThreadFrame);
         // Main loop
         while (!glfwWindowShouldClose(m_Window) && m_Running)
         {
-            glfwPollEvents();
+            s_FramePacer.BeginFrame();
+            PROFILE_SCOPE("Frame");
+            if (m_FontReload)
+                reloadFonts();
+            s_FrameProfiler.BeginFrame();
+            {
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_PollEvents);
+                // Rather than spinning ahead of the render thread, sleep until it takes the last frame or input arrives
+                if (s_RenderThread.IsRunning() && s_RenderThread.HasPendingFrame())
+                    glfwWaitEventsTimeout(0.1);
+                else
+                    glfwPollEvents();
+            }
+            {
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_Continuations);
+                s_Tasks.RunMainThread();
+            }
 
-            ImGui_ImplVulkan_NewFrame();
-            ImGui_ImplGlfw_NewFrame();
-            ImGui::NewFrame();
             {
-                ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoDocking;
-
-                ImGuiViewport *viewport = ImGui::GetMainViewport();
-                ImGui::SetNextWindowPos(viewport->Pos);
-                ImGui::SetNextWindowSize(viewport->Size);
-                ImGui::SetNextWindowViewport(viewport->ID);
-                ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 2.0f);
-                ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 0.0f);
-                window_flags |= ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove;
-                window_flags |= ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoNavFocus | ImGuiWindowFlags_NoBackground;
-                ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, glfwGetWindowAttrib(m_Window, GLFW_MAXIMIZED) ? ImVec2(6.0f, 6.0f) : ImVec2(1.0f, 1.0f));
-                ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 0.0f);
-
-                ImGui::PushStyleColor(ImGuiCol_MenuBarBg, ImVec4{0.0f, 0.0f, 0.0f, 0.0f});
-                ImGui::Begin("DockSpaceWindow", nullptr, window_flags);
-                ImGui::PopStyleColor(); // MenuBarBg
-                ImGui::PopStyleVar(2);
-
-                ImGui::PopStyleVar(2);
-
-                float height;
-                UI_DrawTitlebar(height);
-                ImGui::SetCursorPosY(height);
-
-                ImGuiStyle &style = ImGui::GetStyle();
-                float minWinSizeX = style.WindowMinSize.x;
-                style.WindowMinSize.x = 370.0f;
-                ImGui::DockSpace(ImGui::GetID("MyDockspace"));
-                style.WindowMinSize.x = minWinSizeX;
-
-                RenderLayer();
-                ImGui::End();
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_NewFrame);
+                if (!s_Software)
+                    ImGui_ImplVulkan_NewFrame();
+                ImGui_ImplGlfw_NewFrame();
+                ImGui::NewFrame();
+            }
+            if (ImGui::IsKeyPressed(ImGuiKey_F3, false))
+                m_ShowProfiler = !m_ShowProfiler;
+            if (ImGui::IsKeyPressed(ImGuiKey_F12, false))
+            {
+                char path[64];
+                snprintf(path, sizeof(path), "calculator-trace-%lld.json", (long long)time(nullptr));
+                TraceWriteChromeJson(path);
             }
+            drawUI();
 
             // Rendering
-            ImGui::Render();
+            {
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_Render);
+                ImGui::Render();
+            }
             ImDrawData *main_draw_data = ImGui::GetDrawData();
             const bool main_is_minimized = (main_draw_data->DisplaySize.x <= 0.0f || main_draw_data->DisplaySize.y <= 0.0f);
-            wd->ClearValue.color.float32[0] = clear_color.x * clear_color.w;
-            wd->ClearValue.color.float32[1] = clear_color.y * clear_color.w;
-            wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
-            wd->ClearValue.color.float32[3] = clear_color.w;
 
-            if (!main_is_minimized)
-                FrameRender(wd, main_draw_data);
+            FrameTimings timings;
+            if (s_RenderThread.IsRunning())
+            {
+                if (!main_is_minimized)
+                {
+                    FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_Render);
+                    RenderFrame &frame = s_RenderThread.Back();
+                    frame.DrawData.CopyFrom(main_draw_data);
+                    m_Latency.MovePending(frame.Inputs);
+                    onFrameReturned(s_RenderThread.Publish());
+                }
+            }
+            else if (!main_is_minimized)
+            {
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_FrameRender);
+                if (s_Software)
+                    RenderSoftware(main_draw_data, wd->ClearValue);
+                else
+                    FrameRender(wd, main_draw_data, &timings);
+            }
+            if (!s_RenderThread.IsRunning() && !main_is_minimized && !g_SwapChainRebuild)
+                m_Latency.OnSubmit();
 
             if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
             {
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_PlatformWindows);
+                // Creating or resizing a platform window idles the device, which needs every queue
+                std::lock_guard<std::mutex> lock(s_QueueMutex);
                 ImGui::UpdatePlatformWindows();
                 ImGui::RenderPlatformWindowsDefault();
             }
-            if (!main_is_minimized)
-                FramePresent(wd);
+            if (!s_RenderThread.IsRunning() && !main_is_minimized)
+            {
+                FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_FramePresent);
+                if (s_Software)
+                    s_Presenter.Present();
+                else
+                    FramePresent(wd, &timings);
+                if (!g_SwapChainRebuild)
+                    m_Latency.OnPresent();
+            }
+            if (!s_RenderThread.IsRunning())
+            {
+                s_FrameProfiler.AddStageTime(FrameStage_GpuWait, timings.GpuWaitMs);
+                if (timings.GpuMs >= 0.0f)
+                    s_FrameProfiler.AddGpuTime(timings.GpuMs);
+            }
+            if (firstFrame && m_Specification.StartupTiming)
+            {
+                if (!s_Software)
+                    printf("[startup] pipeline cache %s\n", g_PipelineCacheHit ? "hit" : "miss");
+                printf("[startup] first frame presented after %.1f ms\n", (TraceClockNow() - m_InitStart) / 1.0e6);
+            }
+            firstFrame = false;
+            s_FrameProfiler.EndFrame();
+
+            if (m_Specification.ReportLatency && glfwGetTime() - lastLatencyReport > 5.0)
+            {
+                m_Latency.Report(stdout);
+                lastLatencyReport = glfwGetTime();
+            }
         }
+
+        s_RenderThread.Stop();
+        if (m_Specification.ReportLatency)
+            m_Latency.Report(stdout);
+        if (!m_Specification.TracePath.empty())
+            TraceWriteChromeJson(m_Specification.TracePath.c_str());
+    }
+
+    // Renders HeadlessFrames frames into the offscreen target as fast as the GPU takes them, with the scripted input
+    // typed one character per frame, then prints the frame time percentiles.
+    // With the software renderer the frames go to the presenter's memory, and the raster times replace the GPU's.
+    void Application::runHeadless()
+    {
+        ImGui_ImplVulkanH_Window *wd = &g_MainWindowData;
+        const std::string &script = m_Specification.HeadlessInput;
+        uint32_t frames = m_Specification.HeadlessFrames;
+        std::vector<float> cpuMs, gpuWaitMs, gpuMs, setupMs, rasterMs;
+        cpuMs.reserve(frames);
+        gpuWaitMs.reserve(frames);
+        gpuMs.reserve(frames);
+        setupMs.reserve(s_Software ? frames : 0);
+        rasterMs.reserve(s_Software ? frames : 0);
+
+        uint64_t start = InputClockNow();
+        for (uint32_t i = 0; i < frames && m_Running; i++)
+        {
+            PROFILE_SCOPE("Frame");
+            uint64_t frameStart = InputClockNow();
+            if (m_FontReload)
+                reloadFonts();
+            s_FrameProfiler.BeginFrame();
+            if (!script.empty())
+            {
+                InputEvent event = {InputEventType::Char};
+                event.Char = (unsigned char)script[i % script.size()];
+                event.Timestamp = frameStart;
+                m_InputQueue.Push(event);
+            }
+            s_Tasks.RunMainThread();
+
+            if (!s_Software)
+                ImGui_ImplVulkan_NewFrame();
+            ImGui::NewFrame();
+            drawUI();
+            ImGui::Render();
+
+            FrameTimings timings;
+            if (s_Software)
+            {
+                RenderSoftware(ImGui::GetDrawData(), wd->ClearValue);
+                setupMs.push_back(s_Rasterizer.GetStats().SetupMs);
+                rasterMs.push_back(s_Rasterizer.GetStats().RasterMs);
+            }
+            else
+                FrameRender(wd, ImGui::GetDrawData(), &timings);
+            // Nothing is presented, a frame is done once submitted
+            m_Latency.OnSubmit();
+            m_Latency.OnPresent();
+            cpuMs.push_back((float)((InputClockNow() - frameStart) / 1.0e6));
+            gpuWaitMs.push_back(timings.GpuWaitMs);
+            if (timings.GpuMs >= 0.0f)
+                gpuMs.push_back(timings.GpuMs);
+            // With --profiler the overlay shows up in the capture
+            s_FrameProfiler.AddStageTime(FrameStage_GpuWait, timings.GpuWaitMs);
+            if (timings.GpuMs >= 0.0f)
+                s_FrameProfiler.AddGpuTime(timings.GpuMs);
+            s_FrameProfiler.EndFrame();
+        }
+        if (!s_Software)
+            check_vk_result(vkDeviceWaitIdle(g_Device));
+        double seconds = (InputClockNow() - start) / 1.0e9;
+        const int width = m_Specification.Width, height = m_Specification.Height;
+        if (s_Software)
+        {
+            const SoftwareRasterizerStats &stats = s_Rasterizer.GetStats();
+            printf("[headless] %zu frames at %dx%d on the software renderer in %.2f s (%.1f frames/s)\n",
+                   cpuMs.size(), width, height, seconds, cpuMs.size() / seconds);
+            printf("[headless] %u raster threads, last frame %u triangles in %u tile bins of %u tiles\n",
+                   stats.Threads, stats.Triangles, stats.TileRefs, stats.Tiles);
+            PrintFrameTimes(stdout, "cpu", cpuMs);
+            PrintFrameTimes(stdout, "setup", setupMs);
+            PrintFrameTimes(stdout, "raster", rasterMs); // Summed over the threads
+        }
+        else
+        {
+            // FrameRender reads a slot's timestamps when it reuses the slot, so the last frame of each is still unread
+            for (uint32_t slot = 0; slot < GetFrameSlotCount(); slot++)
+            {
+                float ms;
+                if (ReadGpuTime(slot, &ms))
+                    gpuMs.push_back(ms);
+            }
+
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+            printf("[headless] %zu frames at %dx%d on %s in %.2f s (%.1f frames/s)\n",
+                   cpuMs.size(), width, height, properties.deviceName, seconds, cpuMs.size() / seconds);
+            if (s_FrameScheduler.IsEnabled())
+                printf("[headless] timeline semaphore frame scheduling, %u frames in flight\n", s_FrameScheduler.GetFramesInFlight());
+            else
+                printf("[headless] fence frame scheduling, %u images\n", wd->ImageCount);
+            PrintFrameTimes(stdout, "cpu", cpuMs);
+            PrintFrameTimes(stdout, "gpu wait", gpuWaitMs);
+            PrintFrameTimes(stdout, "gpu", gpuMs);
+        }
+
+        const std::string &capture = m_Specification.CapturePath;
+        if (!capture.empty() && !cpuMs.empty())
+        {
+            std::vector<uint8_t> pixels;
+            bool read = s_Software ? ReadbackSoftware(pixels) : s_OffscreenTarget.Readback(g_Queue, wd->FrameIndex, pixels);
+            if (read && WritePpm(capture.c_str(), pixels, width, height))
+                printf("[headless] last frame written to %s\n", capture.c_str());
+            else
+                fprintf(stderr, "[headless] Could not write %s\n", capture.c_str());
+        }
+        if (m_Specification.ReportLatency)
+            m_Latency.Report(stdout);
+        if (!m_Specification.TracePath.empty())
+            TraceWriteChromeJson(m_Specification.TracePath.c_str());
+    }
+
+    // The main window's contents, between ImGui::NewFrame and ImGui::Render
+    void Application::drawUI()
+    {
+        ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoDocking;
+
+        ImGuiViewport *viewport = ImGui::GetMainViewport();
+        ImGui::SetNextWindowPos(viewport->Pos);
+        ImGui::SetNextWindowSize(viewport->Size);
+        ImGui::SetNextWindowViewport(viewport->ID);
+        ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 2.0f);
+        ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 0.0f);
+        window_flags |= ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove;
+        window_flags |= ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoNavFocus | ImGuiWindowFlags_NoBackground;
+        ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, isMaximized() ? ImVec2(6.0f, 6.0f) : ImVec2(1.0f, 1.0f));
+        ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 0.0f);
+
+        ImGui::PushStyleColor(ImGuiCol_MenuBarBg, ImVec4{0.0f, 0.0f, 0.0f, 0.0f});
+        ImGui::Begin("DockSpaceWindow", nullptr, window_flags);
+        ImGui::PopStyleColor(); // MenuBarBg
+        ImGui::PopStyleVar(2);
+
+        ImGui::PopStyleVar(2);
+
+        float height;
+        {
+            FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_Titlebar);
+            UI_DrawTitlebar(height);
+        }
+        ImGui::SetCursorPosY(height);
+
+        ImGuiStyle &style = ImGui::GetStyle();
+        float minWinSizeX = style.WindowMinSize.x;
+        style.WindowMinSize.x = 370.0f;
+        ImGui::DockSpace(ImGui::GetID("MyDockspace"));
+        style.WindowMinSize.x = minWinSizeX;
+
+        {
+            FrameProfiler::Scope scope(s_FrameProfiler, FrameStage_RenderLayer);
+            RenderLayer();
+        }
+        if (m_ShowProfiler)
+        {
+            ImGui::PushFont(GetFont("droid"));
+            s_FrameProfiler.DrawOverlay(&m_ShowProfiler, &m_Latency, &g_HostAllocator);
+            ImGui::PopFont();
+        }
+        ImGui::End();
+    }
+
+    // A frame comes back from the render thread a couple of frames after it was published
+    void Application::onFrameReturned(RenderFrame &frame)
+    {
+        if (frame.Status == RenderFrame::State::Rendered)
+        {
+            const FrameTimings &timings = frame.Timings;
+            s_FrameProfiler.AddStageTime(FrameStage_GpuWait, timings.GpuWaitMs);
+            if (timings.GpuMs >= 0.0f)
+                s_FrameProfiler.AddGpuTime(timings.GpuMs);
+            s_FrameProfiler.AddStageTime(FrameStage_FrameRender, timings.FrameRenderMs);
+            s_FrameProfiler.AddStageTime(FrameStage_FramePresent, timings.FramePresentMs);
+            if (timings.PresentTime != 0)
+                m_Latency.OnPresented(frame.Inputs, timings.SubmitTime, timings.PresentTime);
+            else
+                m_Latency.RestorePending(frame.Inputs);
+        }
+        else if (frame.Status == RenderFrame::State::Pending)
+            m_Latency.RestorePending(frame.Inputs);
+        frame.Inputs.clear();
+        frame.Timings = FrameTimings();
+        frame.Status = RenderFrame::State::Empty;
     }
 
     void Application::Destroy()
     {
-        m_Err = vkDeviceWaitIdle(g_Device);
-        check_vk_result(m_Err);
-        ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplGlfw_Shutdown();
+        s_RenderThread.Stop();
+        // A paste still parsing would hold Stop up until it finished
+        m_Calculator.CancelEvaluation();
+        s_Tasks.Stop();
+        if (m_InputLog.IsOpen())
+        {
+            m_InputLog.Close();
+            m_InputLog.Report(stdout);
+        }
+        if (m_InputReplay.IsOpen())
+            m_InputReplay.Report(stdout);
+        if (s_Software)
+        {
+            s_Presenter.Shutdown();
+            s_Rasterizer.Shutdown();
+        }
+        else
+        {
+            m_Err = vkDeviceWaitIdle(g_Device);
+            check_vk_result(m_Err);
+            s_ReleaseRing.Collect(UINT64_MAX);
+            if (s_FrameCapture.IsActive())
+            {
+                s_FrameCapture.Stop();
+                s_FrameCapture.Report(stdout);
+            }
+            if (m_Specification.StartupTiming)
+            {
+                printf("[descriptors] imgui backend: fixed pool of %u set, for the font atlas until it is adopted\n", IMGUI_DESCRIPTOR_SETS);
+                g_TextureDescriptors.Report(stdout, "textures");
+                g_HostAllocator.Report(stdout);
+            }
+            DestroySdfTextPipeline();
+            ReleaseImGuiFontsTexture(g_TextureDescriptors);
+            ImGui_ImplVulkan_Shutdown();
+        }
+        if (m_Window != nullptr)
+            ImGui_ImplGlfw_Shutdown();
         // ImGui::DestroyContext();
+        IM_DELETE(m_FontAtlas);
+        m_FontAtlas = nullptr;
 
-        CleanupVulkanWindow();
-        CleanupVulkan();
-        glfwDestroyWindow(m_Window);
-        glfwTerminate();
+        if (!s_Software)
+        {
+            CleanupVulkanWindow();
+            CleanupVulkan();
+        }
+        if (m_Window != nullptr)
+        {
+            glfwDestroyWindow(m_Window);
+            glfwTerminate();
+        }
     }
 
     Application::~Application()
@@ -628,7 +1864,7 @@ namespace Calculator
     void Application::UI_DrawTitlebar(float &outTitlebarHeight)
     {
         const float titlebarHeight = 50.0f;
-        const bool isMaximized = glfwGetWindowAttrib(m_Window, GLFW_MAXIMIZED);
+        const bool isMaximized = this->isMaximized();
         float titlebarVerticalOffset = isMaximized ? -6.0f : 0.0f;
         const ImVec2 windowPadding = ImGui::GetCurrentWindow()->WindowPadding;
 
@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <unordered_map>
 #include <string>
 #include <GLFW/glfw3.h>
@@ -5,14 +6,41 @@
 #include "imgui.h"
 #include <vector>
 #include "Calculator/Calculator.cpp"
+#include "Calculator/InputLog.h"
+#include "Assets/AssetPack.h"
+#include "Core/Tasks.h"
+#include "Profiling/LatencyTracker.h"
+#include "Renderer/DeferredRelease.h"
+#include "Renderer/RenderThread.h"
 
 namespace Calculator
 {
+    using ResourceReleaseRing = DeferredReleaseRing<1024>;
+
     struct ApplicationSpec
     {
         int Width = 1280;
         int Height = 720;
         std::string Name = "Calculator";
+        VkPresentModeKHR PresentMode = VK_PRESENT_MODE_FIFO_KHR; // Falls back to FIFO when unsupported
+        bool LowLatency = false;    // Delay frame start to just before the vblank, see FramePacer
+        bool ReportLatency = false; // Print input-to-present latency percentiles
+        bool ShowProfiler = false;  // Open the profiler overlay at startup, toggled with F3
+        bool StartupTiming = false; // Print a breakdown of the startup steps and how long it took to present the first frame
+        std::string TracePath;      // Write a Chrome trace of the session here on exit, F12 writes one at any time
+        uint32_t HostMemoryLimitMiB = 0; // Fail Vulkan host allocations past this, 0 for no limit
+        uint32_t FramesInFlight = 2;     // Paced by a timeline semaphore, 0 for the per-swapchain-image fences
+        bool RenderThread = false;       // Render and present on a separate thread, see RenderThread
+        uint32_t SlowPresentMs = 0;      // Stress test: sleep this long before every present
+        uint32_t HeadlessFrames = 0;     // Render this many frames offscreen, without GLFW or a display, then exit
+        std::string HeadlessInput = "12+34*5=^2-6/7="; // Typed one character per headless frame, repeated
+        std::string CapturePath;         // Headless: write the last frame here as a binary PPM
+        bool SoftwareRenderer = false;   // Rasterize on the CPU instead of Vulkan, also chosen when Vulkan is missing
+        uint32_t SoftwareThreads = 0;    // Software renderer threads, including the main thread. 0 for one per core.
+        std::string RecordPath;          // Record every frame to this frame log, see FrameCapture
+        std::string InputLogPath;        // Record the calculator's input to this session log, see InputLogWriter
+        std::string ReplayPath;          // Replace the calculator's input with this session log, then exit
+        bool ReplayUnthrottled = false;  // Replay a recorded frame every frame rather than at the recorded times
     };
 
     class Application
@@ -25,13 +53,52 @@ namespace Calculator
         void RenderLayer();
         ~Application();
         void UI_DrawTitlebar(float& outTitlebarHeight);
+        // Lazy fonts are loaded before the next frame, the default font stands in until then
+        ImFont *GetFont(const std::string &name);
+
+        // Runs fn once every frame submitted or built so far has finished on the GPU, including the frame being built
+        // and those handed to the render thread but not submitted yet. It runs on the thread that submits frames: the
+        // render thread with --render-thread, the main thread otherwise, and on the main thread at a swapchain rebuild
+        // and on exit. Safe to call from any thread and never allocates. Returns false if the release ring is full.
+        template <typename Fn>
+        static bool SubmitResourceFree(Fn &&fn)
+        {
+            return getReleaseRing().Enqueue(getSubmitSerial(), std::forward<Fn>(fn));
+        }
+
+        // Engine work that spans frames, see TaskExecutor. Continuations reach the main thread right after input is
+        // polled, before the frame's UI is drawn.
+        static TaskExecutor &GetTasks();
 
     private:
+        static ResourceReleaseRing &getReleaseRing();
+        static uint64_t getSubmitSerial();
+
+        void buildFonts(bool useCache);
+        bool loadCachedFonts();
+        void applyFonts();
+        void reloadFonts();
+        void printFontStats(FILE *out) const;
+        void onFrameReturned(RenderFrame &frame);
+        void drawUI();
+        void runHeadless();
+        bool isMaximized() const { return m_Window != nullptr && glfwGetWindowAttrib(m_Window, GLFW_MAXIMIZED); }
+
         bool m_Running;
+        bool m_ShowProfiler = false;
+        uint64_t m_InitStart = 0;
         ApplicationSpec m_Specification;
         VkResult m_Err;
-        GLFWwindow *m_Window;
+        GLFWwindow *m_Window = nullptr; // Null in headless mode
         CalculatorScreen m_Calculator; 
+        InputQueue m_InputQueue;
+        InputLogWriter m_InputLog;
+        InputReplay m_InputReplay;
+        LatencyTracker m_Latency;
+        AssetPack m_Assets;
         std::unordered_map<std::string, ImFont *> m_FontMap;
+        ImFontAtlas *m_FontAtlas = nullptr; // Shared with the ImGui context, built during startup
+        uint32_t m_FontSet = 0;             // Bit per FONT_SOURCES entry in the atlas
+        bool m_FontReload = false;
     };
 }
\ No newline at end of file
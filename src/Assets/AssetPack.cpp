@@ -0,0 +1,98 @@
+#include "Assets/AssetPack.h"
+#include <stdio.h>
+#include <string.h>
+#include "Assets/Lz4.h"
+#include "Profiling/Trace.h"
+
+namespace Calculator
+{
+    bool AssetPack::OpenDefault()
+    {
+#ifdef CALCULATOR_EMBED_ASSETS
+        return Open(g_AssetPackBlob, g_AssetPackBlobSize);
+#else
+        std::filesystem::path path = GetExecutableDirectory() / "assets.pak";
+        if (Open(path))
+            return true;
+        fprintf(stderr, "[assets] Could not open %s\n", path.string().c_str());
+        return false;
+#endif
+    }
+
+    bool AssetPack::Open(const std::filesystem::path &path)
+    {
+        PROFILE_SCOPE("AssetPack::Open");
+        if (!m_File.Open(path))
+            return false;
+        if (Open(m_File.Data(), m_File.Size()))
+            return true;
+        m_File.Close();
+        return false;
+    }
+
+    bool AssetPack::Open(const void *data, size_t size)
+    {
+        m_Entries = nullptr;
+        m_EntryCount = 0;
+        if (size < sizeof(AssetPackHeader))
+            return false;
+        AssetPackHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.Magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC)) != 0 || header.Version != ASSET_PACK_VERSION ||
+            header.IndexOffset > size || (size - header.IndexOffset) / sizeof(AssetPackEntry) < header.EntryCount ||
+            header.IndexOffset % alignof(AssetPackEntry) != 0)
+        {
+            fprintf(stderr, "[assets] Not an asset pack, or written by another version\n");
+            return false;
+        }
+
+        const AssetPackEntry *entries = (const AssetPackEntry *)((const uint8_t *)data + header.IndexOffset);
+        for (uint32_t i = 0; i < header.EntryCount; i++)
+        {
+            const AssetPackEntry &entry = entries[i];
+            if (entry.Offset > size || entry.StoredSize > size - entry.Offset || entry.Name[sizeof(entry.Name) - 1] != 0 ||
+                (entry.Codec == AssetCodec::None && entry.StoredSize != entry.Size) ||
+                (entry.Kind == AssetKind::ImageRGBA8 && (uint64_t)entry.Width * entry.Height * 4 != entry.Size))
+            {
+                fprintf(stderr, "[assets] Entry %u of the asset pack is corrupt\n", i);
+                return false;
+            }
+        }
+        m_Data = (const uint8_t *)data;
+        m_Size = size;
+        m_Entries = entries;
+        m_EntryCount = header.EntryCount;
+        return true;
+    }
+
+    // A handful of entries, looked up a few times per launch
+    const AssetPackEntry *AssetPack::Find(const char *name) const
+    {
+        for (uint32_t i = 0; i < m_EntryCount; i++)
+            if (strcmp(m_Entries[i].Name, name) == 0)
+                return &m_Entries[i];
+        return nullptr;
+    }
+
+    const uint8_t *AssetPack::Map(const AssetPackEntry &entry) const
+    {
+        return entry.Codec == AssetCodec::None ? m_Data + entry.Offset : nullptr;
+    }
+
+    bool AssetPack::Read(const AssetPackEntry &entry, void *dst) const
+    {
+        PROFILE_SCOPE("AssetPack::Read");
+        switch (entry.Codec)
+        {
+        case AssetCodec::None:
+            memcpy(dst, m_Data + entry.Offset, entry.Size);
+            return true;
+        case AssetCodec::Lz4:
+            if (Lz4Decompress(m_Data + entry.Offset, entry.StoredSize, (uint8_t *)dst, entry.Size))
+                return true;
+            break;
+        }
+        fprintf(stderr, "[assets] Could not read %s\n", entry.Name);
+        return false;
+    }
+}
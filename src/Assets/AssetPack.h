@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "Core/Files.h"
+
+namespace Calculator
+{
+    // assets.pak layout, written by tools/AssetPack:
+    //   AssetPackHeader
+    //   entry data, each entry 16 byte aligned
+    //   AssetPackEntry[EntryCount] at IndexOffset
+    static const char ASSET_PACK_MAGIC[8] = {'C', 'A', 'L', 'C', 'P', 'A', 'K', '1'};
+    static const uint32_t ASSET_PACK_VERSION = 1;
+
+    enum class AssetCodec : uint32_t
+    {
+        None,
+        Lz4
+    };
+
+    enum class AssetKind : uint32_t
+    {
+        Raw,
+        ImageRGBA8 // Width * Height * 4 bytes, already decoded
+    };
+
+    struct AssetPackHeader
+    {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t EntryCount;
+        uint64_t IndexOffset;
+    };
+
+    struct AssetPackEntry
+    {
+        char Name[48];
+        uint64_t Offset;
+        uint64_t StoredSize;
+        uint64_t Size; // After decompression
+        uint64_t Hash; // HashBytes of the uncompressed data
+        AssetCodec Codec;
+        AssetKind Kind;
+        uint32_t Width;
+        uint32_t Height;
+    };
+
+#ifdef CALCULATOR_EMBED_ASSETS
+    // Generated by tools/AssetPack --cpp
+    extern const unsigned char g_AssetPackBlob[];
+    extern const size_t g_AssetPackBlobSize;
+#endif
+
+    // Read-only view of an asset pack, either memory mapped or linked into the executable
+    class AssetPack
+    {
+    public:
+        // The embedded blob when built with CALCULATOR_EMBED_ASSETS, else assets.pak next to the executable
+        bool OpenDefault();
+        bool Open(const std::filesystem::path &path);
+        bool Open(const void *data, size_t size);
+        bool IsOpen() const { return m_Entries != nullptr; }
+
+        const AssetPackEntry *Find(const char *name) const;
+
+        // Stored bytes of an uncompressed entry, valid while the pack is open. nullptr for compressed entries.
+        const uint8_t *Map(const AssetPackEntry &entry) const;
+        // Copies or decompresses an entry into dst, which must hold entry.Size bytes
+        bool Read(const AssetPackEntry &entry, void *dst) const;
+
+    private:
+        MappedFile m_File;
+        const uint8_t *m_Data = nullptr;
+        size_t m_Size = 0;
+        const AssetPackEntry *m_Entries = nullptr;
+        uint32_t m_EntryCount = 0;
+    };
+}
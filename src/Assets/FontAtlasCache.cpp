@@ -0,0 +1,200 @@
+#include "Assets/FontAtlasCache.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "Core/Files.h"
+#include "Profiling/Trace.h"
+
+namespace Calculator
+{
+    // fonts-<set>.bin layout, all offsets from the start of the file:
+    //   FontAtlasCacheHeader
+    //   FontAtlasCacheFont[FontCount]
+    //   ImFontGlyph[] for every font, back to back
+    //   ImVec4 TexUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1]
+    //   uint8_t Alpha8 pixels[TexWidth * TexHeight]
+    // The file is only ever read by the build that wrote it, so the structs are stored raw.
+    static const char FONT_CACHE_MAGIC[8] = {'C', 'A', 'L', 'C', 'F', 'N', 'T', '1'};
+    static const uint32_t FONT_CACHE_VERSION = 1;
+
+    struct FontAtlasCacheHeader
+    {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t ImGuiVersion;
+        uint32_t GlyphSize;
+        uint32_t FontCount;
+        uint64_t Key;
+        int32_t TexWidth;
+        int32_t TexHeight;
+        ImVec2 TexUvWhitePixel;
+        uint32_t LinesOffset;
+        uint32_t PixelsOffset;
+    };
+
+    struct FontAtlasCacheFont
+    {
+        float FontSize;
+        float Ascent;
+        float Descent;
+        uint32_t FallbackChar;
+        uint32_t EllipsisChar;
+        uint32_t GlyphOffset;
+        uint32_t GlyphCount;
+        char Name[40];
+    };
+
+    static std::filesystem::path getFontCachePath(uint32_t fontSet)
+    {
+        std::filesystem::path dir = GetCacheDirectory();
+        char name[32];
+        snprintf(name, sizeof(name), "fonts-%08x.bin", fontSet);
+        return dir.empty() ? dir : dir / name;
+    }
+
+    static bool isValid(const MappedFile &file, uint64_t key)
+    {
+        if (file.Size() < sizeof(FontAtlasCacheHeader))
+            return false;
+        const FontAtlasCacheHeader &header = *(const FontAtlasCacheHeader *)file.Data();
+        if (memcmp(header.Magic, FONT_CACHE_MAGIC, sizeof(FONT_CACHE_MAGIC)) != 0 ||
+            header.Version != FONT_CACHE_VERSION ||
+            header.ImGuiVersion != IMGUI_VERSION_NUM ||
+            header.GlyphSize != sizeof(ImFontGlyph) ||
+            header.Key != key ||
+            header.FontCount == 0 || header.TexWidth <= 0 || header.TexHeight <= 0)
+            return false;
+
+        uint64_t fontsEnd = sizeof(FontAtlasCacheHeader) + (uint64_t)header.FontCount * sizeof(FontAtlasCacheFont);
+        if (fontsEnd > file.Size() ||
+            (uint64_t)header.LinesOffset + sizeof(ImFontAtlas::TexUvLines) > file.Size() ||
+            (uint64_t)header.PixelsOffset + (uint64_t)header.TexWidth * header.TexHeight > file.Size())
+            return false;
+
+        const FontAtlasCacheFont *fonts = (const FontAtlasCacheFont *)(file.Data() + sizeof(FontAtlasCacheHeader));
+        for (uint32_t i = 0; i < header.FontCount; i++)
+            if (fonts[i].GlyphCount == 0 || (uint64_t)fonts[i].GlyphOffset + (uint64_t)fonts[i].GlyphCount * sizeof(ImFontGlyph) > file.Size())
+                return false;
+        return true;
+    }
+
+    bool LoadFontAtlasCache(ImFontAtlas *atlas, uint32_t fontSet, uint64_t key)
+    {
+        PROFILE_SCOPE("LoadFontAtlasCache");
+        IM_ASSERT(atlas->Fonts.empty() && atlas->ConfigData.empty());
+
+        std::filesystem::path path = getFontCachePath(fontSet);
+        MappedFile file;
+        if (path.empty() || !file.Open(path))
+            return false;
+        if (!isValid(file, key))
+        {
+            fprintf(stderr, "[cache] Ignoring stale %s\n", path.string().c_str());
+            return false;
+        }
+
+        const uint8_t *data = file.Data();
+        const FontAtlasCacheHeader &header = *(const FontAtlasCacheHeader *)data;
+        const FontAtlasCacheFont *records = (const FontAtlasCacheFont *)(data + sizeof(FontAtlasCacheHeader));
+
+        // ImFont::ConfigData points into this vector, it must not grow afterwards
+        atlas->ConfigData.reserve((int)header.FontCount);
+        for (uint32_t i = 0; i < header.FontCount; i++)
+        {
+            const FontAtlasCacheFont &record = records[i];
+            ImFont *font = IM_NEW(ImFont)();
+
+            ImFontConfig config;
+            config.FontData = nullptr;
+            config.FontDataOwnedByAtlas = false;
+            config.SizePixels = record.FontSize;
+            config.DstFont = font;
+            memcpy(config.Name, record.Name, sizeof(config.Name));
+            config.Name[sizeof(config.Name) - 1] = 0;
+            atlas->ConfigData.push_back(config);
+
+            font->FontSize = record.FontSize;
+            font->Ascent = record.Ascent;
+            font->Descent = record.Descent;
+            font->FallbackChar = (ImWchar)record.FallbackChar;
+            font->EllipsisChar = (ImWchar)record.EllipsisChar;
+            font->ContainerAtlas = atlas;
+            font->ConfigData = &atlas->ConfigData.back();
+            font->ConfigDataCount = 1;
+            font->Glyphs.resize((int)record.GlyphCount);
+            memcpy(font->Glyphs.Data, data + record.GlyphOffset, record.GlyphCount * sizeof(ImFontGlyph));
+            font->BuildLookupTable();
+            atlas->Fonts.push_back(font);
+        }
+
+        size_t pixelCount = (size_t)header.TexWidth * header.TexHeight;
+        atlas->TexPixelsAlpha8 = (unsigned char *)IM_ALLOC(pixelCount);
+        memcpy(atlas->TexPixelsAlpha8, data + header.PixelsOffset, pixelCount);
+        memcpy(atlas->TexUvLines, data + header.LinesOffset, sizeof(atlas->TexUvLines));
+        atlas->TexWidth = header.TexWidth;
+        atlas->TexHeight = header.TexHeight;
+        atlas->TexUvScale = ImVec2(1.0f / header.TexWidth, 1.0f / header.TexHeight);
+        atlas->TexUvWhitePixel = header.TexUvWhitePixel;
+        // The software cursor shapes live in custom rects that are not restored
+        atlas->Flags |= ImFontAtlasFlags_NoMouseCursors;
+        atlas->TexReady = true;
+        return true;
+    }
+
+    bool SaveFontAtlasCache(const ImFontAtlas *atlas, uint32_t fontSet, uint64_t key)
+    {
+        PROFILE_SCOPE("SaveFontAtlasCache");
+        if (atlas->TexPixelsAlpha8 == nullptr || atlas->Fonts.empty())
+            return false;
+        std::filesystem::path path = getFontCachePath(fontSet);
+        if (path.empty())
+            return false;
+
+        FontAtlasCacheHeader header = {};
+        memcpy(header.Magic, FONT_CACHE_MAGIC, sizeof(FONT_CACHE_MAGIC));
+        header.Version = FONT_CACHE_VERSION;
+        header.ImGuiVersion = IMGUI_VERSION_NUM;
+        header.GlyphSize = sizeof(ImFontGlyph);
+        header.FontCount = (uint32_t)atlas->Fonts.Size;
+        header.Key = key;
+        header.TexWidth = atlas->TexWidth;
+        header.TexHeight = atlas->TexHeight;
+        header.TexUvWhitePixel = atlas->TexUvWhitePixel;
+
+        std::vector<FontAtlasCacheFont> records(atlas->Fonts.Size);
+        uint32_t offset = (uint32_t)(sizeof(FontAtlasCacheHeader) + records.size() * sizeof(FontAtlasCacheFont));
+        for (int i = 0; i < atlas->Fonts.Size; i++)
+        {
+            const ImFont *font = atlas->Fonts[i];
+            FontAtlasCacheFont &record = records[i];
+            memset(&record, 0, sizeof(record));
+            record.FontSize = font->FontSize;
+            record.Ascent = font->Ascent;
+            record.Descent = font->Descent;
+            record.FallbackChar = font->FallbackChar;
+            record.EllipsisChar = font->EllipsisChar;
+            record.GlyphOffset = offset;
+            record.GlyphCount = (uint32_t)font->Glyphs.Size;
+            if (font->ConfigData != nullptr)
+                memcpy(record.Name, font->ConfigData->Name, sizeof(record.Name));
+            offset += record.GlyphCount * sizeof(ImFontGlyph);
+        }
+        header.LinesOffset = offset;
+        header.PixelsOffset = offset + sizeof(atlas->TexUvLines);
+
+        size_t pixelCount = (size_t)atlas->TexWidth * atlas->TexHeight;
+        std::vector<uint8_t> blob;
+        blob.reserve(header.PixelsOffset + pixelCount);
+        auto append = [&blob](const void *data, size_t size)
+        { blob.insert(blob.end(), (const uint8_t *)data, (const uint8_t *)data + size); };
+        append(&header, sizeof(header));
+        append(records.data(), records.size() * sizeof(FontAtlasCacheFont));
+        for (const ImFont *font : atlas->Fonts)
+            append(font->Glyphs.Data, font->Glyphs.size_in_bytes());
+        append(atlas->TexUvLines, sizeof(atlas->TexUvLines));
+        append(atlas->TexPixelsAlpha8, pixelCount);
+        return WriteFileAtomic(path, blob.data(), blob.size());
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Core/Hash.h"
+
+struct ImFontAtlas;
+
+namespace Calculator
+{
+    // Restores the fonts, glyph tables and Alpha8 pixels of a previously built atlas into an empty atlas.
+    // Every set of fonts, a bit mask of the caller's choosing, has a file of its own, so loading a lazy font does
+    // not replace the atlas the next launch starts with. key identifies the font sources and sizes; a file written
+    // for another key or ImGui version is ignored. On success the atlas is ready (TexReady) and the fonts are in
+    // the order they were saved.
+    bool LoadFontAtlasCache(ImFontAtlas *atlas, uint32_t fontSet, uint64_t key);
+
+    // Writes a built atlas so the next launch can skip decompression and rasterization
+    bool SaveFontAtlasCache(const ImFontAtlas *atlas, uint32_t fontSet, uint64_t key);
+}
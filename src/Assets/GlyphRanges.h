@@ -0,0 +1,48 @@
+#pragma once
+#include "imgui.h"
+#include <cstddef>
+
+namespace Calculator
+{
+    // Zero-terminated ImWchar range pairs, sized for the worst case of one range per character
+    template <size_t N>
+    struct GlyphRanges
+    {
+        ImWchar Data[N * 2 + 1];
+
+        constexpr size_t GlyphCount() const
+        {
+            size_t count = 0;
+            for (size_t i = 0; Data[i] != 0; i += 2)
+                count += Data[i + 1] - Data[i] + 1;
+            return count;
+        }
+    };
+
+    // Builds the smallest set of ranges covering the ASCII characters of a string literal, at compile time:
+    //   static constexpr auto RANGES = GlyphRangesFromChars("0123456789+-");
+    template <size_t N>
+    constexpr GlyphRanges<N> GlyphRangesFromChars(const char (&chars)[N])
+    {
+        bool used[128] = {};
+        for (size_t i = 0; i < N; i++)
+            if (chars[i] > 0)
+                used[(int)chars[i]] = true;
+
+        GlyphRanges<N> ranges = {};
+        size_t count = 0;
+        for (int c = 1; c < 128; c++)
+        {
+            if (!used[c])
+                continue;
+            if (count > 0 && ranges.Data[count - 1] == c - 1)
+            {
+                ranges.Data[count - 1] = (ImWchar)c;
+                continue;
+            }
+            ranges.Data[count++] = (ImWchar)c;
+            ranges.Data[count++] = (ImWchar)c;
+        }
+        return ranges;
+    }
+}
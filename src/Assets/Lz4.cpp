@@ -0,0 +1,141 @@
+#include "Assets/Lz4.h"
+#include <string.h>
+#include <vector>
+
+namespace Calculator
+{
+    static const size_t LZ4_MIN_MATCH = 4;
+    static const size_t LZ4_LAST_LITERALS = 5; // The block always ends with at least this many literals
+    static const size_t LZ4_MATCH_LIMIT = 12;  // and no match starts in its last 12 bytes
+    static const size_t LZ4_MAX_OFFSET = 65535;
+    static const int LZ4_HASH_BITS = 16;
+
+    static uint32_t read32(const uint8_t *p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t hash32(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+    }
+
+    static uint8_t *writeLength(uint8_t *op, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            *op++ = 255;
+        *op++ = (uint8_t)length;
+        return op;
+    }
+
+    size_t Lz4CompressBound(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    size_t Lz4Compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+    {
+        if (capacity < Lz4CompressBound(size))
+            return 0;
+
+        uint8_t *op = dst;
+        size_t anchor = 0;
+        auto emit = [&](size_t literals, size_t offset, size_t matchLength)
+        {
+            uint8_t *token = op++;
+            *token = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+            if (literals >= 15)
+                op = writeLength(op, literals - 15);
+            if (literals > 0)
+                memcpy(op, src + anchor, literals);
+            op += literals;
+            if (offset == 0)
+                return;
+            *op++ = (uint8_t)(offset & 0xFF);
+            *op++ = (uint8_t)(offset >> 8);
+            size_t length = matchLength - LZ4_MIN_MATCH;
+            *token |= (uint8_t)(length >= 15 ? 15 : length);
+            if (length >= 15)
+                op = writeLength(op, length - 15);
+        };
+
+        if (size > LZ4_MATCH_LIMIT)
+        {
+            std::vector<uint32_t> table((size_t)1 << LZ4_HASH_BITS, UINT32_MAX);
+            size_t ip = 0;
+            while (ip < size - LZ4_MATCH_LIMIT)
+            {
+                uint32_t sequence = read32(src + ip);
+                uint32_t &slot = table[hash32(sequence)];
+                size_t ref = slot;
+                slot = (uint32_t)ip;
+                if (ref == UINT32_MAX || ip - ref > LZ4_MAX_OFFSET || read32(src + ref) != sequence)
+                {
+                    ip++;
+                    continue;
+                }
+
+                size_t length = LZ4_MIN_MATCH;
+                while (ip + length < size - LZ4_LAST_LITERALS && src[ref + length] == src[ip + length])
+                    length++;
+                emit(ip - anchor, ip - ref, length);
+                ip += length;
+                anchor = ip;
+            }
+        }
+        emit(size - anchor, 0, 0);
+        return (size_t)(op - dst);
+    }
+
+    bool Lz4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t size)
+    {
+        size_t ip = 0, op = 0;
+        auto readLength = [&](size_t &length)
+        {
+            uint8_t byte;
+            do
+            {
+                if (ip >= srcSize)
+                    return false;
+                byte = src[ip++];
+                length += byte;
+            } while (byte == 255);
+            return true;
+        };
+
+        while (ip < srcSize)
+        {
+            uint8_t token = src[ip++];
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(literals))
+                return false;
+            if (literals > srcSize - ip || literals > size - op)
+                return false;
+            if (literals > 0)
+                memcpy(dst + op, src + ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == srcSize)
+                return op == size;
+
+            if (srcSize - ip < 2)
+                return false;
+            size_t offset = src[ip] | ((size_t)src[ip + 1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > op)
+                return false;
+            size_t length = token & 15;
+            if (length == 15 && !readLength(length))
+                return false;
+            length += LZ4_MIN_MATCH;
+            if (length > size - op)
+                return false;
+            // Byte by byte, the match may overlap the bytes it produces
+            for (const uint8_t *match = dst + op - offset; length > 0; length--)
+                dst[op++] = *match++;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (no frame header or checksums), the framing is left to the asset pack index
+namespace Calculator
+{
+    size_t Lz4CompressBound(size_t size);
+
+    // Greedy single-pass compressor for offline use. Returns the compressed size, or 0 if capacity is too small.
+    size_t Lz4Compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+    // Returns false unless src decodes to exactly size bytes; never reads or writes out of bounds
+    bool Lz4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t size);
+}
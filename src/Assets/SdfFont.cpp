@@ -0,0 +1,78 @@
+#include "Assets/SdfFont.h"
+#include "imgui.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Profiling/Trace.h"
+
+// ImGui compiles its copy of stb_truetype as static, this translation unit gets its own
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imstb_truetype.h"
+
+namespace Calculator
+{
+    // Only the space is rasterized by ImGui, it gives the font its metrics and has no pixels
+    static const ImWchar SDF_RASTER_RANGE[] = {0x0020, 0x0020, 0};
+    static const unsigned char SDF_ON_EDGE = 128;
+
+    ImFont *SdfFontBuilder::AddFont(ImFontAtlas *atlas, const ImFontConfig &config)
+    {
+        PROFILE_SCOPE("SdfFontBuilder::AddFont");
+        const ImWchar *glyphRanges = config.GlyphRanges;
+        ImFontConfig raster = config;
+        raster.SizePixels = SDF_FONT_SIZE;
+        raster.GlyphRanges = SDF_RASTER_RANGE;
+        ImFont *font = atlas->AddFont(&raster);
+
+        const unsigned char *ttf = (const unsigned char *)config.FontData;
+        stbtt_fontinfo info;
+        if (!stbtt_InitFont(&info, ttf, stbtt_GetFontOffsetForIndex(ttf, config.FontNo)))
+        {
+            fprintf(stderr, "[fonts] Could not load %s for distance fields\n", config.Name);
+            return font;
+        }
+
+        float scale = stbtt_ScaleForPixelHeight(&info, SDF_FONT_SIZE);
+        int ascent, descent, lineGap;
+        stbtt_GetFontVMetrics(&info, &ascent, &descent, &lineGap);
+        // Same rounding as ImFont::Ascent, custom glyph offsets are relative to the top of the line
+        float baseline = floorf(ascent * scale + 1.0f);
+
+        for (const ImWchar *range = glyphRanges; range[0] != 0; range += 2)
+        {
+            for (int codepoint = range[0]; codepoint <= range[1]; codepoint++)
+            {
+                if (codepoint == ' ' || stbtt_FindGlyphIndex(&info, codepoint) == 0)
+                    continue;
+                int width, height, xoff, yoff;
+                unsigned char *sdf = stbtt_GetCodepointSDF(&info, scale, codepoint, SDF_PADDING, SDF_ON_EDGE, (float)SDF_ON_EDGE / SDF_PADDING, &width, &height, &xoff, &yoff);
+                if (sdf == nullptr)
+                    continue;
+                int advance, leftBearing;
+                stbtt_GetCodepointHMetrics(&info, codepoint, &advance, &leftBearing);
+
+                PendingGlyph glyph;
+                glyph.RectId = atlas->AddCustomRectFontGlyph(font, (ImWchar)codepoint, width, height, advance * scale, ImVec2((float)xoff, yoff + baseline));
+                glyph.Width = width;
+                glyph.Height = height;
+                glyph.Pixels.assign(sdf, sdf + width * height);
+                m_Glyphs.push_back(std::move(glyph));
+                stbtt_FreeSDF(sdf, nullptr);
+            }
+        }
+        return font;
+    }
+
+    void SdfFontBuilder::Finish(ImFontAtlas *atlas)
+    {
+        IM_ASSERT(atlas->TexPixelsAlpha8 != nullptr && "Build the atlas before Finish");
+        for (const PendingGlyph &glyph : m_Glyphs)
+        {
+            const ImFontAtlasCustomRect *rect = atlas->GetCustomRectByIndex(glyph.RectId);
+            for (int y = 0; y < glyph.Height; y++)
+                memcpy(atlas->TexPixelsAlpha8 + (rect->Y + y) * atlas->TexWidth + rect->X, glyph.Pixels.data() + y * glyph.Width, glyph.Width);
+        }
+        m_Glyphs.clear();
+    }
+}
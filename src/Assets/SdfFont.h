@@ -0,0 +1,32 @@
+#pragma once
+#include "imgui.h"
+#include <cstdint>
+#include <vector>
+
+namespace Calculator
+{
+    // Distance fields are rasterized once at this size; every draw size samples the same texels
+    static constexpr float SDF_FONT_SIZE = 32.0f;
+    // Texels of distance encoded on each side of the outline, which bounds how far the glyph can be scaled down
+    static constexpr int SDF_PADDING = 4;
+
+    // Adds signed-distance-field fonts to an atlas. Glyph rects are reserved before ImFontAtlas::Build, and Finish
+    // writes the distance fields into the built Alpha8 texture, before it is converted to RGBA32.
+    // These fonts only render correctly between BeginSdfText and EndSdfText (Renderer/SdfText.h).
+    class SdfFontBuilder
+    {
+    public:
+        // Takes the TTF data, glyph ranges and name from config, its size is ignored
+        ImFont *AddFont(ImFontAtlas *atlas, const ImFontConfig &config);
+        void Finish(ImFontAtlas *atlas);
+
+    private:
+        struct PendingGlyph
+        {
+            int RectId;
+            int Width, Height;
+            std::vector<uint8_t> Pixels;
+        };
+        std::vector<PendingGlyph> m_Glyphs;
+    };
+}
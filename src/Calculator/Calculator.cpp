@@ -1,69 +1,313 @@
+#pragma once
 #include "imgui.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <float.h>
 #include <iostream>
+#include <memory>
+#include <stdio.h>
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include "CalculatorView.cpp"
+#include "ExpressionParser.h"
+#include "InputEvents.h"
+#include "Core/Tasks.h"
+#include "Core/Hash.h"
+#include "Renderer/SdfText.h"
 
 namespace Calculator
 {
-    typedef std::pair<std::string, ImGuiKey> KEY;
     static ImColor DARK_BUTTON(60, 60, 60);
     static ImColor LIGHT_BUTTON(90, 90, 91);
-    static std::vector<KEY> NUM_KEYS = std::vector<KEY>({
-        {"0", ImGuiKey_Keypad0},
-        {"1", ImGuiKey_Keypad1},
-        {"2", ImGuiKey_Keypad2},
-        {"3", ImGuiKey_Keypad3},
-        {"4", ImGuiKey_Keypad4},
-        {"5", ImGuiKey_Keypad5},
-        {"6", ImGuiKey_Keypad6},
-        {"7", ImGuiKey_Keypad7},
-        {"8", ImGuiKey_Keypad8},
-        {"9", ImGuiKey_Keypad9},
-    });
-
-    static std::vector<KEY> SPECIAL_KEYS = std::vector<KEY>({
-        {"-", ImGuiKey_KeypadSubtract},
-        {"+", ImGuiKey_KeypadAdd},
-        {"*", ImGuiKey_KeypadMultiply},
-        {"/", ImGuiKey_KeypadDivide},
-        {".", ImGuiKey_KeypadDecimal},
-        {"^", ImGuiKey_Period},
-        {"=", ImGuiKey_KeypadEnter},
-    });
+
+    enum KeyId : uint8_t
+    {
+        Key_0,
+        Key_1,
+        Key_2,
+        Key_3,
+        Key_4,
+        Key_5,
+        Key_6,
+        Key_7,
+        Key_8,
+        Key_9,
+        Key_Subtract,
+        Key_Add,
+        Key_Multiply,
+        Key_Divide,
+        Key_Decimal,
+        Key_Power,
+        Key_Equals,
+        Key_COUNT,
+        Key_None = 0xFF
+    };
+
+    struct KeyDesc
+    {
+        const char *Label;
+        ImGuiKey Keypad; // Keypad binding
+        ImGuiKey Main;   // Main-row binding, ImGuiKey_None if there is none
+        int8_t Col;      // Grid cell of the on-screen button, -1 if the key has no button
+        int8_t Row;
+        bool Dark;
+    };
+
+    // Indexed by KeyId
+    static constexpr KeyDesc KEYS[Key_COUNT] = {
+        {"0", ImGuiKey_Keypad0, ImGuiKey_0, 1, 3, true},
+        {"1", ImGuiKey_Keypad1, ImGuiKey_1, 0, 0, true},
+        {"2", ImGuiKey_Keypad2, ImGuiKey_2, 1, 0, true},
+        {"3", ImGuiKey_Keypad3, ImGuiKey_3, 2, 0, true},
+        {"4", ImGuiKey_Keypad4, ImGuiKey_4, 0, 1, true},
+        {"5", ImGuiKey_Keypad5, ImGuiKey_5, 1, 1, true},
+        {"6", ImGuiKey_Keypad6, ImGuiKey_6, 2, 1, true},
+        {"7", ImGuiKey_Keypad7, ImGuiKey_7, 0, 2, true},
+        {"8", ImGuiKey_Keypad8, ImGuiKey_8, 1, 2, true},
+        {"9", ImGuiKey_Keypad9, ImGuiKey_9, 2, 2, true},
+        {"-", ImGuiKey_KeypadSubtract, ImGuiKey_None, 3, 0, false},
+        {"+", ImGuiKey_KeypadAdd, ImGuiKey_None, 3, 1, false},
+        {"*", ImGuiKey_KeypadMultiply, ImGuiKey_None, 3, 2, false},
+        {"/", ImGuiKey_KeypadDivide, ImGuiKey_None, 3, 3, false},
+        {".", ImGuiKey_KeypadDecimal, ImGuiKey_None, 0, 3, false},
+        {"^", ImGuiKey_Period, ImGuiKey_None, 2, 3, false},
+        {"=", ImGuiKey_KeypadEnter, ImGuiKey_None, -1, -1, false},
+    };
+
+    typedef std::array<KeyId, ImGuiKey_NamedKey_COUNT> KeyLookup;
+
+    static constexpr KeyLookup buildKeyLookup()
+    {
+        KeyLookup lookup = {};
+        for (size_t i = 0; i < lookup.size(); i++)
+            lookup[i] = Key_None;
+        for (int id = 0; id < Key_COUNT; id++)
+        {
+            lookup[KEYS[id].Keypad - ImGuiKey_NamedKey_BEGIN] = (KeyId)id;
+            if (KEYS[id].Main != ImGuiKey_None)
+                lookup[KEYS[id].Main - ImGuiKey_NamedKey_BEGIN] = (KeyId)id;
+        }
+        return lookup;
+    }
+
+    // ImGuiKey -> KeyId, so dispatching a key never searches the table
+    static constexpr KeyLookup KEY_LOOKUP = buildKeyLookup();
+
+    static inline KeyId KeyFromImGuiKey(ImGuiKey key)
+    {
+        if (key < ImGuiKey_NamedKey_BEGIN || key >= ImGuiKey_NamedKey_END)
+            return Key_None;
+        return KEY_LOOKUP[key - ImGuiKey_NamedKey_BEGIN];
+    }
+
+    typedef std::array<KeyId, 128> CharLookup;
+
+    static constexpr CharLookup buildCharLookup()
+    {
+        CharLookup lookup = {};
+        for (size_t i = 0; i < lookup.size(); i++)
+            lookup[i] = Key_None;
+        for (int id = 0; id < Key_COUNT; id++)
+            lookup[(unsigned char)KEYS[id].Label[0]] = (KeyId)id;
+        return lookup;
+    }
+
+    // Typed character -> KeyId, for operators that need a modifier on the main row (eg. Shift+8 for '*')
+    static constexpr CharLookup CHAR_LOOKUP = buildCharLookup();
+
+    static inline KeyId KeyFromChar(uint32_t c)
+    {
+        return c < CHAR_LOOKUP.size() ? CHAR_LOOKUP[c] : Key_None;
+    }
+
+    static constexpr int GRID_COLS = 4;
+    static constexpr int GRID_ROWS = 4;
+    typedef std::array<std::array<KeyId, GRID_COLS>, GRID_ROWS> KeyGrid;
+
+    static constexpr KeyGrid buildKeyGrid()
+    {
+        KeyGrid grid = {};
+        for (int row = 0; row < GRID_ROWS; row++)
+            for (int col = 0; col < GRID_COLS; col++)
+                grid[row][col] = Key_None;
+        for (int id = 0; id < Key_COUNT; id++)
+            if (KEYS[id].Col >= 0)
+                grid[KEYS[id].Row][KEYS[id].Col] = (KeyId)id;
+        return grid;
+    }
+
+    // Grid cell -> KeyId, so a click is resolved without testing every button
+    static constexpr KeyGrid KEY_GRID = buildKeyGrid();
 
     class CalculatorScreen
     {
+        // Waited for when '=' is pressed, so any evaluation quicker than this shows in the frame that asked for it
+        static constexpr uint64_t EVALUATION_BUDGET_NS = 2000000;
+        // Progress only replaces the display past this, so a quick evaluation does not flicker
+        static constexpr uint64_t PROGRESS_DELAY_NS = 100000000;
+        // Of a pasted expression, what the display shows
+        static constexpr size_t PASTE_SHOWN_CHARS = 24;
+
+        // A paste being parsed by a task, shared with it until the task has finished
+        struct PasteJob
+        {
+            CancelToken Cancel;
+            std::atomic<float> Progress{0.0f};
+        };
+
         CalculatorData m_Calc;
+        EvaluationWorker m_Evaluator;
+        TaskExecutor *m_Tasks = nullptr;
+        std::shared_ptr<PasteJob> m_Paste; // Until its result is applied or it is cancelled
+        // Reused by every paste, so its arena is allocated once. A task takes it and gives it back at the continuation
+        // point, a paste that comes while a cancelled task still has it gets a new one.
+        std::unique_ptr<ExpressionParser> m_PasteParser;
+        std::vector<InputEvent> m_Deferred; // Received during an evaluation, applied in order once it is done
+        bool m_ReportPastes = false;
+        bool m_Synchronous = false;
+        std::string m_PasteShown;
+        uint64_t m_EvaluationStart = 0;
+        uint64_t m_EvaluationBudgetNs = EVALUATION_BUDGET_NS;
         int m_GridSize;
-        std::unordered_map<std::string, bool> m_Focused;
+        std::bitset<Key_COUNT> m_Focused;
+        ImVec2 m_GridOrigin; // Top-left of the button grid, relative to the main viewport
+        ImVec2 m_MousePos = ImVec2(-FLT_MAX, -FLT_MAX); // From the input events, so hovering needs no ImGui context
+        bool m_SuppressChar = false;
         ImDrawList *m_DrawList;
+        ImFont *m_DisplayFont = nullptr; // Expression and result text, ImGui::GetFont() when null
+        bool m_DisplayFontSdf = false;
         double time;
 
-        void createButtons(KEY key, ImVec2 topLeft, bool focused, bool dark)
+        void pressKey(KeyId id)
+        {
+            if (id == Key_Equals)
+                evaluate();
+            else if (id <= Key_9)
+                m_Calc.OnNumKeyPressed(KEYS[id].Label);
+            else
+                m_Calc.OnSpecialKeyPressed(KEYS[id].Label);
+        }
+
+        void evaluate()
+        {
+            if (!m_Calc.CanCalculate())
+                return;
+            m_Evaluator.Submit(m_Calc.GetCalculation());
+            m_EvaluationStart = InputClockNow();
+            if (m_Evaluator.Wait(m_EvaluationBudgetNs))
+                Update();
+        }
+
+        // Parsed and evaluated like '=', the calculator shows the start of the text and its value. A paste that is
+        // not a valid expression leaves the calculator as it was. One of up to a chunk is parsed right away, it takes
+        // a few milliseconds at most. A longer one is parsed by a task on a worker, and its result applied at the
+        // frame's continuation point, with the input received meanwhile.
+        void paste(std::shared_ptr<const std::string> text)
+        {
+            m_PasteShown.clear();
+            for (char c : *text)
+            {
+                if (m_PasteShown.size() == PASTE_SHOWN_CHARS)
+                {
+                    m_PasteShown += "...";
+                    break;
+                }
+                bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+                if (!space)
+                    m_PasteShown += c;
+                else if (!m_PasteShown.empty() && m_PasteShown.back() != ' ')
+                    m_PasteShown += ' ';
+            }
+            if (!m_PasteParser)
+                m_PasteParser = std::make_unique<ExpressionParser>();
+
+            if (m_Tasks == nullptr || m_Synchronous || text->size() <= ExpressionParser::CHUNK_SIZE)
+            {
+                CancelToken cancel;
+                std::atomic<float> progress;
+                applyPaste(parsePaste(*m_PasteParser, *text, cancel, progress, m_ReportPastes));
+                return;
+            }
+            m_Paste = std::make_shared<PasteJob>();
+            m_EvaluationStart = InputClockNow();
+            m_Tasks->Spawn(pasteTask(m_Paste, std::move(m_PasteParser), std::move(text)));
+        }
+
+        Task<> pasteTask(std::shared_ptr<PasteJob> job, std::unique_ptr<ExpressionParser> parser, std::shared_ptr<const std::string> text)
+        {
+            bool report = m_ReportPastes;
+            co_await m_Tasks->Schedule();
+            std::string ans = parsePaste(*parser, *text, job->Cancel, job->Progress, report);
+            co_await m_Tasks->NextFrame();
+            if (!m_PasteParser)
+                m_PasteParser = std::move(parser);
+            // Escape gave up on it in the meantime
+            if (job != m_Paste)
+                co_return;
+            m_Paste.reset();
+            applyPaste(ans);
+            applyDeferred();
+        }
+
+        // Any thread. Empty when the text is no valid expression or the parse was cancelled.
+        static std::string parsePaste(ExpressionParser &parser, const std::string &text, const CancelToken &cancel,
+                                      std::atomic<float> &progress, bool report)
+        {
+            parser.Reserve(text.size());
+            std::string ans;
+            if (parser.Parse(text.data(), text.size(), cancel, progress))
+                ans = CalculatorData::FormatResult(parser.Evaluate());
+            if (report)
+                parser.Report(stdout);
+            return ans;
+        }
+
+        void applyPaste(const std::string &ans)
+        {
+            if (!ans.empty())
+                m_Calc.ApplyPaste(m_PasteShown, ans);
+        }
+
+        // Input may start another evaluation, which defers the rest again
+        void applyDeferred()
+        {
+            std::vector<InputEvent> deferred;
+            deferred.swap(m_Deferred);
+            for (const InputEvent &event : deferred)
+                OnInputEvent(event);
+        }
+
+        void createButtons(KeyId id, ImVec2 topLeft, bool focused, bool dark)
         {
             ImVec2 bottomRight({topLeft.x + m_GridSize, topLeft.y + m_GridSize});
             topLeft.x += 5;
             topLeft.y += 5;
-            ImVec2 mousePos = ImGui::GetMousePos();
-            if (focused || (mousePos.x > topLeft.x && mousePos.x < bottomRight.x && mousePos.y > topLeft.y && mousePos.y < bottomRight.y))
+            if (focused || keyAt(m_MousePos) == id)
             {
                 m_DrawList->AddRectFilled(topLeft, bottomRight, (dark ? DARK_BUTTON : LIGHT_BUTTON), 10);
-                if (ImGui::IsMouseReleased(ImGuiMouseButton_Left))
-                {
-                    if (key.first[0] >= '0' && key.first[0] <= '9')
-                        m_Calc.OnNumKeyPressed(key.first);
-                    else
-                        m_Calc.OnSpecialKeyPressed(key.first);
-                }
             }
             else
             {
                 m_DrawList->AddRectFilled(topLeft, bottomRight, (dark ? LIGHT_BUTTON : DARK_BUTTON), 10);
             }
             int length = bottomRight.x - topLeft.x, height = bottomRight.y - topLeft.y;
-            m_DrawList->AddText(ImVec2(topLeft.x + length / 2 - 10, topLeft.y + height / 2 - 20), ImColor(255, 255, 255), key.first.c_str());
+            m_DrawList->AddText(ImVec2(topLeft.x + length / 2 - 10, topLeft.y + height / 2 - 20), ImColor(255, 255, 255), KEYS[id].Label);
+        }
+
+        // The 5px gap at the top-left of each cell is not part of the button
+        KeyId keyAt(ImVec2 pos) const
+        {
+            float x = pos.x - m_GridOrigin.x;
+            float y = pos.y - m_GridOrigin.y;
+            if (x < 0 || y < 0)
+                return Key_None;
+            int col = (int)(x / m_GridSize), row = (int)(y / m_GridSize);
+            if (col >= GRID_COLS || row >= GRID_ROWS)
+                return Key_None;
+            if (x - col * m_GridSize <= 5 || y - row * m_GridSize <= 5)
+                return Key_None;
+            return KEY_GRID[row][col];
         }
 
     public:
@@ -72,8 +316,77 @@ namespace Calculator
             time = 0;
         }
 
+        // sdf fonts are drawn between BeginSdfText and EndSdfText
+        void SetDisplayFont(ImFont *font, bool sdf)
+        {
+            m_DisplayFont = font;
+            m_DisplayFontSdf = sdf;
+        }
+
+        // Places the button grid in a viewport of the given size. CreateGrid does it every frame, input is hit
+        // tested against the last layout.
+        void Layout(ImVec2 viewportSize)
+        {
+            m_GridOrigin = ImVec2(0, viewportSize.y - m_GridSize * 4 - 5);
+        }
+
+        // Window coordinates of the middle of the key's button, false if the key has none
+        bool GetButtonCenter(KeyId id, ImVec2 &pos) const
+        {
+            if (id >= Key_COUNT || KEYS[id].Col < 0)
+                return false;
+            pos = ImVec2(m_GridOrigin.x + (KEYS[id].Col + 0.5f) * m_GridSize, m_GridOrigin.y + (KEYS[id].Row + 0.5f) * m_GridSize);
+            return true;
+        }
+
+        CalculatorData &GetData() { return m_Calc; }
+
+        // Wait for every evaluation to finish, for runs that must not depend on timing such as replays
+        void SetSynchronousEvaluation(bool synchronous)
+        {
+            m_Synchronous = synchronous;
+            m_EvaluationBudgetNs = synchronous ? UINT64_MAX : EVALUATION_BUDGET_NS;
+        }
+
+        // Where long pastes are parsed. Without it every paste is parsed as it arrives. A paste task resumes on the
+        // main thread even once cancelled, tasks must be stopped before this is destroyed.
+        void SetTasks(TaskExecutor *tasks) { m_Tasks = tasks; }
+
+        bool IsEvaluating() const { return m_Evaluator.IsBusy() || m_Paste != nullptr; }
+
+        // Gives up on the evaluation and the input that waited for it, the calculator stays as it was
+        void CancelEvaluation()
+        {
+            m_Evaluator.Cancel();
+            if (m_Paste)
+                m_Paste->Cancel.Cancel();
+            m_Paste.reset();
+            m_Deferred.clear();
+        }
+
+        // Print the parser's statistics after every paste
+        void SetReportPastes(bool report) { m_ReportPastes = report; }
+
+        // Once per frame. Applies the result of a finished evaluation, then the input that waited for it.
+        void Update()
+        {
+            std::string ans;
+            if (!m_Evaluator.TakeResult(ans))
+                return;
+            m_Calc.ApplyResult(ans);
+            applyDeferred();
+        }
+
+        // Identifies what the display shows, to tell whether two runs of the same input ended up in the same state
+        uint64_t GetDisplayHash()
+        {
+            std::string expression = m_Calc.GetExpression(), operand2 = m_Calc.GetOperand2();
+            return HashBytes(operand2.data(), operand2.size() + 1, HashBytes(expression.data(), expression.size() + 1));
+        }
+
         void CreateGrid()
         {
+            PROFILE_SCOPE("CalculatorScreen::CreateGrid");
             m_DrawList = ImGui::GetForegroundDrawList();
             ImVec2 pos1 = ImGui::GetMainViewport()->Pos;
             ImVec2 region = ImGui::GetMainViewport()->Size;
@@ -81,99 +394,137 @@ namespace Calculator
             ImVec2 text_pos = pos1;
             text_pos.x += region.x - 20;
             text_pos.y += region.y - m_GridSize * 5 - 30;
+            ImFont *font = m_DisplayFont ? m_DisplayFont : ImGui::GetFont();
+            if (m_DisplayFontSdf)
+                BeginSdfText(m_DrawList);
             m_DrawList->AddText(
-                ImGui::GetFont(), 30,
-                ImVec2(text_pos.x - ImGui::GetFont()->CalcTextSizeA(30, region.x, region.x, m_Calc.GetExpression().c_str()).x, text_pos.y),
+                font, 30,
+                ImVec2(text_pos.x - font->CalcTextSizeA(30, region.x, region.x, m_Calc.GetExpression().c_str()).x, text_pos.y),
                 ImColor(190, 190, 190),
                 m_Calc.GetExpression().c_str());
 
-            m_DrawList->AddText(
-                ImGui::GetFont(), 60,
-                ImVec2(text_pos.x -  ImGui::GetFont()->CalcTextSizeA(60, region.x, region.x, m_Calc.GetOperand2().c_str()).x, text_pos.y + 40),
-                ImColor(255, 255, 255),
-                m_Calc.GetOperand2().c_str(), nullptr, pos1.x + region.x);
-
-            ImVec2 grid_pos = pos1;
-            grid_pos.y += region.y - m_GridSize * 4 - 5;
-            for (int i = 0; i < 3; i++)
+            std::string operand2 = m_Calc.GetOperand2();
+            if (IsEvaluating() && InputClockNow() - m_EvaluationStart > PROGRESS_DELAY_NS)
             {
-                for (int j = 0; j < 3; j++)
+                // Only a paste reports progress, '=' is too short to
+                operand2 = "...";
+                if (m_Paste)
                 {
-                    KEY key = NUM_KEYS[i + j * 3 + 1];
-                    createButtons(
-                        key,
-                        ImVec2(grid_pos.x + i * m_GridSize, grid_pos.y + j * m_GridSize),
-                        m_Focused[key.first], true);
+                    char progress[16];
+                    snprintf(progress, sizeof(progress), "... %d%%", (int)(m_Paste->Progress.load(std::memory_order_relaxed) * 100.0f));
+                    operand2 = progress;
                 }
             }
+            m_DrawList->AddText(
+                font, 60,
+                ImVec2(text_pos.x - font->CalcTextSizeA(60, region.x, region.x, operand2.c_str()).x, text_pos.y + 40),
+                ImColor(255, 255, 255),
+                operand2.c_str(), nullptr, pos1.x + region.x);
+            std::string preview = m_Calc.GetPreview();
+            if (!preview.empty() && !IsEvaluating())
+            {
+                preview = "= " + preview;
+                m_DrawList->AddText(
+                    font, 20,
+                    ImVec2(text_pos.x - font->CalcTextSizeA(20, region.x, region.x, preview.c_str()).x, text_pos.y + 100),
+                    ImColor(140, 140, 140),
+                    preview.c_str(), nullptr, pos1.x + region.x);
+            }
+            if (m_DisplayFontSdf)
+                EndSdfText(m_DrawList);
 
-            for (int i = 0; i < 4; i++)
+            Layout(region);
+            ImVec2 grid_pos = ImVec2(pos1.x + m_GridOrigin.x, pos1.y + m_GridOrigin.y);
+            for (int id = 0; id < Key_COUNT; id++)
             {
-                KEY key = SPECIAL_KEYS[i];
+                const KeyDesc &key = KEYS[id];
+                if (key.Col < 0)
+                    continue;
                 createButtons(
-                    key,
-                    ImVec2(grid_pos.x + 3 * m_GridSize, grid_pos.y + i * m_GridSize),
-                    m_Focused[key.first],
-                    false);
+                    (KeyId)id,
+                    ImVec2(grid_pos.x + key.Col * m_GridSize, grid_pos.y + key.Row * m_GridSize),
+                    m_Focused.test(id),
+                    key.Dark);
             }
+        }
 
-            createButtons(
-                NUM_KEYS[0],
-                ImVec2(grid_pos.x + m_GridSize, grid_pos.y + m_GridSize * 3),
-                m_Focused[NUM_KEYS[0].first],
-                true);
+        // Keys are pressed on release, and highlighted while held down
+        void OnKeyEvent(ImGuiKey key, bool down)
+        {
+            if (!down && key == ImGuiKey_Backspace)
+            {
+                m_Calc.OnBackspacePressed();
+                return;
+            }
+            if (!down && key == ImGuiKey_Escape)
+            {
+                m_Calc.Reset();
+                return;
+            }
 
-            createButtons(
-                SPECIAL_KEYS[4],
-                ImVec2(grid_pos.x, grid_pos.y + m_GridSize * 3),
-                m_Focused[SPECIAL_KEYS[4].first],
-                false);
+            KeyId id = KeyFromImGuiKey(key);
+            if (id == Key_None)
+                return;
 
-            createButtons(
-                SPECIAL_KEYS[5],
-                ImVec2(grid_pos.x + m_GridSize * 2, grid_pos.y + m_GridSize * 3),
-                m_Focused[SPECIAL_KEYS[5].first],
-                false);
+            if (down)
+            {
+                m_Focused.set(id);
+                return;
+            }
+            pressKey(id);
+            m_Focused.reset(id);
         }
 
-        void HandleKeyboardInput()
+        void OnInputEvent(const InputEvent &event)
         {
-            // HANDLE NUM KEYS
-            for (auto a : NUM_KEYS)
+            PROFILE_SCOPE("CalculatorScreen::OnInputEvent");
+            if (IsEvaluating() && event.Type != InputEventType::MouseMove)
             {
-                if (ImGui::IsKeyDown(a.second))
-                    m_Focused[a.first] = true;
-
-                if (ImGui::IsKeyReleased(a.second))
+                // Escape gives up on the evaluation as soon as it is pressed, anything else waits its turn
+                if (event.Type == InputEventType::Key && event.Key == ImGuiKey_Escape && event.Down)
                 {
-                    m_Calc.OnNumKeyPressed(a.first);
-                    m_Focused[a.first] = false;
+                    CancelEvaluation();
+                    m_Calc.Reset();
                 }
+                else
+                    m_Deferred.push_back(event);
+                return;
             }
-
-            // HANDLE SPECIAL KEYS
-            for (auto a : SPECIAL_KEYS)
+            switch (event.Type)
             {
-                if (ImGui::IsKeyDown(a.second))
-                    m_Focused[a.first] = true;
+            case InputEventType::Key:
+                // A key press is followed by the character it types, which must not be applied a second time
+                m_SuppressChar = event.Down && event.Key != ImGuiKey_None;
+                OnKeyEvent(event.Key, event.Down);
+                break;
 
-                if (ImGui::IsKeyReleased(a.second))
-                {
-                    m_Calc.OnSpecialKeyPressed(a.first);
-                    m_Focused[a.first] = false;
-                }
+            case InputEventType::Char:
+            {
+                KeyId id = KeyFromChar(event.Char);
+                if (!m_SuppressChar && id != Key_None)
+                    pressKey(id);
+                m_SuppressChar = false;
+                break;
             }
 
-            // HANDLE BACKSPACE
-            if (ImGui::IsKeyReleased(ImGuiKey_Backspace))
+            case InputEventType::MouseMove:
+                m_MousePos = event.MousePos;
+                break;
+
+            case InputEventType::MouseButton:
             {
-                m_Calc.OnBackspacePressed();
+                m_MousePos = event.MousePos;
+                if (event.Button != ImGuiMouseButton_Left || event.Down)
+                    break;
+                KeyId id = keyAt(event.MousePos);
+                if (id != Key_None)
+                    pressKey(id);
+                break;
             }
 
-            // HANDLE ESCAPE
-            if (ImGui::IsKeyReleased(ImGuiKey_Escape))
-            {
-                m_Calc.Reset();
+            case InputEventType::Paste:
+                paste(event.Text);
+                break;
             }
         }
     };
@@ -1,16 +1,59 @@
+#pragma once
 #include <string>
 #include <iostream>
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Evaluation.h"
+#include "Profiling/Trace.h"
 
 namespace Calculator
 {
+    // Every character GetExpression and GetOperand2 can contain, including std::to_string's "inf" and "nan"
+    static constexpr char DISPLAY_CHARS[] = " 0123456789.+-*/^=infa%()";
+
     class CalculatorData
     {
     private:
+        // The value of operand2 up to one of its characters, built from the one before, so typing or deleting a
+        // character updates the preview in constant time for any number a double holds exactly enough to read in
+        // one rounding. Past that the value comes from strtod like '=' does, so the two never round differently.
+        // Digits past what a uint64_t holds only scale the integer part, such a prefix is never Exact.
+        struct OperandPrefix
+        {
+            uint64_t Mantissa = 0;
+            int32_t Exponent = 0; // The number is Mantissa * 10^Exponent
+            int32_t FirstSignificant = 0; // Index in operand2 of the first nonzero digit
+            int32_t Significant = 0; // Digits from FirstSignificant on
+            int32_t PointExponent = 0; // The number is 0.<significant digits> * 10^PointExponent
+            bool Sticky = false; // A nonzero digit past the first MAX_SIGNIFICANT
+            bool Negative = false;
+            bool Dot = false;
+            bool Ended = false; // Past the number, eg. at a second '.', where strtod stops reading
+            bool Valid = false; // Holds a digit, or is a whole result such as "inf"
+            bool Exact = false; // Value is the number correctly rounded
+            double Value = 0.0;
+        };
+
+        // A double is correctly rounded from 767 significant digits at most. Any digits after that only decide which
+        // way a tie goes by being nonzero, so strtod reads this many and a single 1 standing in for the rest.
+        static constexpr int32_t MAX_SIGNIFICANT = 800;
+
+        // Every power of ten up to 10^22 is an exact double, as is every integer up to 2^53, so the product or
+        // quotient of the two is the correctly rounded number
+        static constexpr uint64_t EXACT_MANTISSA = 1ull << 53;
+        static constexpr double EXACT_POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
         std::string operand1;
         std::string operand2;
         std::string operation;
         std::string expression;
+        std::string preview;
+        double operand1Value = 0.0;
+        std::vector<OperandPrefix> operand2Prefixes; // One per character of operand2
 
     public:
         CalculatorData()
@@ -20,10 +63,13 @@ namespace Calculator
 
         std::string GetOperand2() { return operand2; }
         std::string GetExpression() { return expression; }
+        // What '=' would show, empty when it would do nothing
+        std::string GetPreview() { return preview; }
 
         void OnNumKeyPressed(std::string key)
         {
             updateOperands(key);
+            updatePreview();
         }
 
         void OnSpecialKeyPressed(std::string key)
@@ -41,20 +87,78 @@ namespace Calculator
             default:
                 updateOperation(key);
             }
+            updatePreview();
         }
 
         void OnBackspacePressed()
         {
             backspacePressed();
+            updatePreview();
         }
 
         void Reset()
         {
             reset();
+            updatePreview();
+        }
+
+        // '=' would compute something
+        bool CanCalculate() const
+        {
+            return !operand1.empty() && !operand2.empty() && !operation.empty();
+        }
+
+        // What '=' computes, as a job that needs none of this object, whose operands must not change until its
+        // result is given to ApplyResult. It is not cancellable and reports no progress, see evaluate.
+        EvaluationWorker::Job GetCalculation() const
+        {
+            std::string a = operand1, b = operand2;
+            char op = operation.back();
+            return [a, op, b](const CancelToken &, std::atomic<float> &)
+            { return evaluate(a, op, b); };
+        }
+
+        // An empty result, of an operand that is no number, leaves the calculator as it was
+        void ApplyResult(const std::string &ans)
+        {
+            if (!ans.empty())
+                applyAnswer(operand1 + " " + operation + " " + operand2, ans);
+        }
+
+        // A pasted expression, shown as given, which may be the start of it, and its value
+        void ApplyPaste(const std::string &shown, const std::string &ans)
+        {
+            applyAnswer(shown, ans);
+        }
+
+        // As the display shows a result
+        static std::string FormatResult(double value)
+        {
+            std::string ans = std::to_string(value);
+            return sanitizeFloat(ans);
         }
 
     private:
-        std::string sanitizeFloat(std::string &str)
+        void applyAnswer(const std::string &shown, const std::string &ans)
+        {
+            expression = shown + " =";
+            operand1 = operand2 = ans;
+            operation = "";
+            operand1Value = strtod(ans.c_str(), nullptr);
+            operand2Prefixes.clear();
+            for (char c : ans)
+                pushOperand2(c);
+            // Results such as "inf" are read whole, the characters alone are no number
+            if (!operand2Prefixes.empty() && !operand2Prefixes.back().Valid)
+            {
+                operand2Prefixes.back().Valid = true;
+                operand2Prefixes.back().Exact = true;
+                operand2Prefixes.back().Value = operand1Value;
+            }
+            updatePreview();
+        }
+
+        static std::string sanitizeFloat(std::string &str)
         {
             size_t pos = str.find_first_of('.');
             if (pos != str.npos)
@@ -86,8 +190,11 @@ namespace Calculator
             if (op == "." && operand2.empty())
             {
                 operand2 = "0";
+                pushOperand2('0');
             }
             operand2 += op;
+            for (char c : op)
+                pushOperand2(c);
         }
 
         void updateOperation(std::string op)
@@ -95,8 +202,10 @@ namespace Calculator
             if (operand1.empty())
             {
                 operand1 = operand2;
+                operand1Value = operand2Value();
             }
             operand2 = "";
+            operand2Prefixes.clear();
             operation = op;
             expression = operand1 + " " + operation;
         }
@@ -104,7 +213,10 @@ namespace Calculator
         void backspacePressed()
         {
             if (operand2.size() > 0)
+            {
                 operand2.pop_back();
+                operand2Prefixes.pop_back();
+            }
         }
 
         void reset()
@@ -113,50 +225,145 @@ namespace Calculator
             operand2 = "";
             operation = "";
             expression = "";
+            operand1Value = 0.0;
+            operand2Prefixes.clear();
         }
 
-        void calculate()
+        void pushOperand2(char c)
         {
-            std::string ans;
-            if (operand1.empty() || operand2.empty() || operation.empty())
-                return;
-            switch (operation.back())
-            {
-            case '+':
+            OperandPrefix prefix = operand2Prefixes.empty() ? OperandPrefix() : operand2Prefixes.back();
+            if (prefix.Ended)
             {
-                double temp = std::stod(operand1) + std::stod(operand2);
-                ans = std::to_string(temp);
-                break;
+                // Nothing after it counts
             }
-            case '-':
+            else if (c >= '0' && c <= '9')
             {
-                double temp = std::stod(operand1) - std::stod(operand2);
-                ans = std::to_string(temp);
-                break;
+                if (c != '0' && prefix.Significant == 0)
+                    prefix.FirstSignificant = (int32_t)operand2Prefixes.size();
+                if (c != '0' || prefix.Significant > 0)
+                {
+                    prefix.Significant++;
+                    if (!prefix.Dot)
+                        prefix.PointExponent++;
+                    if (c != '0' && prefix.Significant > MAX_SIGNIFICANT)
+                        prefix.Sticky = true;
+                }
+                else if (prefix.Dot)
+                    prefix.PointExponent--;
+                if (prefix.Mantissa <= (UINT64_MAX - 9) / 10)
+                {
+                    prefix.Mantissa = prefix.Mantissa * 10 + (c - '0');
+                    if (prefix.Dot)
+                        prefix.Exponent--;
+                }
+                else if (!prefix.Dot)
+                    prefix.Exponent++;
+                prefix.Valid = true;
+                prefix.Exact = prefix.Mantissa <= EXACT_MANTISSA && prefix.Exponent >= -22 && prefix.Exponent <= 22;
+                if (prefix.Exact)
+                {
+                    prefix.Value = prefix.Exponent < 0 ? (double)prefix.Mantissa / EXACT_POW10[-prefix.Exponent]
+                                                       : (double)prefix.Mantissa * EXACT_POW10[prefix.Exponent];
+                    if (prefix.Negative)
+                        prefix.Value = -prefix.Value;
+                }
             }
-            case '*':
+            else if (c == '.' && !prefix.Dot)
+                prefix.Dot = true;
+            else if (c == '-' && operand2Prefixes.empty())
+                prefix.Negative = true;
+            else
+                prefix.Ended = true;
+            operand2Prefixes.push_back(prefix);
+        }
+
+        // What evaluate reads operand2 as, in constant time. When the prefix is not Exact, strtod reads at most
+        // MAX_SIGNIFICANT of its digits, which rounds the same as the whole operand.
+        double operand2Value() const
+        {
+            if (operand2Prefixes.empty())
+                return 0.0;
+            const OperandPrefix &prefix = operand2Prefixes.back();
+            if (prefix.Exact)
+                return prefix.Value;
+            if (prefix.Significant == 0)
+                return prefix.Valid && prefix.Negative ? -0.0 : 0.0;
+
+            char text[MAX_SIGNIFICANT + 32];
+            char *out = text;
+            if (prefix.Negative)
+                *out++ = '-';
+            *out++ = '0';
+            *out++ = '.';
+            int32_t digits = prefix.Significant < MAX_SIGNIFICANT ? prefix.Significant : MAX_SIGNIFICANT;
+            for (const char *in = operand2.c_str() + prefix.FirstSignificant; digits > 0; in++)
             {
-                double temp = std::stod(operand1) * std::stod(operand2);
-                ans = std::to_string(temp);
-                break;
+                if (*in != '.')
+                {
+                    *out++ = *in;
+                    digits--;
+                }
             }
-            case '/':
+            if (prefix.Sticky)
+                *out++ = '1';
+            snprintf(out, text + sizeof(text) - out, "e%d", prefix.PointExponent);
+            return strtod(text, nullptr);
+        }
+
+        // Only the operation and the two operand values, so for any operand short enough to be Exact this takes as
+        // long as for one digit
+        void updatePreview()
+        {
+            PROFILE_SCOPE("CalculatorData::updatePreview");
+            preview.clear();
+            if (!CanCalculate() || !operand2Prefixes.back().Valid)
+                return;
+            preview = FormatResult(apply(operand1Value, operation.back(), operand2Value()));
+        }
+
+        static double apply(double a, char operation, double b)
+        {
+            switch (operation)
             {
-                double temp = std::stod(operand1) / std::stod(operand2);
-                ans = std::to_string(temp);
-                break;
-            }
+            case '+':
+                return a + b;
+            case '-':
+                return a - b;
+            case '*':
+                return a * b;
+            case '/':
+                return a / b;
             case '^':
-            {
-                double temp = std::pow(std::stod(operand1), std::stod(operand2));
-                ans = std::to_string(temp);
-                break;
-            }
+                return std::pow(a, b);
             }
-            expression = operand1 + " " + operation + " " + operand2 + " =";
-            ans = sanitizeFloat(ans);
-            operand1 = operand2 = ans;
-            operation = "";
+            return 0.0;
+        }
+
+        // strtod rather than std::stod, which throws for a lone "." and for a typed number past a double's range,
+        // and an exception on the evaluation worker ends the program. Out of range reads as inf or 0 instead.
+        static bool parseOperand(const std::string &operand, double &value)
+        {
+            char *end;
+            value = strtod(operand.c_str(), &end);
+            return end != operand.c_str();
+        }
+
+        // Two conversions and an operation, over in microseconds even for operands of thousands of digits, so there
+        // is nothing to cancel or report progress on. Empty when an operand is no number.
+        static std::string evaluate(const std::string &operand1, char operation, const std::string &operand2)
+        {
+            PROFILE_SCOPE("CalculatorData::calculate");
+            double a, b;
+            if (!parseOperand(operand1, a) || !parseOperand(operand2, b))
+                return std::string();
+            return FormatResult(apply(a, operation, b));
+        }
+
+        void calculate()
+        {
+            if (!CanCalculate())
+                return;
+            ApplyResult(evaluate(operand1, operation.back(), operand2));
         }
     };
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+#include "Profiling/Trace.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Calculator
+{
+    // Set by whoever gave up on a job, checked by the job between steps of its work
+    class CancelToken
+    {
+        std::atomic<bool> m_Cancelled{false};
+
+    public:
+        void Cancel() { m_Cancelled.store(true, std::memory_order_relaxed); }
+        bool IsCancelled() const { return m_Cancelled.load(std::memory_order_relaxed); }
+    };
+
+    // Runs evaluations on a thread of its own, started with the first one, so a slow one never holds up a frame.
+    // The main thread submits a job, then either waits for it a little or picks up the result on a later frame.
+    // A cancelled job is forgotten right away and whatever it returns is dropped, but there is one worker: the next
+    // job starts only once the cancelled one has noticed its token, so a long job must check it often.
+    class EvaluationWorker
+    {
+    public:
+        // Worker thread. Returns the result, and may set progress, between 0 and 1, as it goes.
+        typedef std::function<std::string(const CancelToken &cancel, std::atomic<float> &progress)> Job;
+
+        EvaluationWorker() = default;
+        EvaluationWorker(const EvaluationWorker &) = delete;
+        EvaluationWorker &operator=(const EvaluationWorker &) = delete;
+
+        ~EvaluationWorker()
+        {
+            Cancel();
+            if (!m_Thread.joinable())
+                return;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_Wake.notify_one();
+            m_Thread.join();
+        }
+
+        // Submitted and not yet taken or cancelled
+        bool IsBusy() const { return m_Current != nullptr; }
+
+        // Must not be busy
+        void Submit(Job job)
+        {
+            if (!m_Thread.joinable())
+                m_Thread = std::thread([this]() { workerMain(); });
+            m_Current = std::make_shared<State>();
+            m_Current->Fn = std::move(job);
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Queue.push_back(m_Current);
+            }
+            m_Wake.notify_one();
+        }
+
+        // Blocks for up to timeoutNs, UINT64_MAX for as long as it takes. True once the job has finished.
+        bool Wait(uint64_t timeoutNs)
+        {
+            if (!m_Current)
+                return false;
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            auto done = [this]() { return m_Current->Done; };
+            if (timeoutNs == UINT64_MAX)
+            {
+                m_Finished.wait(lock, done);
+                return true;
+            }
+            return m_Finished.wait_for(lock, std::chrono::nanoseconds(timeoutNs), done);
+        }
+
+        // Moves the result out once the job has finished, false while it still runs
+        bool TakeResult(std::string &result)
+        {
+            if (!m_Current)
+                return false;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (!m_Current->Done)
+                    return false;
+            }
+            result = std::move(m_Current->Result);
+            m_Current.reset();
+            return true;
+        }
+
+        void Cancel()
+        {
+            if (!m_Current)
+                return;
+            m_Current->Token.Cancel();
+            m_Current.reset();
+        }
+
+        // Of the current job, 0 when there is none
+        float GetProgress() const { return m_Current ? m_Current->Progress.load(std::memory_order_relaxed) : 0.0f; }
+
+    private:
+        // Shared with the worker, which may still be running a job the main thread has already cancelled
+        struct State
+        {
+            Job Fn;
+            CancelToken Token;
+            std::atomic<float> Progress{0.0f};
+            std::string Result;
+            bool Done = false; // Under m_Mutex
+        };
+
+        void workerMain()
+        {
+            TraceSetThreadName("Evaluation");
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            for (;;)
+            {
+                m_Wake.wait(lock, [this]() { return m_Stop || !m_Queue.empty(); });
+                if (m_Stop)
+                    return;
+                std::shared_ptr<State> state = std::move(m_Queue.front());
+                m_Queue.pop_front();
+                lock.unlock();
+                std::string result;
+                if (!state->Token.IsCancelled())
+                {
+                    PROFILE_SCOPE("EvaluationWorker::Job");
+                    result = state->Fn(state->Token, state->Progress);
+                }
+                lock.lock();
+                state->Result = std::move(result);
+                state->Done = true;
+                m_Finished.notify_all();
+            }
+        }
+
+        std::shared_ptr<State> m_Current; // Main thread
+        std::deque<std::shared_ptr<State>> m_Queue;
+        std::thread m_Thread;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::condition_variable m_Finished;
+        bool m_Stop = false;
+    };
+}
@@ -0,0 +1,436 @@
+#include "Calculator/ExpressionParser.h"
+#include "Profiling/Trace.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXPRESSION_PARSER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Calculator
+{
+    enum CharClass : uint8_t
+    {
+        CHAR_OTHER,
+        CHAR_NUMBER, // Digit or '.'
+        CHAR_SPACE,
+    };
+
+    typedef std::array<uint8_t, 256> CharClasses;
+
+    static constexpr CharClasses buildCharClasses()
+    {
+        CharClasses classes = {};
+        for (int c = '0'; c <= '9'; c++)
+            classes[c] = CHAR_NUMBER;
+        classes['.'] = CHAR_NUMBER;
+        classes[' '] = classes['\t'] = classes['\n'] = classes['\r'] = CHAR_SPACE;
+        return classes;
+    }
+
+    // For the bytes the vector loop leaves over
+    static constexpr CharClasses CHAR_CLASSES = buildCharClasses();
+
+    // 64 for no bit set
+    static inline int countTrailingZeros(uint64_t bits)
+    {
+        if (bits == 0)
+            return 64;
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int count = 0;
+        for (; (bits & 1) == 0; bits >>= 1)
+            count++;
+        return count;
+#endif
+    }
+
+    static inline int countTrailingOnes(uint64_t bits) { return countTrailingZeros(~bits); }
+
+    // Up to 10^15 every integer of up to 15 digits and the power it is divided by are exact doubles, so a single
+    // division rounds the number correctly
+    static constexpr int FAST_DIGITS = 15;
+    static constexpr double POW10[FAST_DIGITS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                                                      1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+    struct CharMasks
+    {
+        uint64_t Number; // Bit per byte, from the first
+        uint64_t Space;
+    };
+
+    // The first size bytes, at most 64. The bits past them are clear in both masks.
+    static CharMasks classify(const char *p, size_t size)
+    {
+        CharMasks masks = {};
+#ifdef EXPRESSION_PARSER_SSE2
+        if (size == 64)
+        {
+            const __m128i belowDigits = _mm_set1_epi8('0' - 1), aboveDigits = _mm_set1_epi8('9' + 1), dot = _mm_set1_epi8('.');
+            const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i c = _mm_loadu_si128((const __m128i *)(p + i * 16));
+                __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, belowDigits), _mm_cmplt_epi8(c, aboveDigits));
+                __m128i number = _mm_or_si128(digit, _mm_cmpeq_epi8(c, dot));
+                __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, space), _mm_cmpeq_epi8(c, tab)),
+                                             _mm_or_si128(_mm_cmpeq_epi8(c, lf), _mm_cmpeq_epi8(c, cr)));
+                masks.Number |= (uint64_t)(uint32_t)_mm_movemask_epi8(number) << (i * 16);
+                masks.Space |= (uint64_t)(uint32_t)_mm_movemask_epi8(blank) << (i * 16);
+            }
+            return masks;
+        }
+#endif
+        for (size_t i = 0; i < size; i++)
+        {
+            uint8_t charClass = CHAR_CLASSES[(uint8_t)p[i]];
+            masks.Number |= (uint64_t)(charClass == CHAR_NUMBER) << i;
+            masks.Space |= (uint64_t)(charClass == CHAR_SPACE) << i;
+        }
+        return masks;
+    }
+
+    // For a number longer than what was classified
+    static const char *skipNumber(const char *p, const char *end)
+    {
+        while (end - p >= 64)
+        {
+            uint64_t other = ~classify(p, 64).Number;
+            if (other != 0)
+                return p + countTrailingZeros(other);
+            p += 64;
+        }
+        while (p < end && CHAR_CLASSES[(uint8_t)*p] == CHAR_NUMBER)
+            p++;
+        return p;
+    }
+
+    typedef std::array<uint8_t, 256> Precedences;
+
+    // 0 for anything but an operator, including '(', which is never reduced by another operator. 'n' stands for a
+    // unary minus on the operator stack.
+    static constexpr Precedences buildPrecedences()
+    {
+        Precedences precedences = {};
+        precedences['+'] = precedences['-'] = 1;
+        precedences['*'] = precedences['/'] = 2;
+        precedences['n'] = 3;
+        precedences['^'] = 4;
+        return precedences;
+    }
+
+    static constexpr Precedences PRECEDENCES = buildPrecedences();
+
+    static inline int precedence(char op)
+    {
+        return PRECEDENCES[(uint8_t)op];
+    }
+
+    static inline bool isBinaryOperator(char c)
+    {
+        return precedence(c) != 0 && c != 'n';
+    }
+
+    void ExpressionParser::Reset()
+    {
+        m_Arena.Clear();
+        m_Operands.clear();
+        m_Operators.clear();
+        m_Carry.clear();
+        m_ExpectOperand = true;
+        m_Offset = 0;
+        m_TokenOffset = 0;
+        m_Error = nullptr;
+        m_ErrorOffset = 0;
+        m_Stats = Stats();
+    }
+
+    void ExpressionParser::Reserve(size_t textBytes)
+    {
+        // A number and an operator take two bytes at least, which is as dense as a pasted expression usually gets.
+        // A denser one grows the arena as it goes.
+        m_Arena.Reserve((uint32_t)std::min<size_t>(textBytes / 2, UINT32_MAX));
+    }
+
+    bool ExpressionParser::fail(const char *error, uint64_t offset)
+    {
+        if (m_Error == nullptr)
+        {
+            m_Error = error;
+            m_ErrorOffset = offset;
+        }
+        return false;
+    }
+
+    bool ExpressionParser::Feed(const char *data, size_t size)
+    {
+        if (m_Error != nullptr)
+            return false;
+        const char *p = data, *end = data + size;
+        if (!m_Carry.empty())
+        {
+            const char *q = skipNumber(p, end);
+            m_Carry.append(p, q);
+            if (q == end)
+            {
+                m_Offset += size;
+                m_Stats.Bytes += size;
+                return true;
+            }
+            bool ok = pushNumber(m_Carry.data(), m_Carry.data() + m_Carry.size());
+            m_Stats.StackBytes = std::max(m_Stats.StackBytes, m_Carry.capacity());
+            m_Carry.clear();
+            if (!ok)
+                return false;
+            p = q;
+        }
+
+        while (p < end)
+        {
+            size_t window = std::min<size_t>(end - p, 64);
+            CharMasks masks = classify(p, window);
+            size_t i = 0;
+            while (i < window)
+            {
+                if (masks.Number >> i & 1)
+                {
+                    m_TokenOffset = m_Offset + (p + i - data);
+                    const char *q = p + i + countTrailingOnes(masks.Number >> i);
+                    if (q == p + window)
+                    {
+                        q = skipNumber(q, end);
+                        if (q == end)
+                        {
+                            // May go on in the next piece
+                            m_Carry.assign(p + i, end);
+                            i = end - p;
+                            break;
+                        }
+                    }
+                    if (!pushNumber(p + i, q))
+                        return false;
+                    i = q - p;
+                }
+                else if (masks.Space >> i & 1)
+                    i += countTrailingOnes(masks.Space >> i);
+                else
+                {
+                    m_TokenOffset = m_Offset + (p + i - data);
+                    if (!pushOperator(p[i]))
+                        return false;
+                    i++;
+                }
+            }
+            p += i;
+        }
+        m_Offset += size;
+        m_Stats.Bytes += size;
+        return true;
+    }
+
+    bool ExpressionParser::Finish()
+    {
+        if (m_Error != nullptr)
+            return false;
+        if (!m_Carry.empty())
+        {
+            bool ok = pushNumber(m_Carry.data(), m_Carry.data() + m_Carry.size());
+            m_Stats.StackBytes = std::max(m_Stats.StackBytes, m_Carry.capacity());
+            m_Carry.clear();
+            if (!ok)
+                return false;
+        }
+        if (m_ExpectOperand)
+            return fail(m_Operands.empty() && m_Operators.empty() ? "no expression" : "expression ends without an operand", m_Offset);
+        // Capacities only grow during a parse, so this is their peak
+        m_Stats.StackBytes = std::max(m_Stats.StackBytes, m_Operands.capacity() * sizeof(uint32_t) + m_Operators.capacity());
+        while (!m_Operators.empty())
+        {
+            if (m_Operators.back() == '(')
+                return fail("unmatched '('", m_Offset);
+            reduce();
+        }
+        m_Stats.Nodes = m_Arena.Size();
+        m_Stats.ArenaBytes = m_Arena.GetReservedBytes();
+        return true;
+    }
+
+    bool ExpressionParser::Parse(const char *text, size_t size, const CancelToken &cancel, std::atomic<float> &progress)
+    {
+        PROFILE_SCOPE("ExpressionParser::Parse");
+        uint64_t start = TraceClockNow();
+        Reset();
+        for (size_t at = 0; at < size; at += CHUNK_SIZE)
+        {
+            if (cancel.IsCancelled())
+                return fail("cancelled", at);
+            if (!Feed(text + at, std::min(CHUNK_SIZE, size - at)))
+                return false;
+            progress.store((float)std::min(at + CHUNK_SIZE, size) / size, std::memory_order_relaxed);
+        }
+        bool ok = Finish();
+        m_Stats.ParseMs = (TraceClockNow() - start) / 1.0e6;
+        return ok;
+    }
+
+    bool ExpressionParser::pushNumber(const char *begin, const char *end)
+    {
+        if (!m_ExpectOperand)
+            return fail("missing operator before a number", m_TokenOffset);
+        uint64_t mantissa = 0;
+        int digits = 0, fraction = 0;
+        bool dot = false;
+        for (const char *p = begin; p < end; p++)
+        {
+            if (*p == '.')
+            {
+                if (dot)
+                    return fail("number with two '.'", m_TokenOffset);
+                dot = true;
+                continue;
+            }
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+            fraction += dot;
+        }
+        if (digits == 0)
+            return fail("'.' without digits", m_TokenOffset);
+
+        double value;
+        if (digits <= FAST_DIGITS)
+            value = fraction == 0 ? (double)mantissa : (double)mantissa / POW10[fraction];
+        else
+        {
+            std::from_chars_result result = std::from_chars(begin, end, value);
+            if (result.ptr != end || result.ec != std::errc())
+                return fail("number out of range", m_TokenOffset);
+        }
+
+        m_Operands.push_back(m_Arena.PushNumber(value));
+        m_ExpectOperand = false;
+        m_Stats.Numbers++;
+        return true;
+    }
+
+    bool ExpressionParser::pushOperator(char c)
+    {
+        if (m_ExpectOperand)
+        {
+            switch (c)
+            {
+            case '(':
+                m_Operators.push_back('(');
+                return true;
+            case '-':
+                m_Operators.push_back('n');
+                return true;
+            case '+':
+                return true;
+            }
+            return fail(isBinaryOperator(c) || c == ')' ? "operator without an operand" : "unexpected character", m_TokenOffset);
+        }
+
+        if (c == ')')
+        {
+            while (!m_Operators.empty() && m_Operators.back() != '(')
+                reduce();
+            if (m_Operators.empty())
+                return fail("unmatched ')'", m_TokenOffset);
+            m_Operators.pop_back();
+            return true;
+        }
+
+        if (!isBinaryOperator(c))
+            return fail(c == '(' ? "missing operator before '('" : "unexpected character", m_TokenOffset);
+        int rank = precedence(c);
+        // ^ is right associative, everything else left associative
+        while (!m_Operators.empty() && m_Operators.back() != '(' &&
+               (precedence(m_Operators.back()) > rank || (precedence(m_Operators.back()) == rank && c != '^')))
+            reduce();
+        m_Operators.push_back(c);
+        m_ExpectOperand = true;
+        return true;
+    }
+
+    void ExpressionParser::reduce()
+    {
+        char op = m_Operators.back();
+        m_Operators.pop_back();
+        uint32_t left = 0;
+        if (op != 'n')
+        {
+            m_Operands.pop_back();
+            left = m_Operands.back();
+        }
+        m_Operands.back() = m_Arena.PushOperator(op, left);
+    }
+
+    double ExpressionParser::Evaluate()
+    {
+        PROFILE_SCOPE("ExpressionParser::Evaluate");
+        uint64_t start = TraceClockNow();
+        uint32_t count = m_Arena.Size();
+        double previous = 0.0; // Node i - 1, the right operand
+        for (uint32_t first = 0; first < count; first += ExprArena::BLOCK_NODES)
+        {
+            ExprArena::Block &block = m_Arena.GetBlock(first >> ExprArena::BLOCK_SHIFT);
+            uint32_t size = std::min(count - first, ExprArena::BLOCK_NODES);
+            for (uint32_t i = 0; i < size; i++)
+            {
+                ExprNode &node = block.Nodes[i];
+                switch (block.Ops[i])
+                {
+                case 0:
+                    break;
+                case 'n':
+                    node.Value = -previous;
+                    break;
+                case '+':
+                    node.Value = m_Arena[node.Left].Value + previous;
+                    break;
+                case '-':
+                    node.Value = m_Arena[node.Left].Value - previous;
+                    break;
+                case '*':
+                    node.Value = m_Arena[node.Left].Value * previous;
+                    break;
+                case '/':
+                    node.Value = m_Arena[node.Left].Value / previous;
+                    break;
+                case '^':
+                    node.Value = pow(m_Arena[node.Left].Value, previous);
+                    break;
+                }
+                previous = node.Value;
+            }
+        }
+        m_Stats.EvaluateMs = (TraceClockNow() - start) / 1.0e6;
+        return previous;
+    }
+
+    void ExpressionParser::Report(FILE *out) const
+    {
+        if (m_Error != nullptr)
+        {
+            fprintf(out, "[paste] %s at byte %llu\n", m_Error, (unsigned long long)m_ErrorOffset);
+            return;
+        }
+        double seconds = std::max(m_Stats.ParseMs / 1000.0, 1e-9);
+        fprintf(out, "[paste] %.1f MB, %llu numbers, %u nodes: parsed in %.1f ms (%.0f MB/s), evaluated in %.1f ms\n",
+                m_Stats.Bytes / 1.0e6, (unsigned long long)m_Stats.Numbers, m_Stats.Nodes, m_Stats.ParseMs,
+                m_Stats.Bytes / seconds / 1.0e6, m_Stats.EvaluateMs);
+        fprintf(out, "[paste] arena %.1f MiB (%u bytes a node), stacks %.1f KiB\n", m_Stats.ArenaBytes / 1048576.0,
+                (uint32_t)(sizeof(ExprNode) + 1), m_Stats.StackBytes / 1024.0);
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include "Calculator/Evaluation.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Calculator
+{
+    // Nodes are allocated after their operands, so a right operand, or the operand of a negation, is always the node
+    // right before its operator and only the left one needs storing
+    union ExprNode
+    {
+        double Value;  // Number, and every node once evaluated
+        uint32_t Left; // Binary operator: the left operand's index
+    };
+    static_assert(sizeof(ExprNode) == 8, "A paste of many megabytes has tens of millions of nodes");
+
+    // Nodes in fixed blocks that are never moved or freed one by one, addressed by 32-bit index. Each node's
+    // operator is kept apart from it, 0 for a number and 'n' for a negation, so a node is no bigger than a double.
+    class ExprArena
+    {
+    public:
+        static constexpr uint32_t BLOCK_SHIFT = 16;
+        static constexpr uint32_t BLOCK_NODES = 1u << BLOCK_SHIFT; // 576 KiB
+
+        struct Block
+        {
+            ExprNode Nodes[BLOCK_NODES];
+            uint8_t Ops[BLOCK_NODES];
+        };
+
+        uint32_t PushNumber(double value)
+        {
+            uint32_t slot = allocate();
+            m_Block->Nodes[slot].Value = value;
+            m_Block->Ops[slot] = 0;
+            return m_Count++;
+        }
+
+        uint32_t PushOperator(char op, uint32_t left)
+        {
+            uint32_t slot = allocate();
+            m_Block->Nodes[slot].Left = left;
+            m_Block->Ops[slot] = (uint8_t)op;
+            return m_Count++;
+        }
+
+        ExprNode &operator[](uint32_t index) { return m_Blocks[index >> BLOCK_SHIFT]->Nodes[index & (BLOCK_NODES - 1)]; }
+        Block &GetBlock(uint32_t block) { return *m_Blocks[block]; }
+
+        // Allocates the blocks for this many nodes up front, so a parse does not stop to allocate
+        void Reserve(uint32_t nodes)
+        {
+            size_t blocks = ((size_t)nodes + BLOCK_NODES - 1) >> BLOCK_SHIFT;
+            m_Blocks.reserve(blocks);
+            while (m_Blocks.size() < blocks)
+                m_Blocks.emplace_back(new Block);
+        }
+
+        // Keeps the blocks for the next parse
+        void Clear()
+        {
+            m_Count = 0;
+            m_Block = nullptr;
+        }
+
+        uint32_t Size() const { return m_Count; }
+        size_t GetReservedBytes() const { return m_Blocks.size() * sizeof(Block); }
+
+    private:
+        uint32_t allocate()
+        {
+            uint32_t slot = m_Count & (BLOCK_NODES - 1);
+            if (slot == 0 || m_Block == nullptr)
+            {
+                if ((m_Count >> BLOCK_SHIFT) == m_Blocks.size())
+                    m_Blocks.emplace_back(new Block);
+                m_Block = m_Blocks[m_Count >> BLOCK_SHIFT].get();
+            }
+            return slot;
+        }
+
+        std::vector<std::unique_ptr<Block>> m_Blocks;
+        Block *m_Block = nullptr; // Holding node m_Count
+        uint32_t m_Count = 0;
+    };
+
+    // Parses an expression of numbers, + - * / ^, unary minus and parentheses as it arrives, in pieces split
+    // anywhere, into an ExprArena. Nothing but a number cut by the end of a piece is kept between pieces, and the
+    // operator precedence stacks only grow with nesting, so memory follows the size of the tree and not of the text.
+    // The text is classified 64 bytes at a time into bitmasks of number and whitespace characters, with SSE2 where
+    // available, and tokens are then found with bit scans rather than byte by byte.
+    class ExpressionParser
+    {
+    public:
+        // What Parse feeds at a time, between which it reports progress and checks for cancellation
+        static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+        struct Stats
+        {
+            uint64_t Bytes = 0;
+            uint64_t Numbers = 0;
+            uint32_t Nodes = 0;
+            size_t ArenaBytes = 0; // Reserved by the arena
+            size_t StackBytes = 0; // Peak of the precedence stacks and the number carried between pieces
+            double ParseMs = 0.0;
+            double EvaluateMs = 0.0;
+        };
+
+        void Reset();
+        // Sizes the arena for a text of this many bytes. Kept across Reset, so a parser reused for texts of about
+        // the same size allocates nothing after the first.
+        void Reserve(size_t textBytes);
+
+        // False once the text is known to be malformed, see GetError
+        bool Feed(const char *data, size_t size);
+        // After the last Feed. False if the text ended inside the expression.
+        bool Finish();
+
+        // The whole text in CHUNK_SIZE pieces. False when malformed or cancelled.
+        bool Parse(const char *text, size_t size, const CancelToken &cancel, std::atomic<float> &progress);
+
+        // Folds the tree into the value of its root in one pass over the arena, which works as every node was
+        // allocated after its operands. The tree is gone afterwards. After a successful Finish.
+        double Evaluate();
+
+        const char *GetError() const { return m_Error; }
+        uint64_t GetErrorOffset() const { return m_ErrorOffset; }
+        const Stats &GetStats() const { return m_Stats; }
+        void Report(FILE *out) const;
+
+    private:
+        bool fail(const char *error, uint64_t offset);
+        bool pushNumber(const char *begin, const char *end);
+        bool pushOperator(char c);
+        void reduce();
+
+        ExprArena m_Arena;
+        std::vector<uint32_t> m_Operands;
+        std::vector<char> m_Operators; // Pending, with '(' and 'n' for a unary minus
+        std::string m_Carry;           // Number cut by the end of the last piece
+        bool m_ExpectOperand = true;
+        uint64_t m_Offset = 0; // Of the next piece in the whole text
+        uint64_t m_TokenOffset = 0;
+        const char *m_Error = nullptr;
+        uint64_t m_ErrorOffset = 0;
+        Stats m_Stats;
+    };
+}
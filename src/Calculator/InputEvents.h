@@ -0,0 +1,70 @@
+#pragma once
+#include "imgui.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Calculator
+{
+    enum class InputEventType : uint8_t
+    {
+        Key,
+        Char,
+        MouseButton,
+        MouseMove,
+        Paste
+    };
+
+    struct InputEvent
+    {
+        InputEventType Type;
+        bool Down = false;             // Key, MouseButton
+        ImGuiKey Key = ImGuiKey_None;  // Key, ImGuiKey_None for keys the calculator does not bind
+        uint32_t Char = 0;             // Char
+        int Button = 0;                // MouseButton
+        ImVec2 MousePos;               // MouseButton, MouseMove, in window coordinates. -FLT_MAX once the cursor left the window
+        std::shared_ptr<const std::string> Text; // Paste, shared by every copy of the event
+        uint64_t Timestamp = 0;        // InputClockNow() when the event was received
+    };
+
+    static inline uint64_t InputClockNow()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Filled by the GLFW callbacks while glfwPollEvents runs and drained once per frame.
+    // Both happen on the main thread, and the storage is reused so steady state does not allocate.
+    class InputQueue
+    {
+        std::vector<InputEvent> m_Events;
+
+    public:
+        void Push(const InputEvent &event)
+        {
+            m_Events.push_back(event);
+        }
+
+        void PushPaste(const char *text, uint64_t timestamp)
+        {
+            InputEvent event = {InputEventType::Paste};
+            event.Text = std::make_shared<const std::string>(text);
+            event.Timestamp = timestamp;
+            m_Events.push_back(event);
+        }
+
+        bool Empty() const { return m_Events.empty(); }
+
+        // Calls fn for every queued event in arrival order, then empties the queue
+        template <typename Fn>
+        void Drain(Fn &&fn)
+        {
+            for (const InputEvent &event : m_Events)
+                fn(event);
+            m_Events.clear();
+        }
+    };
+}
@@ -0,0 +1,316 @@
+#include "Calculator/InputLog.h"
+#include "Assets/Lz4.h"
+#include "Core/Hash.h"
+#include <algorithm>
+#include <string.h>
+
+namespace Calculator
+{
+    static uint32_t EncodeKey(ImGuiKey key)
+    {
+        if (key == ImGuiKey_Backspace)
+            return INPUT_LOG_KEY_BACKSPACE;
+        if (key == ImGuiKey_Escape)
+            return INPUT_LOG_KEY_ESCAPE;
+        KeyId id = KeyFromImGuiKey(key);
+        return id != Key_None ? (uint32_t)id : INPUT_LOG_KEY_NONE;
+    }
+
+    // The main-row and keypad bindings of a key behave the same, so keys come back as the keypad's
+    static ImGuiKey DecodeKey(uint32_t value)
+    {
+        if (value == INPUT_LOG_KEY_BACKSPACE)
+            return ImGuiKey_Backspace;
+        if (value == INPUT_LOG_KEY_ESCAPE)
+            return ImGuiKey_Escape;
+        return value < Key_COUNT ? KEYS[value].Keypad : ImGuiKey_None;
+    }
+
+    static void PrintIntervals(FILE *out, const char *name, std::vector<float> &samples)
+    {
+        if (samples.empty())
+            return;
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](float p)
+        { return samples[std::min(samples.size() - 1, (size_t)(p * (samples.size() - 1) + 0.5f))]; };
+        fprintf(out, "[replay] %-8s frame interval p50 %7.3f ms  p90 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+                name, percentile(0.5f), percentile(0.9f), percentile(0.99f), samples.back());
+    }
+
+    bool InputLogWriter::Open(const char *path)
+    {
+        Close();
+        m_File = fopen(path, "wb");
+        if (m_File == nullptr)
+            return false;
+        m_Path = path;
+        m_StartNs = 0;
+        m_Events = m_Frames = 0;
+        if (fwrite(INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC), 1, m_File) != 1 ||
+            fwrite(&INPUT_LOG_VERSION, sizeof(INPUT_LOG_VERSION), 1, m_File) != 1)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void InputLogWriter::Close()
+    {
+        if (m_File != nullptr)
+            fclose(m_File);
+        m_File = nullptr;
+    }
+
+    void InputLogWriter::write(const void *data, size_t size)
+    {
+        if (m_File == nullptr || size == 0)
+            return;
+        if (fwrite(data, size, 1, m_File) != 1)
+        {
+            fprintf(stderr, "[input] Could not write %s, recording stopped\n", m_Path.c_str());
+            Close();
+        }
+    }
+
+    void InputLogWriter::WriteEvent(const InputEvent &event)
+    {
+        InputLogRecord record = {};
+        uint32_t compressed = 0;
+        if (m_StartNs == 0)
+            m_StartNs = event.Timestamp;
+        record.TimeNs = event.Timestamp > m_StartNs ? event.Timestamp - m_StartNs : 0;
+        switch (event.Type)
+        {
+        case InputEventType::Key:
+            record.Kind = INPUT_LOG_KEY;
+            record.Value = EncodeKey(event.Key);
+            break;
+        case InputEventType::Char:
+            record.Kind = INPUT_LOG_CHAR;
+            record.Value = event.Char;
+            break;
+        case InputEventType::MouseButton:
+            record.Kind = INPUT_LOG_MOUSE_BUTTON;
+            break;
+        case InputEventType::MouseMove:
+            record.Kind = INPUT_LOG_MOUSE_MOVE;
+            break;
+        case InputEventType::Paste:
+            record.Kind = INPUT_LOG_PASTE;
+            record.Value = (uint32_t)std::min<size_t>(event.Text->size(), UINT32_MAX);
+            record.Hash = HashBytes(event.Text->data(), event.Text->size());
+            // A few milliseconds a megabyte, only a paste that large costs a frame
+            if (event.Text->size() <= UINT32_MAX)
+            {
+                PROFILE_SCOPE("InputLogWriter::compressPaste");
+                m_Compressed.resize(Lz4CompressBound(event.Text->size()));
+                size_t size = Lz4Compress((const uint8_t *)event.Text->data(), event.Text->size(), m_Compressed.data(), m_Compressed.size());
+                compressed = size <= UINT32_MAX ? (uint32_t)size : 0;
+            }
+            break;
+        }
+        record.Down = event.Down;
+        record.Button = (uint8_t)event.Button;
+        record.X = event.MousePos.x;
+        record.Y = event.MousePos.y;
+        write(&record, sizeof(record));
+        if (record.Kind == INPUT_LOG_PASTE)
+        {
+            write(&compressed, sizeof(compressed));
+            write(m_Compressed.data(), compressed);
+        }
+        m_Events++;
+    }
+
+    void InputLogWriter::WriteFrame(uint64_t hash, bool evaluating)
+    {
+        uint64_t now = InputClockNow();
+        if (m_StartNs == 0)
+            m_StartNs = now;
+        InputLogRecord record = {};
+        record.TimeNs = now - m_StartNs;
+        record.Hash = hash;
+        record.Kind = INPUT_LOG_FRAME;
+        record.Down = evaluating;
+        write(&record, sizeof(record));
+        if (++m_Frames % FLUSH_FRAMES == 0 && m_File != nullptr)
+            fflush(m_File);
+    }
+
+    void InputLogWriter::Report(FILE *out) const
+    {
+        fprintf(out, "[input] %u events over %u frames recorded to %s\n", m_Events, m_Frames, m_Path.c_str());
+    }
+
+    bool InputReplay::Open(const char *path, bool unthrottled)
+    {
+        m_Path = path;
+        m_Unthrottled = unthrottled;
+        m_FrameEnds.clear();
+        m_Next = 0;
+        m_Frame = 0;
+        m_StartNs = m_LastStepNs = 0;
+        m_Mismatches = 0;
+        m_Uncompared = 0;
+        m_PasteFrame = UINT32_MAX;
+        m_Pastes = 0;
+        m_RecordedMs.clear();
+        m_ReplayedMs.clear();
+        const size_t header = sizeof(INPUT_LOG_MAGIC) + sizeof(uint32_t);
+        uint32_t version = 0;
+        if (!m_File.Open(path) || m_File.Size() < header || memcmp(m_File.Data(), INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC)) != 0)
+        {
+            m_File.Close();
+            return false;
+        }
+        memcpy(&version, m_File.Data() + sizeof(INPUT_LOG_MAGIC), sizeof(version));
+        if (version == 0 || version > INPUT_LOG_VERSION)
+        {
+            m_File.Close();
+            return false;
+        }
+        m_Version = version;
+        // Events after the last frame record, cut short by a crash, are never applied
+        for (size_t offset = header; m_File.Size() - offset >= sizeof(InputLogRecord);)
+        {
+            InputLogRecord record = readRecord(offset);
+            if (record.Kind == INPUT_LOG_FRAME)
+                m_FrameEnds.push_back(offset);
+            offset = nextRecord(offset, record);
+            if (offset == 0)
+                break;
+        }
+        m_Next = header;
+        m_RecordedMs.reserve(m_FrameEnds.size());
+        m_ReplayedMs.reserve(m_FrameEnds.size());
+        return true;
+    }
+
+    size_t InputReplay::nextRecord(size_t offset, const InputLogRecord &record) const
+    {
+        offset += sizeof(InputLogRecord);
+        if (record.Kind != INPUT_LOG_PASTE || m_Version < 3)
+            return offset;
+        uint32_t compressed;
+        if (m_File.Size() - offset < sizeof(compressed))
+            return 0;
+        memcpy(&compressed, m_File.Data() + offset, sizeof(compressed));
+        offset += sizeof(compressed);
+        return m_File.Size() - offset < compressed ? 0 : offset + compressed;
+    }
+
+    std::shared_ptr<const std::string> InputReplay::readPaste(size_t offset, const InputLogRecord &record) const
+    {
+        if (m_Version < 3)
+            return nullptr;
+        offset += sizeof(InputLogRecord);
+        uint32_t compressed;
+        memcpy(&compressed, m_File.Data() + offset, sizeof(compressed));
+        if (compressed == 0)
+            return nullptr;
+        std::string text(record.Value, '\0');
+        if (!Lz4Decompress(m_File.Data() + offset + sizeof(compressed), compressed, (uint8_t *)text.data(), text.size()) ||
+            HashBytes(text.data(), text.size()) != record.Hash)
+            return nullptr;
+        return std::make_shared<const std::string>(std::move(text));
+    }
+
+    bool InputReplay::Step(CalculatorScreen &screen)
+    {
+        PROFILE_SCOPE("InputReplay::Step");
+        uint64_t now = InputClockNow();
+        if (m_StartNs == 0)
+            m_StartNs = now;
+        else
+            m_ReplayedMs.push_back((float)((now - m_LastStepNs) / 1.0e6));
+        m_LastStepNs = now;
+
+        while (m_Frame < m_FrameEnds.size())
+        {
+            InputLogRecord frame = readRecord(m_FrameEnds[m_Frame]);
+            if (!m_Unthrottled && now - m_StartNs < frame.TimeNs - readRecord(m_FrameEnds[0]).TimeNs)
+                break;
+            for (; m_Next < m_FrameEnds[m_Frame]; m_Next = nextRecord(m_Next, readRecord(m_Next)))
+            {
+                InputLogRecord r = readRecord(m_Next);
+                InputEvent event = {InputEventType::Key};
+                switch (r.Kind)
+                {
+                case INPUT_LOG_KEY:
+                    event.Key = DecodeKey(r.Value);
+                    break;
+                case INPUT_LOG_CHAR:
+                    event.Type = InputEventType::Char;
+                    event.Char = r.Value;
+                    break;
+                case INPUT_LOG_MOUSE_BUTTON:
+                    event.Type = InputEventType::MouseButton;
+                    break;
+                case INPUT_LOG_MOUSE_MOVE:
+                    event.Type = InputEventType::MouseMove;
+                    break;
+                case INPUT_LOG_PASTE:
+                    event.Type = InputEventType::Paste;
+                    event.Text = readPaste(m_Next, r);
+                    if (event.Text == nullptr)
+                    {
+                        if (m_PasteFrame == UINT32_MAX)
+                        {
+                            m_PasteFrame = m_Frame;
+                            m_PasteRecord = m_Next;
+                        }
+                        continue;
+                    }
+                    m_Pastes++;
+                    break;
+                default:
+                    continue;
+                }
+                event.Down = r.Down != 0;
+                event.Button = r.Button;
+                event.MousePos = ImVec2(r.X, r.Y);
+                event.Timestamp = now;
+                screen.OnInputEvent(event);
+            }
+            if (m_Frame >= m_PasteFrame)
+            {
+                // Reported once, the rest of the session would only repeat it
+            }
+            else if (frame.Down != 0)
+                m_Uncompared++;
+            else if (screen.GetDisplayHash() != frame.Hash && m_Mismatches++ == 0)
+                m_FirstMismatch = m_Frame;
+            if (m_Frame > 0)
+                m_RecordedMs.push_back((float)((frame.TimeNs - readRecord(m_FrameEnds[m_Frame - 1]).TimeNs) / 1.0e6));
+            m_Next = m_FrameEnds[m_Frame++] + sizeof(InputLogRecord);
+            if (m_Unthrottled)
+                break;
+        }
+        return m_Frame < m_FrameEnds.size();
+    }
+
+    void InputReplay::Report(FILE *out)
+    {
+        fprintf(out, "[replay] %u of %u frames of %s replayed %s\n", m_Frame, (uint32_t)m_FrameEnds.size(), m_Path.c_str(),
+                m_Unthrottled ? "unthrottled" : "at the original speed");
+        if (m_Mismatches > 0)
+            fprintf(out, "[replay] %u frames left a different display, the first was frame %u\n", m_Mismatches, m_FirstMismatch);
+        else if (m_PasteFrame < m_Frame)
+            fprintf(out, "[replay] every frame before the paste left the recorded display\n");
+        else
+            fprintf(out, "[replay] every frame left the recorded display\n");
+        if (m_Pastes > 0)
+            fprintf(out, "[replay] %u paste%s replayed from the log\n", m_Pastes, m_Pastes == 1 ? "" : "s");
+        if (m_PasteFrame < m_Frame)
+        {
+            InputLogRecord paste = readRecord(m_PasteRecord);
+            fprintf(out, "[replay] log contains an paste without its text at frame %u (%u bytes, hash %016llx), later frames were not compared\n",
+                    m_PasteFrame, paste.Value, (unsigned long long)paste.Hash);
+        }
+        if (m_Uncompared > 0)
+            fprintf(out, "[replay] %u frames ended during an evaluation in the recording and were not compared\n", m_Uncompared);
+        PrintIntervals(out, "recorded", m_RecordedMs);
+        PrintIntervals(out, "replayed", m_ReplayedMs);
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "Calculator/Calculator.cpp"
+#include "Calculator/InputEvents.h"
+#include "Core/Files.h"
+#include <cstdint>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace Calculator
+{
+    static constexpr char INPUT_LOG_MAGIC[8] = {'C', 'A', 'L', 'C', 'I', 'N', 'P', 'T'};
+    // 2: INPUT_LOG_PASTE without the text, 3: with it. Every version still replays.
+    static constexpr uint32_t INPUT_LOG_VERSION = 3;
+
+    enum InputLogKind : uint8_t
+    {
+        INPUT_LOG_FRAME, // Closes the frame, after the events applied in it
+        INPUT_LOG_KEY,
+        INPUT_LOG_CHAR,
+        INPUT_LOG_MOUSE_BUTTON,
+        INPUT_LOG_MOUSE_MOVE,
+        INPUT_LOG_PASTE, // Followed by a uint32_t size and the text as an LZ4 block of that size, 0 if it was not stored
+    };
+
+    // Keys are stored as a KeyId or one of these rather than as an ImGuiKey, whose values change between ImGui
+    // versions, so a session still replays after an upgrade
+    static constexpr uint32_t INPUT_LOG_KEY_BACKSPACE = 0x100;
+    static constexpr uint32_t INPUT_LOG_KEY_ESCAPE = 0x101;
+    static constexpr uint32_t INPUT_LOG_KEY_NONE = 0xFFFF;
+
+    struct InputLogRecord
+    {
+        uint64_t TimeNs; // Since the first frame
+        uint64_t Hash;   // Frame: CalculatorScreen::GetDisplayHash once its events were applied, Paste: of the text
+        uint32_t Value;  // Key: see INPUT_LOG_KEY_NONE, Char: the character, Paste: the length, at most UINT32_MAX
+        float X;         // MouseButton, MouseMove
+        float Y;
+        uint8_t Kind; // InputLogKind
+        uint8_t Down; // Frame: an evaluation was still running, see InputReplay
+        uint8_t Button;
+        uint8_t Reserved;
+    };
+    static_assert(sizeof(InputLogRecord) == 32, "InputLogRecord is written as is");
+
+    // Session log: the magic and version, then the events in the order they reached the calculator screen, each
+    // frame closed by a record holding the display state it left. Writes go through stdio's buffer and are flushed
+    // every FLUSH_FRAMES frames, so a session that ends in a crash keeps all but its last moments.
+    class InputLogWriter
+    {
+    public:
+        static constexpr uint32_t FLUSH_FRAMES = 64;
+
+        ~InputLogWriter() { Close(); }
+
+        bool Open(const char *path);
+        void Close();
+        bool IsOpen() const { return m_File != nullptr; }
+
+        void WriteEvent(const InputEvent &event);
+        void WriteFrame(uint64_t hash, bool evaluating);
+
+        // After Close
+        void Report(FILE *out) const;
+
+    private:
+        void write(const void *data, size_t size);
+
+        FILE *m_File = nullptr;
+        std::vector<uint8_t> m_Compressed; // Of the last paste
+        std::string m_Path;
+        uint64_t m_StartNs = 0;
+        uint32_t m_Events = 0;
+        uint32_t m_Frames = 0;
+    };
+
+    // Feeds a session log back to a CalculatorScreen, frame by frame, and compares the display after every recorded
+    // frame with the hash the recording stored. At original speed, a recorded frame is applied once as much time has
+    // passed since the replay started as had since the recording did, possibly several in one frame when replaying
+    // falls behind. Unthrottled, every frame applies the next recorded one.
+    // Evaluations are waited for during a replay, while the recording only waited EVALUATION_BUDGET_NS, so from a
+    // frame that ended with an evaluation running until the one that applied its result, the recorded display is
+    // behind the replayed one for timing reasons alone. Those frames are not compared.
+    // Nor is any frame from the first paste whose text the log does not hold, which version 2 logs never do.
+    class InputReplay
+    {
+    public:
+        bool Open(const char *path, bool unthrottled);
+        bool IsOpen() const { return m_File.IsOpen(); }
+
+        // Once per frame, in place of the frame's live input. False once every recorded frame has been applied.
+        bool Step(CalculatorScreen &screen);
+
+        // Compares the recorded frame intervals with the replay's, which is what a slowdown shows up in
+        void Report(FILE *out);
+
+    private:
+        // Copied out, records follow a 12 byte header and are not aligned in the mapping
+        InputLogRecord readRecord(size_t offset) const
+        {
+            InputLogRecord record;
+            memcpy(&record, m_File.Data() + offset, sizeof(record));
+            return record;
+        }
+
+        // Past the record at offset and the paste text after it, 0 if the file ends first
+        size_t nextRecord(size_t offset, const InputLogRecord &record) const;
+        // Empty if the log does not hold the text or it does not match the recorded hash
+        std::shared_ptr<const std::string> readPaste(size_t offset, const InputLogRecord &record) const;
+
+        MappedFile m_File;
+        std::string m_Path;
+        uint32_t m_Version = 0;
+        bool m_Unthrottled = false;
+        std::vector<size_t> m_FrameEnds; // Offset of every frame record
+        size_t m_Next = 0;               // Offset of the next record to apply
+        uint32_t m_Frame = 0;              // Next entry of m_FrameEnds
+        uint64_t m_StartNs = 0;
+        uint64_t m_LastStepNs = 0;
+        uint32_t m_Mismatches = 0;
+        uint32_t m_FirstMismatch = 0;
+        uint32_t m_Uncompared = 0;
+        uint32_t m_PasteFrame = UINT32_MAX; // Frame of the first paste without its text
+        size_t m_PasteRecord = 0; // Offset
+        uint32_t m_Pastes = 0;    // Replayed
+        std::vector<float> m_RecordedMs;
+        std::vector<float> m_ReplayedMs;
+    };
+}
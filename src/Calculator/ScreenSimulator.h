@@ -0,0 +1,148 @@
+#pragma once
+#include "Calculator/Calculator.cpp"
+#include "Calculator/InputEvents.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Calculator
+{
+    // Steps a CalculatorScreen through an input trace as fast as it takes events, with no window, ImGui context or
+    // renderer, to measure and regression test the whole path from an input event to the calculator's state.
+    class ScreenSimulator
+    {
+    public:
+        struct Result
+        {
+            uint64_t Events = 0;
+            uint64_t Keys = 0; // Calculator keys pressed, whether typed, clicked or from the keypad
+            double Ms = 0.0;
+            std::string Expression;
+            std::string Operand2;
+        };
+
+        ScreenSimulator(ImVec2 viewportSize)
+        {
+            m_Screen.Layout(viewportSize);
+            m_Screen.SetSynchronousEvaluation(true);
+        }
+
+        // The script's characters as a user would enter them, cycling between the keypad, typing on the main row
+        // and clicking the on-screen button. The trace starts with Escape, so a run ends in the state of one pass.
+        void BuildTrace(const std::string &script)
+        {
+            m_Trace.clear();
+            m_Keys = 0;
+            pushKey(ImGuiKey_Escape);
+            uint32_t method = 0;
+            for (char c : script)
+            {
+                KeyId id = KeyFromChar((unsigned char)c);
+                if (id == Key_None)
+                    continue;
+                ImVec2 center;
+                switch (method++ % 3)
+                {
+                case 0:
+                    // GLFW reports the key, then the character it types
+                    pushEvent(InputEventType::Key, true, KEYS[id].Keypad);
+                    pushChar(c);
+                    pushEvent(InputEventType::Key, false, KEYS[id].Keypad);
+                    break;
+
+                case 1:
+                    // An unbound key, eg. Shift+8 for '*', only the character reaches the calculator
+                    pushEvent(InputEventType::Key, true, ImGuiKey_None);
+                    pushChar(c);
+                    pushEvent(InputEventType::Key, false, ImGuiKey_None);
+                    break;
+
+                case 2:
+                    if (!m_Screen.GetButtonCenter(id, center))
+                    {
+                        pushKey(KEYS[id].Keypad);
+                        break;
+                    }
+                    pushMouse(InputEventType::MouseMove, false, center);
+                    pushMouse(InputEventType::MouseButton, true, center);
+                    pushMouse(InputEventType::MouseButton, false, center);
+                    break;
+                }
+                m_Keys++;
+            }
+            // Leave the window, as the last click would otherwise keep a button hovered
+            pushMouse(InputEventType::MouseMove, false, ImVec2(-FLT_MAX, -FLT_MAX));
+        }
+
+        Result Run(uint32_t passes)
+        {
+            PROFILE_SCOPE("ScreenSimulator::Run");
+            uint64_t start = InputClockNow();
+            for (uint32_t pass = 0; pass < passes; pass++)
+                for (const InputEvent &event : m_Trace)
+                    m_Screen.OnInputEvent(event);
+            Result result;
+            result.Ms = (InputClockNow() - start) / 1.0e6;
+            result.Events = (uint64_t)m_Trace.size() * passes;
+            result.Keys = (uint64_t)m_Keys * passes;
+            result.Expression = m_Screen.GetData().GetExpression();
+            result.Operand2 = m_Screen.GetData().GetOperand2();
+            return result;
+        }
+
+        // The state the script should leave, from pressing its keys on a CalculatorData directly
+        static void Expected(const std::string &script, std::string &expression, std::string &operand2)
+        {
+            CalculatorData data;
+            for (char c : script)
+            {
+                KeyId id = KeyFromChar((unsigned char)c);
+                if (id == Key_None)
+                    continue;
+                if (id <= Key_9)
+                    data.OnNumKeyPressed(KEYS[id].Label);
+                else
+                    data.OnSpecialKeyPressed(KEYS[id].Label);
+            }
+            expression = data.GetExpression();
+            operand2 = data.GetOperand2();
+        }
+
+        const std::vector<InputEvent> &GetTrace() const { return m_Trace; }
+
+    private:
+        void pushEvent(InputEventType type, bool down, ImGuiKey key)
+        {
+            InputEvent event = {type};
+            event.Down = down;
+            event.Key = key;
+            m_Trace.push_back(event);
+        }
+
+        void pushKey(ImGuiKey key)
+        {
+            pushEvent(InputEventType::Key, true, key);
+            pushEvent(InputEventType::Key, false, key);
+        }
+
+        void pushChar(char c)
+        {
+            InputEvent event = {InputEventType::Char};
+            event.Char = (unsigned char)c;
+            m_Trace.push_back(event);
+        }
+
+        void pushMouse(InputEventType type, bool down, ImVec2 pos)
+        {
+            InputEvent event = {type};
+            event.Down = down;
+            event.Button = ImGuiMouseButton_Left;
+            event.MousePos = pos;
+            m_Trace.push_back(event);
+        }
+
+        CalculatorScreen m_Screen;
+        std::vector<InputEvent> m_Trace;
+        uint32_t m_Keys = 0;
+    };
+}
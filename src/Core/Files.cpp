@@ -0,0 +1,172 @@
+#include "Core/Files.h"
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Calculator
+{
+    std::filesystem::path GetCacheDirectory()
+    {
+        std::filesystem::path dir;
+        if (const char *env = getenv("CALCULATOR_CACHE_DIR"))
+            dir = env;
+#ifdef _WIN32
+        else if (const char *local = getenv("LOCALAPPDATA"))
+            dir = std::filesystem::path(local) / "Calculator";
+#else
+        else if (const char *xdg = getenv("XDG_CACHE_HOME"))
+            dir = std::filesystem::path(xdg) / "calculator";
+        else if (const char *home = getenv("HOME"))
+            dir = std::filesystem::path(home) / ".cache" / "calculator";
+#endif
+        std::error_code ec;
+        if (dir.empty())
+            dir = std::filesystem::temp_directory_path(ec) / "calculator";
+        std::filesystem::create_directories(dir, ec);
+        if (ec)
+        {
+            fprintf(stderr, "[files] Could not create %s: %s\n", dir.string().c_str(), ec.message().c_str());
+            return {};
+        }
+        return dir;
+    }
+
+    std::filesystem::path GetExecutableDirectory()
+    {
+#ifdef _WIN32
+        wchar_t buffer[MAX_PATH];
+        DWORD length = GetModuleFileNameW(nullptr, buffer, MAX_PATH);
+        if (length == 0 || length == MAX_PATH)
+            return {};
+        return std::filesystem::path(buffer).parent_path();
+#elif defined(__APPLE__)
+        char buffer[4096];
+        uint32_t size = sizeof(buffer);
+        if (_NSGetExecutablePath(buffer, &size) != 0)
+            return {};
+        return std::filesystem::path(buffer).parent_path();
+#else
+        std::error_code ec;
+        std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", ec);
+        return ec ? std::filesystem::path() : path.parent_path();
+#endif
+    }
+
+    bool WriteFileAtomic(const std::filesystem::path &path, const void *data, size_t size)
+    {
+        // Unique to the process and the call, as two instances may write the same cache file at once
+#ifdef _WIN32
+        unsigned long pid = (unsigned long)GetCurrentProcessId();
+#else
+        unsigned long pid = (unsigned long)getpid();
+#endif
+        char suffix[48];
+        snprintf(suffix, sizeof(suffix), ".%lu-%08x.tmp", pid, (unsigned)std::random_device()());
+        std::filesystem::path tmp = path;
+        tmp += suffix;
+        FILE *file = fopen(tmp.string().c_str(), "wb");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "[files] Could not create %s\n", tmp.string().c_str());
+            return false;
+        }
+        bool ok = fwrite(data, 1, size, file) == size;
+        ok = fclose(file) == 0 && ok;
+
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(tmp, path, ec);
+        if (!ok || ec)
+        {
+            fprintf(stderr, "[files] Could not write %s\n", path.string().c_str());
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+    bool MappedFile::Open(const std::filesystem::path &path)
+    {
+        Close();
+        HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        // The mapping keeps the file open
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+            return false;
+        void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+        m_Mapping = mapping;
+        m_Data = (const uint8_t *)data;
+        m_Size = (size_t)size.QuadPart;
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_Mapping)
+            CloseHandle((HANDLE)m_Mapping);
+        m_Data = nullptr;
+        m_Mapping = nullptr;
+        m_Size = 0;
+    }
+#else
+    bool MappedFile::Open(const std::filesystem::path &path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        // The mapping keeps the file open
+        void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        m_Data = (const uint8_t *)data;
+        m_Size = (size_t)st.st_size;
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_Data)
+            munmap((void *)m_Data, m_Size);
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+#endif
+}
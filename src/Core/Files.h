@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Calculator
+{
+    // Per-user cache directory (CALCULATOR_CACHE_DIR, else the platform cache location), created on first use.
+    // Returns an empty path if no writable location could be found.
+    std::filesystem::path GetCacheDirectory();
+
+    // Directory of the running executable, empty if it cannot be determined
+    std::filesystem::path GetExecutableDirectory();
+
+    // Writes through a temporary file of its own and a rename, so readers never see a truncated file and two
+    // processes writing the same file never rename each other's partial writes into place
+    bool WriteFileAtomic(const std::filesystem::path &path, const void *data, size_t size);
+
+    // Read-only memory mapping of a whole file
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { Close(); }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool Open(const std::filesystem::path &path);
+        void Close();
+
+        bool IsOpen() const { return m_Data != nullptr; }
+        const uint8_t *Data() const { return m_Data; }
+        size_t Size() const { return m_Size; }
+
+    private:
+        const uint8_t *m_Data = nullptr;
+        size_t m_Size = 0;
+#ifdef _WIN32
+        void *m_Mapping = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Calculator
+{
+    // FNV-1a, chain calls by passing the previous result as hash
+    static inline uint64_t HashBytes(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+    {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        return hash;
+    }
+}
@@ -0,0 +1,96 @@
+#include "Core/StartupTasks.h"
+#include <exception>
+#include <vector>
+#include "Profiling/Trace.h"
+
+namespace Calculator
+{
+    StartupTasks::StartupTasks() : m_Begin(TraceClockNow()) {}
+
+    StartupTasks::~StartupTasks()
+    {
+        WaitAll();
+    }
+
+    StartupTasks::TaskId StartupTasks::Async(const char *name, std::initializer_list<TaskId> deps, std::function<void()> fn)
+    {
+        std::vector<std::shared_future<void>> waitFor;
+        for (TaskId dep : deps)
+            waitFor.push_back(m_Tasks[dep].Done);
+
+        std::promise<void> done;
+        m_Tasks.emplace_back();
+        Task &task = m_Tasks.back();
+        task.Name = name;
+        task.Worker = true;
+        task.Done = done.get_future().share();
+        task.Thread = std::thread(
+            [&task, waitFor = std::move(waitFor), fn = std::move(fn), done = std::move(done)]() mutable
+            {
+                TraceSetThreadName(task.Name);
+                try
+                {
+                    // A failed dependency fails this task as well, with the same exception
+                    for (const std::shared_future<void> &dep : waitFor)
+                        dep.get();
+                    task.Start = TraceClockNow();
+                    {
+                        TraceZone zone(task.Name);
+                        fn();
+                    }
+                    task.End = TraceClockNow();
+                    done.set_value();
+                }
+                catch (...)
+                {
+                    done.set_exception(std::current_exception());
+                }
+            });
+        return m_Tasks.size() - 1;
+    }
+
+    void StartupTasks::Wait(TaskId id)
+    {
+        m_Tasks[id].Done.get();
+    }
+
+    void StartupTasks::WaitAll()
+    {
+        for (Task &task : m_Tasks)
+            if (task.Thread.joinable())
+                task.Thread.join();
+    }
+
+    StartupTasks::Step::Step(StartupTasks &tasks, const char *name) : m_Tasks(tasks)
+    {
+        m_Index = tasks.m_Tasks.size();
+        tasks.m_Tasks.emplace_back();
+        Task &task = tasks.m_Tasks.back();
+        task.Name = name;
+        task.Worker = false;
+        task.Start = TraceClockNow();
+    }
+
+    void StartupTasks::Step::End()
+    {
+        if (m_Ended)
+            return;
+        m_Ended = true;
+        Task &task = m_Tasks.m_Tasks[m_Index];
+        task.End = TraceClockNow();
+        // Main thread steps show up in the trace as well
+        TraceThreadBuffer()->Record(task.Name, task.Start, task.End);
+    }
+
+    void StartupTasks::PrintTimings(FILE *out) const
+    {
+        fprintf(out, "[startup] %-28s %-7s %9s %9s %9s\n", "step", "thread", "start", "end", "duration");
+        for (const Task &task : m_Tasks)
+        {
+            if (task.End == 0)
+                continue;
+            fprintf(out, "[startup] %-28s %-7s %6.1f ms %6.1f ms %6.1f ms\n", task.Name, task.Worker ? "worker" : "main",
+                    (task.Start - m_Begin) / 1.0e6, (task.End - m_Begin) / 1.0e6, (task.End - task.Start) / 1.0e6);
+        }
+    }
+}
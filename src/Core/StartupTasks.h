@@ -0,0 +1,62 @@
+#pragma once
+#include <stdio.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <thread>
+
+namespace Calculator
+{
+    // Runs independent startup steps on worker threads with explicit dependencies, and times every step
+    // (including the ones run inline on the main thread) for the --startup-timing breakdown.
+    // Task names must be string literals, they double as trace zone and thread names.
+    class StartupTasks
+    {
+    public:
+        typedef size_t TaskId;
+
+        StartupTasks();
+        ~StartupTasks();
+        StartupTasks(const StartupTasks &) = delete;
+        StartupTasks &operator=(const StartupTasks &) = delete;
+
+        // Starts fn on its own thread once every task in deps has finished
+        TaskId Async(const char *name, std::initializer_list<TaskId> deps, std::function<void()> fn);
+
+        // Blocks the calling thread until the task has finished, and rethrows what it, or a task it depended on,
+        // threw. A failed task never leaves its waiters blocked.
+        void Wait(TaskId id);
+        void WaitAll();
+
+        // Times a step run inline on the calling thread, until End() or the end of the scope
+        class Step
+        {
+            StartupTasks &m_Tasks;
+            size_t m_Index;
+            bool m_Ended = false;
+
+        public:
+            Step(StartupTasks &tasks, const char *name);
+            ~Step() { End(); }
+            void End();
+        };
+
+        void PrintTimings(FILE *out) const;
+
+    private:
+        struct Task
+        {
+            const char *Name;
+            bool Worker;
+            uint64_t Start = 0;
+            uint64_t End = 0;
+            std::shared_future<void> Done;
+            std::thread Thread;
+        };
+
+        std::deque<Task> m_Tasks; // Stable addresses, workers write their own timings
+        uint64_t m_Begin;
+    };
+}
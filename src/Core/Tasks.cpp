@@ -0,0 +1,132 @@
+#include "Core/Tasks.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include "Profiling/Trace.h"
+
+namespace Calculator
+{
+    // The coroutine behind Spawn: runs as soon as it is called and frees itself once the task has finished
+    struct TaskExecutor::Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    TaskExecutor::Detached TaskExecutor::runDetached(TaskExecutor &executor, Task<> task)
+    {
+        try
+        {
+            co_await std::move(task);
+        }
+        catch (const std::exception &e)
+        {
+            fprintf(stderr, "[tasks] Task failed: %s\n", e.what());
+        }
+        catch (...)
+        {
+            fprintf(stderr, "[tasks] Task failed\n");
+        }
+        executor.m_Live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void TaskExecutor::Start(uint32_t threads)
+    {
+        if (!m_Threads.empty())
+            return;
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        threads = std::clamp(threads, 1u, MAX_THREADS);
+        m_Stopping.store(false, std::memory_order_relaxed);
+        m_WorkersExit = false;
+        for (uint32_t i = 0; i < threads; i++)
+            m_Threads.emplace_back([this]() { workerMain(); });
+    }
+
+    void TaskExecutor::Stop()
+    {
+        m_Stopping.store(true, std::memory_order_relaxed);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(STOP_TIMEOUT_MS);
+        while (GetLiveCount() > 0 && std::chrono::steady_clock::now() < deadline)
+        {
+            RunMainThread();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // A task still suspended now cannot be destroyed safely mid-chain, so its frames are left behind
+        if (GetLiveCount() > 0)
+            fprintf(stderr, "[tasks] %u tasks still running after %u ms, abandoned\n", GetLiveCount(), STOP_TIMEOUT_MS);
+
+        if (m_Threads.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_WorkerMutex);
+            m_WorkersExit = true;
+        }
+        m_WorkerWake.notify_all();
+        for (std::thread &thread : m_Threads)
+            thread.join();
+        m_Threads.clear();
+        m_WorkerQueue.clear();
+    }
+
+    void TaskExecutor::Spawn(Task<> task)
+    {
+        m_Live.fetch_add(1, std::memory_order_relaxed);
+        runDetached(*this, std::move(task));
+    }
+
+    void TaskExecutor::RunMainThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_MainMutex);
+            if (m_MainQueue.empty())
+                return;
+            m_MainRunning.swap(m_MainQueue);
+        }
+        PROFILE_SCOPE("TaskExecutor::RunMainThread");
+        for (std::coroutine_handle<> handle : m_MainRunning)
+            handle.resume();
+        m_MainRunning.clear();
+    }
+
+    void TaskExecutor::pushWorker(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_WorkerMutex);
+            m_WorkerQueue.push_back(handle);
+        }
+        m_WorkerWake.notify_one();
+    }
+
+    void TaskExecutor::pushMain(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        m_MainQueue.push_back(handle);
+    }
+
+    void TaskExecutor::workerMain()
+    {
+        TraceSetThreadName("Task worker");
+        std::unique_lock<std::mutex> lock(m_WorkerMutex);
+        for (;;)
+        {
+            m_WorkerWake.wait(lock, [this]() { return m_WorkersExit || !m_WorkerQueue.empty(); });
+            if (m_WorkerQueue.empty())
+                return;
+            std::coroutine_handle<> handle = m_WorkerQueue.front();
+            m_WorkerQueue.pop_front();
+            lock.unlock();
+            {
+                PROFILE_SCOPE("TaskExecutor::Worker");
+                handle.resume();
+            }
+            lock.lock();
+        }
+    }
+}
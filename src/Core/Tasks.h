@@ -0,0 +1,227 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Calculator
+{
+    template <typename T>
+    class Task;
+
+    namespace TaskDetail
+    {
+        struct PromiseBase
+        {
+            // Resumes whoever awaited the task once it finishes, or nothing for a task nobody awaits
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept { return false; }
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    std::coroutine_handle<> continuation = handle.promise().Continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception() { Error = std::current_exception(); }
+
+            std::coroutine_handle<> Continuation;
+            std::exception_ptr Error;
+        };
+
+        template <typename T>
+        struct Promise : PromiseBase
+        {
+            Task<T> get_return_object();
+            template <typename U>
+            void return_value(U &&value) { Value.emplace(std::forward<U>(value)); }
+            T take()
+            {
+                if (Error)
+                    std::rethrow_exception(Error);
+                return std::move(*Value);
+            }
+
+            std::optional<T> Value;
+        };
+
+        template <>
+        struct Promise<void> : PromiseBase
+        {
+            Task<void> get_return_object();
+            void return_void() {}
+            void take()
+            {
+                if (Error)
+                    std::rethrow_exception(Error);
+            }
+        };
+    }
+
+    // A coroutine returning T, which starts once it is awaited and hands its result, or rethrows its exception, to
+    // the awaiting coroutine. Where it runs is up to the TaskExecutor awaitables it goes through: a task resumes on
+    // whichever thread its last co_await resumed it on.
+    template <typename T = void>
+    class [[nodiscard]] Task
+    {
+    public:
+        using promise_type = TaskDetail::Promise<T>;
+
+        Task() = default;
+        explicit Task(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+        Task(Task &&other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (m_Handle)
+                    m_Handle.destroy();
+                m_Handle = std::exchange(other.m_Handle, nullptr);
+            }
+            return *this;
+        }
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+        ~Task()
+        {
+            if (m_Handle)
+                m_Handle.destroy();
+        }
+
+        auto operator co_await() && noexcept
+        {
+            struct Awaiter
+            {
+                std::coroutine_handle<promise_type> Handle;
+
+                bool await_ready() noexcept { return !Handle || Handle.done(); }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    Handle.promise().Continuation = awaiting;
+                    return Handle;
+                }
+                T await_resume() { return Handle.promise().take(); }
+            };
+            return Awaiter{m_Handle};
+        }
+
+    private:
+        std::coroutine_handle<promise_type> m_Handle;
+    };
+
+    template <typename T>
+    Task<T> TaskDetail::Promise<T>::get_return_object() { return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this)); }
+    inline Task<void> TaskDetail::Promise<void>::get_return_object() { return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this)); }
+
+    // Runs tasks on a pool of worker threads and hands them back to the main thread once a frame, at the point in
+    // Application::Run where RunMainThread is called, so a computation can go back and forth between the two
+    // without blocking a frame or a callback chain. A multi-step job looks like:
+    //
+    //     Task<> Solve(TaskExecutor &tasks, Result &shown)
+    //     {
+    //         Result partial;
+    //         while (!partial.Converged && !tasks.IsStopping())
+    //         {
+    //             co_await tasks.Schedule(); // Worker
+    //             partial = Iterate(partial);
+    //             co_await tasks.NextFrame(); // Main thread, before the frame's UI is drawn
+    //             shown = partial;
+    //         }
+    //     }
+    //
+    //     tasks.Spawn(Solve(tasks, m_Shown));
+    class TaskExecutor
+    {
+    public:
+        TaskExecutor() = default;
+        TaskExecutor(const TaskExecutor &) = delete;
+        TaskExecutor &operator=(const TaskExecutor &) = delete;
+        ~TaskExecutor() { Stop(); }
+
+        // 0 for one worker per core but the main thread's, at most MAX_THREADS. Until then, and after Stop,
+        // Schedule continues on the calling thread.
+        void Start(uint32_t threads);
+
+        // Lets running tasks see IsStopping, resumes them on the main thread until they have all finished or
+        // STOP_TIMEOUT_MS has passed, then joins the workers. Main thread.
+        void Stop();
+
+        // Resumes the awaiting coroutine on a worker
+        auto Schedule() noexcept
+        {
+            struct Awaiter
+            {
+                TaskExecutor &Executor;
+
+                bool await_ready() noexcept { return Executor.m_Threads.empty(); }
+                void await_suspend(std::coroutine_handle<> handle) { Executor.pushWorker(handle); }
+                void await_resume() noexcept {}
+            };
+            return Awaiter{*this};
+        }
+
+        // Resumes the awaiting coroutine on the main thread at the next RunMainThread. From the main thread, that
+        // is the next frame's: a coroutine resumed by RunMainThread that awaits this again waits for another frame.
+        auto NextFrame() noexcept
+        {
+            struct Awaiter
+            {
+                TaskExecutor &Executor;
+
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> handle) { Executor.pushMain(handle); }
+                void await_resume() noexcept {}
+            };
+            return Awaiter{*this};
+        }
+
+        // Starts a task nobody awaits, on the calling thread until its first co_await. The executor owns it from
+        // then on, and prints whatever it throws.
+        void Spawn(Task<> task);
+
+        // Resumes the coroutines handed to the main thread before this call. Main thread, once a frame.
+        void RunMainThread();
+
+        // Checked by long running tasks, between steps, to finish early on exit
+        bool IsStopping() const { return m_Stopping.load(std::memory_order_relaxed); }
+
+        // Spawned tasks that have not finished yet
+        uint32_t GetLiveCount() const { return m_Live.load(std::memory_order_relaxed); }
+
+        static constexpr uint32_t MAX_THREADS = 4;
+        static constexpr uint32_t STOP_TIMEOUT_MS = 2000;
+
+    private:
+        struct Detached;
+
+        static Detached runDetached(TaskExecutor &executor, Task<> task);
+        void pushWorker(std::coroutine_handle<> handle);
+        void pushMain(std::coroutine_handle<> handle);
+        void workerMain();
+
+        std::vector<std::thread> m_Threads;
+        std::deque<std::coroutine_handle<>> m_WorkerQueue; // Under m_WorkerMutex
+        std::mutex m_WorkerMutex;
+        std::condition_variable m_WorkerWake;
+        bool m_WorkersExit = false;
+
+        std::vector<std::coroutine_handle<>> m_MainQueue; // Under m_MainMutex
+        std::vector<std::coroutine_handle<>> m_MainRunning;
+        std::mutex m_MainMutex;
+
+        std::atomic<bool> m_Stopping{false};
+        std::atomic<uint32_t> m_Live{0};
+    };
+}
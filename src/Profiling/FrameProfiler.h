@@ -0,0 +1,162 @@
+#pragma once
+#include "imgui.h"
+#include <cstdint>
+#include <float.h>
+#include "Calculator/InputEvents.h"
+#include "Profiling/LatencyTracker.h"
+#include "Profiling/RollingSamples.h"
+#include "Profiling/Trace.h"
+#include "Renderer/HostAllocator.h"
+
+namespace Calculator
+{
+    enum FrameStage
+    {
+        FrameStage_PollEvents,
+        FrameStage_Continuations,
+        FrameStage_NewFrame,
+        FrameStage_Titlebar,
+        FrameStage_RenderLayer,
+        FrameStage_Render,
+        FrameStage_FrameRender,
+        FrameStage_GpuWait,
+        FrameStage_PlatformWindows,
+        FrameStage_FramePresent,
+        FrameStage_COUNT
+    };
+
+    static const char *FRAME_STAGE_NAMES[FrameStage_COUNT] = {
+        "glfwPollEvents",
+        "Task continuations",
+        "NewFrame",
+        "UI_DrawTitlebar",
+        "RenderLayer",
+        "ImGui::Render",
+        "FrameRender",
+        "  waiting on GPU",
+        "UpdatePlatformWindows",
+        "FramePresent",
+    };
+
+    // Per-stage CPU timings of Application::Run plus the GPU time of the main render pass, over the last HISTORY frames.
+    // All times are in milliseconds.
+    class FrameProfiler
+    {
+    public:
+        static constexpr size_t HISTORY = 240;
+
+        // Also records the stage as a trace zone
+        class Scope
+        {
+            FrameProfiler &m_Profiler;
+            FrameStage m_Stage;
+            uint64_t m_Start;
+            TraceZone m_Zone;
+
+        public:
+            Scope(FrameProfiler &profiler, FrameStage stage)
+                : m_Profiler(profiler), m_Stage(stage), m_Start(InputClockNow()), m_Zone(FRAME_STAGE_NAMES[stage]) {}
+            ~Scope() { m_Profiler.AddStageTime(m_Stage, (float)((InputClockNow() - m_Start) / 1.0e6)); }
+        };
+
+        void BeginFrame()
+        {
+            m_FrameStart = InputClockNow();
+            for (float &time : m_Current)
+                time = 0.0f;
+        }
+
+        void EndFrame()
+        {
+            for (int stage = 0; stage < FrameStage_COUNT; stage++)
+                m_Cpu[stage].Push(m_Current[stage]);
+            m_Frame.Push((float)((InputClockNow() - m_FrameStart) / 1.0e6));
+        }
+
+        void AddStageTime(FrameStage stage, float ms) { m_Current[stage] += ms; }
+
+        // GPU results arrive a few frames late, once the frame's fence has signaled
+        void AddGpuTime(float ms) { m_Gpu.Push(ms); }
+
+        void DrawOverlay(bool *open, const LatencyTracker *latency, const HostAllocator *hostMemory)
+        {
+            ImGui::SetNextWindowPos(ImVec2(ImGui::GetMainViewport()->Pos.x + 10, ImGui::GetMainViewport()->Pos.y + 60), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(380, 0), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowBgAlpha(0.9f);
+            if (!ImGui::Begin("Profiler", open))
+            {
+                ImGui::End();
+                return;
+            }
+
+            ImGui::Text("Frame  %.2f ms  (p50 %.2f  p99 %.2f)", m_Frame.Latest(), m_Frame.Percentile(0.5f), m_Frame.Percentile(0.99f));
+            drawHistogram("##frame", m_Frame, 40.0f);
+
+            if (ImGui::BeginTable("##stages", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+            {
+                ImGui::TableSetupColumn("Stage");
+                ImGui::TableSetupColumn("p50");
+                ImGui::TableSetupColumn("p99");
+                ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableHeadersRow();
+                for (int stage = 0; stage < FrameStage_COUNT; stage++)
+                    drawRow(FRAME_STAGE_NAMES[stage], m_Cpu[stage]);
+                if (!m_Gpu.Empty())
+                    drawRow("GPU render pass", m_Gpu);
+                ImGui::EndTable();
+            }
+            if (m_Gpu.Empty())
+                ImGui::TextDisabled("GPU timestamps not supported by this queue");
+
+            if (latency != nullptr)
+            {
+                ImGui::Separator();
+                for (int stage = 0; stage < LatencyStage_COUNT; stage++)
+                {
+                    const RollingSamples<1024> &samples = latency->GetSamples((LatencyStage)stage);
+                    ImGui::Text("input->%-7s p50 %6.2f  p99 %6.2f ms", LATENCY_STAGE_NAMES[stage], samples.Percentile(0.5f), samples.Percentile(0.99f));
+                }
+            }
+
+            if (hostMemory != nullptr)
+            {
+                ImGui::Separator();
+                HostAllocationStats stats = hostMemory->GetStats();
+                ImGui::Text("Vulkan host memory %.1f KiB  (peak %.1f KiB)", stats.TotalLiveBytes / 1024.0, stats.TotalPeakBytes / 1024.0);
+                for (int scope = 0; scope < HOST_ALLOCATION_SCOPE_COUNT; scope++)
+                    ImGui::Text("  %-8s %8.1f KiB  peak %8.1f KiB", HOST_ALLOCATION_SCOPE_NAMES[scope], stats.LiveBytes[scope] / 1024.0, stats.PeakBytes[scope] / 1024.0);
+                ImGui::TextDisabled("%.1f KiB pooled, %.1f KiB driver internal", stats.PooledBytes / 1024.0, stats.InternalBytes / 1024.0);
+            }
+            ImGui::End();
+        }
+
+    private:
+        template <size_t N>
+        static void drawHistogram(const char *id, const RollingSamples<N> &samples, float height)
+        {
+            ImGui::PlotHistogram(id, samples.Data(), samples.Size(), samples.Offset(), nullptr, 0.0f, FLT_MAX, ImVec2(-FLT_MIN, height));
+        }
+
+        template <size_t N>
+        static void drawRow(const char *name, const RollingSamples<N> &samples)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", samples.Percentile(0.5f));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", samples.Percentile(0.99f));
+            ImGui::TableNextColumn();
+            ImGui::PushID(name);
+            drawHistogram("##history", samples, 16.0f);
+            ImGui::PopID();
+        }
+
+        RollingSamples<HISTORY> m_Cpu[FrameStage_COUNT];
+        RollingSamples<HISTORY> m_Frame;
+        RollingSamples<HISTORY> m_Gpu;
+        float m_Current[FrameStage_COUNT] = {};
+        uint64_t m_FrameStart = 0;
+    };
+}
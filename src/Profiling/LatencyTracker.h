@@ -0,0 +1,95 @@
+#pragma once
+#include <stdio.h>
+#include <cstdint>
+#include <vector>
+#include "Calculator/InputEvents.h"
+#include "Profiling/RollingSamples.h"
+
+namespace Calculator
+{
+    enum LatencyStage
+    {
+        LatencyStage_Update,  // Event applied to CalculatorData
+        LatencyStage_Submit,  // FrameRender submitted the frame showing it
+        LatencyStage_Present, // vkQueuePresentKHR returned for that frame
+        LatencyStage_COUNT
+    };
+
+    static const char *LATENCY_STAGE_NAMES[LatencyStage_COUNT] = {"update", "submit", "present"};
+
+    // Follows the timestamp of every input event from the GLFW callback to the present of the frame that shows it.
+    // All latencies are in milliseconds.
+    class LatencyTracker
+    {
+        std::vector<uint64_t> m_Pending; // Input timestamps applied but not yet presented
+        uint64_t m_SubmitTime = 0;
+        RollingSamples<1024> m_Samples[LatencyStage_COUNT];
+
+        static float toMs(uint64_t from, uint64_t to)
+        {
+            return to > from ? (float)((to - from) / 1.0e6) : 0.0f;
+        }
+
+    public:
+        void OnInputApplied(uint64_t inputTime)
+        {
+            m_Samples[LatencyStage_Update].Push(toMs(inputTime, InputClockNow()));
+            m_Pending.push_back(inputTime);
+        }
+
+        void OnSubmit()
+        {
+            m_SubmitTime = InputClockNow();
+        }
+
+        // Only called for frames that actually reached vkQueuePresentKHR, so skipped frames carry their input over
+        void OnPresent()
+        {
+            uint64_t now = InputClockNow();
+            for (uint64_t inputTime : m_Pending)
+            {
+                m_Samples[LatencyStage_Submit].Push(toMs(inputTime, m_SubmitTime));
+                m_Samples[LatencyStage_Present].Push(toMs(inputTime, now));
+            }
+            m_Pending.clear();
+        }
+
+        // With the render thread, the inputs applied before a frame travel with it instead, and come back with the
+        // submit and present times it measured
+        void MovePending(std::vector<uint64_t> &to)
+        {
+            to.insert(to.end(), m_Pending.begin(), m_Pending.end());
+            m_Pending.clear();
+        }
+
+        // For a frame that was not presented, its input shows up in the next one
+        void RestorePending(const std::vector<uint64_t> &inputs)
+        {
+            m_Pending.insert(m_Pending.end(), inputs.begin(), inputs.end());
+        }
+
+        void OnPresented(const std::vector<uint64_t> &inputs, uint64_t submitTime, uint64_t presentTime)
+        {
+            for (uint64_t inputTime : inputs)
+            {
+                m_Samples[LatencyStage_Submit].Push(toMs(inputTime, submitTime));
+                m_Samples[LatencyStage_Present].Push(toMs(inputTime, presentTime));
+            }
+        }
+
+        const RollingSamples<1024> &GetSamples(LatencyStage stage) const { return m_Samples[stage]; }
+
+        void Report(FILE *out) const
+        {
+            for (int stage = 0; stage < LatencyStage_COUNT; stage++)
+            {
+                const RollingSamples<1024> &samples = m_Samples[stage];
+                if (samples.Empty())
+                    continue;
+                fprintf(out, "[latency] input->%-7s p50 %6.2f ms  p90 %6.2f ms  p99 %6.2f ms  max %6.2f ms  (%zu events)\n",
+                        LATENCY_STAGE_NAMES[stage], samples.Percentile(0.5f), samples.Percentile(0.9f),
+                        samples.Percentile(0.99f), samples.Max(), samples.Count());
+            }
+        }
+    };
+}
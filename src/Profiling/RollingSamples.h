@@ -0,0 +1,55 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace Calculator
+{
+    // Fixed-size window over the most recent N samples, with percentiles computed on demand
+    template <size_t N>
+    class RollingSamples
+    {
+        std::array<float, N> m_Samples = {};
+        size_t m_Count = 0;
+        size_t m_Next = 0;
+
+    public:
+        void Push(float value)
+        {
+            m_Samples[m_Next] = value;
+            m_Next = (m_Next + 1) % N;
+            if (m_Count < N)
+                m_Count++;
+        }
+
+        size_t Count() const { return m_Count; }
+        bool Empty() const { return m_Count == 0; }
+
+        float Latest() const
+        {
+            return m_Count ? m_Samples[(m_Next + N - 1) % N] : 0.0f;
+        }
+
+        // p in [0, 1]
+        float Percentile(float p) const
+        {
+            if (m_Count == 0)
+                return 0.0f;
+            std::array<float, N> sorted;
+            std::copy(m_Samples.begin(), m_Samples.begin() + m_Count, sorted.begin());
+            size_t nth = std::min(m_Count - 1, (size_t)(p * (m_Count - 1) + 0.5f));
+            std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.begin() + m_Count);
+            return sorted[nth];
+        }
+
+        float Max() const
+        {
+            return m_Count ? *std::max_element(m_Samples.begin(), m_Samples.begin() + m_Count) : 0.0f;
+        }
+
+        // Ring storage, oldest sample at Offset(); matches the values/values_offset arguments of ImGui::PlotHistogram
+        const float *Data() const { return m_Samples.data(); }
+        int Size() const { return (int)m_Count; }
+        int Offset() const { return m_Count < N ? 0 : (int)m_Next; }
+    };
+}
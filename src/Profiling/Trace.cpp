@@ -0,0 +1,147 @@
+#include "Profiling/Trace.h"
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace Calculator
+{
+    // The zones of a thread that has exited
+    struct RetainedTrace
+    {
+        uint32_t ThreadId;
+        const char *ThreadName;
+        std::vector<TraceEvent> Events;
+    };
+
+    // Zones kept from exited threads, past which the oldest threads' are dropped
+    static constexpr size_t RETAINED_EVENTS = TraceBuffer::CAPACITY;
+
+    static std::mutex s_TraceRegistryMutex;
+    static std::vector<std::unique_ptr<TraceBuffer>> s_TraceBuffers; // Under s_TraceRegistryMutex, as the rest
+    static std::vector<TraceBuffer *> s_FreeTraceBuffers;
+    static std::deque<RetainedTrace> s_RetainedTraces;
+    static size_t s_RetainedEvents = 0;
+    static uint32_t s_NextThreadId = 1;
+    static const uint64_t s_TraceEpoch = TraceClockNow();
+
+    void TraceBuffer::Snapshot(std::vector<TraceEvent> &out) const
+    {
+        uint64_t head = m_Head.load(std::memory_order_acquire);
+        uint64_t begin = head > CAPACITY ? head - CAPACITY : 0;
+        size_t first = out.size();
+        for (uint64_t i = begin; i < head; i++)
+        {
+            const Slot &slot = m_Slots[i & (CAPACITY - 1)];
+            out.push_back({slot.Name.load(std::memory_order_relaxed),
+                           slot.Start.load(std::memory_order_relaxed),
+                           slot.Duration.load(std::memory_order_relaxed)});
+        }
+
+        // The writer may have lapped the start of the copy (and be writing one slot further)
+        uint64_t after = m_Head.load(std::memory_order_acquire);
+        uint64_t valid_begin = after + 1 > CAPACITY ? after + 1 - CAPACITY : 0;
+        if (valid_begin > begin)
+        {
+            size_t overwritten = (size_t)std::min(valid_begin - begin, head - begin);
+            out.erase(out.begin() + first, out.begin() + first + overwritten);
+        }
+    }
+
+    TraceBuffer *TraceRegisterThread()
+    {
+        std::lock_guard<std::mutex> lock(s_TraceRegistryMutex);
+        if (!s_FreeTraceBuffers.empty())
+        {
+            TraceBuffer *buffer = s_FreeTraceBuffers.back();
+            s_FreeTraceBuffers.pop_back();
+            buffer->Reset(s_NextThreadId++);
+            return buffer;
+        }
+        s_TraceBuffers.push_back(std::make_unique<TraceBuffer>(s_NextThreadId++));
+        return s_TraceBuffers.back().get();
+    }
+
+    void TraceReleaseThread(TraceBuffer *buffer)
+    {
+        std::lock_guard<std::mutex> lock(s_TraceRegistryMutex);
+        RetainedTrace retained = {buffer->GetThreadId(), buffer->GetThreadName()};
+        buffer->Snapshot(retained.Events);
+        s_RetainedEvents += retained.Events.size();
+        s_RetainedTraces.push_back(std::move(retained));
+        while (s_RetainedEvents > RETAINED_EVENTS && s_RetainedTraces.size() > 1)
+        {
+            s_RetainedEvents -= s_RetainedTraces.front().Events.size();
+            s_RetainedTraces.pop_front();
+        }
+        s_FreeTraceBuffers.push_back(buffer);
+    }
+
+    static void writeJsonString(FILE *file, const char *str)
+    {
+        fputc('"', file);
+        for (const char *c = str; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                fputc('\\', file);
+            if ((unsigned char)*c >= 0x20)
+                fputc(*c, file);
+        }
+        fputc('"', file);
+    }
+
+    bool TraceWriteChromeJson(const char *path)
+    {
+        FILE *file = fopen(path, "wb");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "[trace] Could not open %s\n", path);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(s_TraceRegistryMutex);
+        bool first = true;
+        auto writeThread = [file, &first](uint32_t tid, const char *name, const std::vector<TraceEvent> &events)
+        {
+            if (name != nullptr)
+            {
+                fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", tid);
+                writeJsonString(file, name);
+                fprintf(file, "}}");
+                first = false;
+            }
+            for (const TraceEvent &event : events)
+            {
+                // Complete events, timestamps in microseconds since startup
+                uint64_t start = event.Start > s_TraceEpoch ? event.Start - s_TraceEpoch : 0;
+                fprintf(file, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                        first ? "" : ",\n", tid,
+                        (double)start / 1000.0, (double)event.Duration / 1000.0);
+                writeJsonString(file, event.Name);
+                fputc('}', file);
+                first = false;
+            }
+        };
+
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        for (const RetainedTrace &retained : s_RetainedTraces)
+            writeThread(retained.ThreadId, retained.ThreadName, retained.Events);
+        std::vector<TraceEvent> events;
+        for (const std::unique_ptr<TraceBuffer> &buffer : s_TraceBuffers)
+        {
+            // A free ring still holds the zones of the thread it was retained from
+            if (std::find(s_FreeTraceBuffers.begin(), s_FreeTraceBuffers.end(), buffer.get()) != s_FreeTraceBuffers.end())
+                continue;
+            events.clear();
+            buffer->Snapshot(events);
+            writeThread(buffer->GetThreadId(), buffer->GetThreadName(), events);
+        }
+        fprintf(file, "\n]}\n");
+        bool ok = ferror(file) == 0;
+        ok = fclose(file) == 0 && ok;
+        if (ok)
+            printf("[trace] Wrote %s\n", path);
+        return ok;
+    }
+}
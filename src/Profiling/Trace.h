@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Scoped zones recorded into per-thread rings and exported as Chrome Trace Event JSON (opens in Perfetto / chrome://tracing).
+// Zone names must be string literals, only the pointer is stored.
+#ifndef CALCULATOR_DISABLE_TRACE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ::Calculator::TraceZone PROFILE_CONCAT(s_TraceZone, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+namespace Calculator
+{
+    static inline uint64_t TraceClockNow()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    struct TraceEvent
+    {
+        const char *Name;
+        uint64_t Start;
+        uint64_t Duration;
+    };
+
+    // Single-producer ring owned by one thread. Recording never locks or allocates; when full the oldest zones are overwritten.
+    // Slots are relaxed atomics so another thread can snapshot the ring while it is being written.
+    class TraceBuffer
+    {
+    public:
+        static constexpr uint64_t CAPACITY = 1 << 16;
+
+        TraceBuffer(uint32_t threadId) : m_ThreadId(threadId) {}
+
+        // Hands the ring to another thread. Not while the previous one may still record.
+        void Reset(uint32_t threadId)
+        {
+            m_ThreadId = threadId;
+            m_ThreadName.store(nullptr, std::memory_order_relaxed);
+            m_Head.store(0, std::memory_order_relaxed);
+        }
+
+        void Record(const char *name, uint64_t start, uint64_t end)
+        {
+            uint64_t head = m_Head.load(std::memory_order_relaxed);
+            Slot &slot = m_Slots[head & (CAPACITY - 1)];
+            slot.Name.store(name, std::memory_order_relaxed);
+            slot.Start.store(start, std::memory_order_relaxed);
+            slot.Duration.store(end - start, std::memory_order_relaxed);
+            m_Head.store(head + 1, std::memory_order_release);
+        }
+
+        // Appends the zones still in the ring to out, dropping any overwritten while copying
+        void Snapshot(std::vector<TraceEvent> &out) const;
+
+        uint32_t GetThreadId() const { return m_ThreadId; }
+        const char *GetThreadName() const { return m_ThreadName.load(std::memory_order_relaxed); }
+        void SetThreadName(const char *name) { m_ThreadName.store(name, std::memory_order_relaxed); }
+
+    private:
+        struct Slot
+        {
+            std::atomic<const char *> Name{nullptr};
+            std::atomic<uint64_t> Start{0};
+            std::atomic<uint64_t> Duration{0};
+        };
+
+        uint32_t m_ThreadId;
+        std::atomic<const char *> m_ThreadName{nullptr};
+        std::atomic<uint64_t> m_Head{0};
+        Slot m_Slots[CAPACITY];
+    };
+
+    // Gives the calling thread a ring, one a finished thread left if there is one
+    TraceBuffer *TraceRegisterThread();
+    // When the thread exits: its zones are copied out, so a dump still sees them, and its ring is kept for the next
+    // thread. Short-lived threads, such as the startup workers, then cost their zones rather than a ring each.
+    void TraceReleaseThread(TraceBuffer *buffer);
+
+    struct TraceThreadRegistration
+    {
+        TraceBuffer *Buffer = TraceRegisterThread();
+        ~TraceThreadRegistration() { TraceReleaseThread(Buffer); }
+    };
+
+    inline TraceBuffer *TraceThreadBuffer()
+    {
+        thread_local TraceThreadRegistration registration;
+        return registration.Buffer;
+    }
+
+    inline void TraceSetThreadName(const char *name)
+    {
+        TraceThreadBuffer()->SetThreadName(name);
+    }
+
+    // Writes every thread's ring to path, returns false if the file could not be written
+    bool TraceWriteChromeJson(const char *path);
+
+    class TraceZone
+    {
+        const char *m_Name;
+        uint64_t m_Start;
+
+    public:
+        TraceZone(const char *name) : m_Name(name), m_Start(TraceClockNow()) {}
+        ~TraceZone() { TraceThreadBuffer()->Record(m_Name, m_Start, TraceClockNow()); }
+        TraceZone(const TraceZone &) = delete;
+        TraceZone &operator=(const TraceZone &) = delete;
+    };
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Calculator
+{
+    // A callable stored inline, so queuing one never allocates. Captures must fit in STORAGE bytes.
+    class ReleaseCallback
+    {
+    public:
+        static constexpr size_t STORAGE = 48;
+
+        template <typename Fn>
+        void Set(Fn &&fn)
+        {
+            using F = std::decay_t<Fn>;
+            static_assert(sizeof(F) <= STORAGE, "Release callback captures too much, capture handles instead of objects");
+            static_assert(alignof(F) <= alignof(std::max_align_t), "Release callback is over-aligned");
+            new (m_Storage) F(std::forward<Fn>(fn));
+            m_Run = [](void *storage)
+            {
+                F &f = *(F *)storage;
+                f();
+                f.~F();
+            };
+        }
+
+        // Runs and destroys the callable
+        void Run()
+        {
+            m_Run(m_Storage);
+            m_Run = nullptr;
+        }
+
+    private:
+        alignas(std::max_align_t) unsigned char m_Storage[STORAGE];
+        void (*m_Run)(void *) = nullptr;
+    };
+
+    // Fixed-capacity ring of release callbacks, each tagged with the serial of the GPU submission that last uses the
+    // resource. Any thread may enqueue without locks or allocation (a bounded MPMC queue with per-slot sequence numbers),
+    // and the render thread collects the callbacks whose submission has completed.
+    // Callbacks run in enqueue order, so one with a later serial holds back the ones behind it until it is due.
+    template <size_t Capacity>
+    class DeferredReleaseRing
+    {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        DeferredReleaseRing()
+        {
+            for (size_t i = 0; i < Capacity; i++)
+                m_Slots[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // Returns false when the ring is full, the callable is not queued then
+        template <typename Fn>
+        bool Enqueue(uint64_t serial, Fn &&fn)
+        {
+            size_t pos = m_Tail.load(std::memory_order_relaxed);
+            Slot *slot;
+            for (;;)
+            {
+                slot = &m_Slots[pos & (Capacity - 1)];
+                size_t sequence = slot->Sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = m_Tail.load(std::memory_order_relaxed);
+            }
+            slot->Serial = serial;
+            slot->Callback.Set(std::forward<Fn>(fn));
+            slot->Sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Render thread only. Runs every due callback at the head of the ring, returns how many ran.
+        size_t Collect(uint64_t completedSerial)
+        {
+            size_t count = 0;
+            for (;;)
+            {
+                Slot &slot = m_Slots[m_Head & (Capacity - 1)];
+                // Empty, or a producer has claimed the slot and not finished writing it yet
+                if (slot.Sequence.load(std::memory_order_acquire) != m_Head + 1)
+                    break;
+                if (slot.Serial > completedSerial)
+                    break;
+                slot.Callback.Run();
+                slot.Sequence.store(m_Head + Capacity, std::memory_order_release);
+                m_Head++;
+                count++;
+            }
+            return count;
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t> Sequence;
+            uint64_t Serial;
+            ReleaseCallback Callback;
+        };
+
+        Slot m_Slots[Capacity];
+        alignas(64) std::atomic<size_t> m_Tail{0};
+        alignas(64) size_t m_Head = 0;
+    };
+}
@@ -0,0 +1,108 @@
+#include "Renderer/DescriptorAllocator.h"
+#include <algorithm>
+
+namespace Calculator
+{
+    void DescriptorAllocator::Init(VkDevice device, const VkAllocationCallbacks *allocator, const VkDescriptorPoolSize *perSet, uint32_t perSetCount, uint32_t initialSets)
+    {
+        m_Device = device;
+        m_Allocator = allocator;
+        m_PerSet.assign(perSet, perSet + perSetCount);
+        m_Stats = {};
+        addPool(std::max(initialSets, 1u));
+    }
+
+    void DescriptorAllocator::Destroy()
+    {
+        for (const Pool &pool : m_Pools)
+            vkDestroyDescriptorPool(m_Device, pool.Handle, m_Allocator);
+        m_Pools.clear();
+        m_Owners.clear();
+        m_Stats.Pools = 0;
+        m_Stats.CapacitySets = 0;
+        m_Stats.LiveSets = 0;
+    }
+
+    bool DescriptorAllocator::addPool(uint32_t sets)
+    {
+        std::vector<VkDescriptorPoolSize> sizes = m_PerSet;
+        for (VkDescriptorPoolSize &size : sizes)
+            size.descriptorCount *= sets;
+
+        VkDescriptorPoolCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        info.maxSets = sets;
+        info.poolSizeCount = (uint32_t)sizes.size();
+        info.pPoolSizes = sizes.data();
+        VkDescriptorPool handle;
+        VkResult err = vkCreateDescriptorPool(m_Device, &info, m_Allocator, &handle);
+        if (err != VK_SUCCESS)
+        {
+            fprintf(stderr, "[vulkan] Could not create a descriptor pool of %u sets: %d\n", sets, err);
+            return false;
+        }
+        m_Pools.push_back({handle, sets, 0});
+        m_Stats.Pools++;
+        m_Stats.PeakPools = std::max(m_Stats.PeakPools, m_Stats.Pools);
+        m_Stats.CapacitySets += sets;
+        return true;
+    }
+
+    VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+    {
+        VkDescriptorSetAllocateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        info.descriptorSetCount = 1;
+        info.pSetLayouts = &layout;
+
+        // Newest pool first, it is the largest and the most likely to have room. Sets freed in older pools are reused
+        // before growing again.
+        for (uint32_t attempt = 0; attempt < 2; attempt++)
+        {
+            for (uint32_t i = (uint32_t)m_Pools.size(); i-- > 0;)
+            {
+                Pool &pool = m_Pools[i];
+                if (pool.Live == pool.Capacity)
+                    continue;
+                info.descriptorPool = pool.Handle;
+                VkDescriptorSet set;
+                VkResult err = vkAllocateDescriptorSets(m_Device, &info, &set);
+                if (err == VK_ERROR_OUT_OF_POOL_MEMORY || err == VK_ERROR_FRAGMENTED_POOL)
+                    continue;
+                if (err != VK_SUCCESS)
+                {
+                    fprintf(stderr, "[vulkan] vkAllocateDescriptorSets failed: %d\n", err);
+                    return VK_NULL_HANDLE;
+                }
+                pool.Live++;
+                m_Owners[set] = i;
+                m_Stats.LiveSets++;
+                m_Stats.PeakSets = std::max(m_Stats.PeakSets, m_Stats.LiveSets);
+                return set;
+            }
+            uint32_t last = m_Pools.empty() ? 1 : m_Pools.back().Capacity;
+            if (!addPool(std::min(last * 2, MAX_POOL_SETS)))
+                break;
+        }
+        return VK_NULL_HANDLE;
+    }
+
+    void DescriptorAllocator::Free(VkDescriptorSet set)
+    {
+        auto it = m_Owners.find(set);
+        if (it == m_Owners.end())
+            return;
+        Pool &pool = m_Pools[it->second];
+        vkFreeDescriptorSets(m_Device, pool.Handle, 1, &set);
+        pool.Live--;
+        m_Stats.LiveSets--;
+        m_Owners.erase(it);
+    }
+
+    void DescriptorAllocator::Report(FILE *out, const char *name) const
+    {
+        fprintf(out, "[descriptors] %s: %u live sets (peak %u) in %u pools (peak %u) of %u sets\n",
+                name, m_Stats.LiveSets, m_Stats.PeakSets, m_Stats.Pools, m_Stats.PeakPools, m_Stats.CapacitySets);
+    }
+}
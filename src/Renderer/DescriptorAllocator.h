@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+namespace Calculator
+{
+    struct DescriptorAllocatorStats
+    {
+        uint32_t Pools = 0;
+        uint32_t PeakPools = 0;
+        uint32_t CapacitySets = 0;
+        uint32_t LiveSets = 0;
+        uint32_t PeakSets = 0;
+    };
+
+    // Hands out descriptor sets from a chain of pools. The first pool holds only a few sets, and a new pool of twice
+    // the size of the last one is chained when the driver reports VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL,
+    // so an instance only reserves what it actually uses.
+    class DescriptorAllocator
+    {
+    public:
+        static constexpr uint32_t MAX_POOL_SETS = 1024;
+
+        // perSet lists the descriptors a single set may need. A pool of n sets reserves n times that.
+        void Init(VkDevice device, const VkAllocationCallbacks *allocator, const VkDescriptorPoolSize *perSet, uint32_t perSetCount, uint32_t initialSets);
+        void Destroy();
+
+        // Returns VK_NULL_HANDLE if no pool could be created
+        VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+        void Free(VkDescriptorSet set);
+        bool Owns(VkDescriptorSet set) const { return m_Owners.count(set) != 0; }
+
+        const DescriptorAllocatorStats &GetStats() const { return m_Stats; }
+        void Report(FILE *out, const char *name) const;
+
+    private:
+        struct Pool
+        {
+            VkDescriptorPool Handle;
+            uint32_t Capacity;
+            uint32_t Live;
+        };
+
+        bool addPool(uint32_t sets);
+
+        VkDevice m_Device = VK_NULL_HANDLE;
+        const VkAllocationCallbacks *m_Allocator = nullptr;
+        std::vector<VkDescriptorPoolSize> m_PerSet;
+        std::vector<Pool> m_Pools;
+        std::unordered_map<VkDescriptorSet, uint32_t> m_Owners;
+        DescriptorAllocatorStats m_Stats;
+    };
+
+    // Implemented in imgui_impl.cpp, next to the ImGui Vulkan backend whose descriptor set layout it uses.
+    // Same as ImGui_ImplVulkan_AddTexture/RemoveTexture, but the set comes from allocator instead of the backend's fixed pool.
+    VkDescriptorSet AddImGuiTexture(DescriptorAllocator &allocator, VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout);
+    void RemoveImGuiTexture(DescriptorAllocator &allocator, VkDescriptorSet set);
+
+    // The backend allocates the font atlas set from its own pool in ImGui_ImplVulkan_CreateFontsTexture. Adopt moves
+    // it into allocator right after, keeping the backend's set if allocator has none to give. Release frees an adopted
+    // set, call it before ImGui_ImplVulkan_CreateFontsTexture, DestroyFontsTexture or Shutdown, which would otherwise
+    // return it to the backend's pool.
+    void AdoptImGuiFontsTexture(DescriptorAllocator &allocator);
+    void ReleaseImGuiFontsTexture(DescriptorAllocator &allocator);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "imgui.h"
+#include <string.h>
+
+namespace Calculator
+{
+    // Deep copy of an ImDrawData that stays valid after the next ImGui::NewFrame, for rendering on another thread.
+    // The draw lists and their buffers are reused from copy to copy, so steady state does not allocate.
+    // Texture ids and callbacks are copied as they are: whatever they refer to must outlive the render of the copy.
+    class DrawDataSnapshot
+    {
+    public:
+        DrawDataSnapshot() = default;
+        ~DrawDataSnapshot()
+        {
+            for (ImDrawList *list : m_Lists)
+                IM_DELETE(list);
+        }
+        DrawDataSnapshot(const DrawDataSnapshot &) = delete;
+        DrawDataSnapshot &operator=(const DrawDataSnapshot &) = delete;
+
+        void CopyFrom(const ImDrawData *source)
+        {
+            while (m_Lists.Size < source->CmdListsCount)
+                m_Lists.push_back(IM_NEW(ImDrawList)(nullptr));
+
+            m_Data.Valid = source->Valid;
+            m_Data.CmdListsCount = source->CmdListsCount;
+            m_Data.TotalIdxCount = source->TotalIdxCount;
+            m_Data.TotalVtxCount = source->TotalVtxCount;
+            m_Data.DisplayPos = source->DisplayPos;
+            m_Data.DisplaySize = source->DisplaySize;
+            m_Data.FramebufferScale = source->FramebufferScale;
+            m_Data.OwnerViewport = source->OwnerViewport;
+            m_Data.CmdLists.resize(source->CmdListsCount);
+            for (int i = 0; i < source->CmdListsCount; i++)
+            {
+                const ImDrawList *from = source->CmdLists[i];
+                ImDrawList *to = m_Lists[i];
+                copy(to->CmdBuffer, from->CmdBuffer);
+                copy(to->IdxBuffer, from->IdxBuffer);
+                copy(to->VtxBuffer, from->VtxBuffer);
+                to->Flags = from->Flags;
+                m_Data.CmdLists[i] = to;
+            }
+        }
+
+        ImDrawData *Get() { return &m_Data; }
+
+    private:
+        // ImVector's assignment frees and reallocates, resize keeps the capacity
+        template <typename T>
+        static void copy(ImVector<T> &to, const ImVector<T> &from)
+        {
+            to.resize(from.Size);
+            if (from.Size > 0)
+                memcpy(to.Data, from.Data, (size_t)from.Size * sizeof(T));
+        }
+
+        ImDrawData m_Data;
+        ImVector<ImDrawList *> m_Lists;
+    };
+}
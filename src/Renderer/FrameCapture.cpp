@@ -0,0 +1,267 @@
+#include "Renderer/FrameCapture.h"
+#include "Profiling/Trace.h"
+#include <algorithm>
+
+namespace Calculator
+{
+    bool FrameCapture::Start(const char *path, VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *allocator)
+    {
+        Stop();
+        if (!m_Writer.Open(path))
+            return false;
+        m_Path = path;
+        m_PhysicalDevice = physicalDevice;
+        m_Device = device;
+        m_Allocator = allocator;
+        m_NextCopy = m_NextPoll = m_NextEncode = 0;
+        m_FrameIndex = 0;
+        m_StartNs = TraceClockNow();
+        m_Stop = false;
+        m_Encoder = std::thread([this]() { encoderMain(); });
+        return true;
+    }
+
+    void FrameCapture::Stop()
+    {
+        if (!IsActive())
+            return;
+        Poll(UINT64_MAX);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Encoder.join();
+        for (Slot &slot : m_Slots)
+        {
+            release(slot);
+            slot.State.store(SLOT_FREE);
+        }
+        m_Writer.Close();
+        m_Device = VK_NULL_HANDLE;
+    }
+
+    // Host cached memory is preferred, the encoder reads every byte and uncached reads are many times slower
+    bool FrameCapture::reserve(Slot &slot, VkDeviceSize size)
+    {
+        if (slot.Capacity >= size)
+            return true;
+        release(slot);
+
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(m_Device, &buffer_info, m_Allocator, &slot.Buffer) != VK_SUCCESS)
+        {
+            slot.Buffer = VK_NULL_HANDLE;
+            return false;
+        }
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(m_Device, slot.Buffer, &requirements);
+        VkPhysicalDeviceMemoryProperties properties;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &properties);
+        uint32_t type = UINT32_MAX;
+        const VkMemoryPropertyFlags passes[2] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT};
+        for (int pass = 0; pass < 2 && type == UINT32_MAX; pass++)
+            for (uint32_t i = 0; i < properties.memoryTypeCount && type == UINT32_MAX; i++)
+                if ((requirements.memoryTypeBits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & passes[pass]) == passes[pass])
+                    type = i;
+
+        VkMemoryAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = requirements.size;
+        alloc_info.memoryTypeIndex = type;
+        if (type == UINT32_MAX || vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &slot.Memory) != VK_SUCCESS)
+        {
+            slot.Memory = VK_NULL_HANDLE;
+            release(slot);
+            return false;
+        }
+        if (vkBindBufferMemory(m_Device, slot.Buffer, slot.Memory, 0) != VK_SUCCESS ||
+            vkMapMemory(m_Device, slot.Memory, 0, VK_WHOLE_SIZE, 0, &slot.Mapped) != VK_SUCCESS)
+        {
+            slot.Mapped = nullptr;
+            release(slot);
+            return false;
+        }
+        slot.Coherent = (properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+        slot.Capacity = size;
+        return true;
+    }
+
+    void FrameCapture::release(Slot &slot)
+    {
+        if (slot.Mapped != nullptr)
+            vkUnmapMemory(m_Device, slot.Memory);
+        vkDestroyBuffer(m_Device, slot.Buffer, m_Allocator);
+        vkFreeMemory(m_Device, slot.Memory, m_Allocator);
+        slot.Buffer = VK_NULL_HANDLE;
+        slot.Memory = VK_NULL_HANDLE;
+        slot.Mapped = nullptr;
+        slot.Capacity = 0;
+    }
+
+    void FrameCapture::RecordCopy(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout layout, VkFormat format,
+                                  uint32_t width, uint32_t height, uint64_t serial)
+    {
+        PROFILE_SCOPE("FrameCapture::RecordCopy");
+        uint64_t start = TraceClockNow();
+        uint64_t index = m_FrameIndex++;
+        switch (format)
+        {
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            break;
+        default:
+            if (!m_WarnedFormat)
+                fprintf(stderr, "[capture] Format %d is not recorded\n", format);
+            m_WarnedFormat = true;
+            m_Dropped++;
+            return;
+        }
+        Slot &slot = m_Slots[m_NextCopy];
+        if (slot.State.load(std::memory_order_acquire) != SLOT_FREE || !reserve(slot, (VkDeviceSize)width * height * 4))
+        {
+            m_Dropped++;
+            return;
+        }
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+        // An offscreen render pass already leaves its image ready for transfers, a swapchain image is made so and back
+        const bool transition = layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        if (transition)
+        {
+            barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.oldLayout = layout;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        VkBufferImageCopy region = {};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent.width = width;
+        region.imageExtent.height = height;
+        region.imageExtent.depth = 1;
+        vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.Buffer, 1, &region);
+
+        if (transition)
+        {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = layout;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+        VkBufferMemoryBarrier buffer_barrier = {};
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.buffer = slot.Buffer;
+        buffer_barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+        slot.Serial = serial;
+        slot.Index = index;
+        slot.TimeNs = start - m_StartNs;
+        slot.Width = width;
+        slot.Height = height;
+        slot.Format = (uint32_t)format;
+        slot.State.store(SLOT_COPYING, std::memory_order_relaxed);
+        m_NextCopy = (m_NextCopy + 1) % STAGING_SLOTS;
+        m_Captured++;
+        float ms = (float)((TraceClockNow() - start) / 1.0e6);
+        m_RecordMs += ms;
+        m_MaxRecordMs = std::max(m_MaxRecordMs, ms);
+    }
+
+    void FrameCapture::Poll(uint64_t completedSerial)
+    {
+        bool handed = false;
+        for (;;)
+        {
+            Slot &slot = m_Slots[m_NextPoll];
+            if (slot.State.load(std::memory_order_relaxed) != SLOT_COPYING || slot.Serial > completedSerial)
+                break;
+            slot.State.store(SLOT_ENCODING, std::memory_order_release);
+            m_NextPoll = (m_NextPoll + 1) % STAGING_SLOTS;
+            handed = true;
+        }
+        if (handed)
+        {
+            // Taken so the encoder cannot miss the wakeup between its check and its wait
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Wake.notify_one();
+        }
+    }
+
+    void FrameCapture::encoderMain()
+    {
+        TraceSetThreadName("Frame encoder");
+        for (;;)
+        {
+            Slot &slot = m_Slots[m_NextEncode];
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this, &slot]() { return m_Stop || slot.State.load(std::memory_order_acquire) == SLOT_ENCODING; });
+                // Stop polled everything, anything left is encoded before leaving
+                if (slot.State.load(std::memory_order_acquire) != SLOT_ENCODING)
+                    return;
+            }
+
+            PROFILE_SCOPE("FrameCapture::encode");
+            uint64_t start = TraceClockNow();
+            if (!slot.Coherent)
+            {
+                VkMappedMemoryRange range = {};
+                range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+                range.memory = slot.Memory;
+                range.size = VK_WHOLE_SIZE;
+                vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+            }
+            // The writer closes itself on a failed write, so this is reported once
+            bool open = m_Writer.IsOpen();
+            size_t written = m_Writer.Write((const uint8_t *)slot.Mapped, slot.Width, slot.Height, slot.Format, slot.Index, slot.TimeNs);
+            if (open && written == 0)
+                fprintf(stderr, "[capture] Could not write %s\n", m_Path.c_str());
+            m_Encoded += written != 0 ? 1 : 0;
+            m_RawBytes += (uint64_t)slot.Width * slot.Height * 4;
+            m_WrittenBytes += written;
+            float ms = (float)((TraceClockNow() - start) / 1.0e6);
+            m_EncodeMs += ms;
+            m_MaxEncodeMs = std::max(m_MaxEncodeMs, ms);
+
+            slot.State.store(SLOT_FREE, std::memory_order_release);
+            m_NextEncode = (m_NextEncode + 1) % STAGING_SLOTS;
+        }
+    }
+
+    void FrameCapture::Report(FILE *out) const
+    {
+        fprintf(out, "[capture] %u frames recorded to %s, %u encoded (%u key frames), %u dropped\n",
+                m_Captured, m_Path.c_str(), m_Encoded, m_Writer.GetKeyFrames(), m_Dropped);
+        if (m_Captured == 0)
+            return;
+        fprintf(out, "[capture] frame thread %.4f ms per frame recording the copy (max %.4f ms)\n", m_RecordMs / m_Captured, m_MaxRecordMs);
+        if (m_Encoded > 0)
+            fprintf(out, "[capture] encoder %.3f ms per frame (max %.3f ms), %.1f MiB -> %.2f MiB (%.2f%%)\n",
+                    m_EncodeMs / m_Encoded, m_MaxEncodeMs, m_RawBytes / 1048576.0, m_WrittenBytes / 1048576.0,
+                    m_RawBytes > 0 ? 100.0 * m_WrittenBytes / m_RawBytes : 0.0);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "Renderer/FrameLog.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+namespace Calculator
+{
+    // Records every frame to a frame log without ever making the frame loop wait. After the render pass, the frame's
+    // own command buffer copies its image into the next of STAGING_SLOTS host-visible buffers. Completion is found by
+    // polling submission serials, and a finished slot is handed to an encoder thread that compresses it straight from
+    // the mapped memory. A frame that finds its slot still busy is dropped and counted rather than waited for.
+    class FrameCapture
+    {
+    public:
+        static constexpr uint32_t STAGING_SLOTS = 4;
+
+        ~FrameCapture() { Stop(); }
+
+        bool Start(const char *path, VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *allocator);
+        // The device must be idle. Encodes every copy recorded so far, then stops the encoder and frees the buffers.
+        void Stop();
+        bool IsActive() const { return m_Device != VK_NULL_HANDLE; }
+
+        // Frame thread. Records the copy of image, which is in layout before and is left in it after, for the
+        // submission that will signal serial. Only 4 byte per pixel formats are recorded.
+        void RecordCopy(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout layout, VkFormat format,
+                        uint32_t width, uint32_t height, uint64_t serial);
+        // Frame thread, never blocks. Hands the copies of every submission up to completedSerial to the encoder.
+        void Poll(uint64_t completedSerial);
+
+        // After Stop
+        void Report(FILE *out) const;
+
+    private:
+        enum SlotState : uint32_t
+        {
+            SLOT_FREE,     // Owned by the frame thread
+            SLOT_COPYING,  // Recorded, waiting for its serial
+            SLOT_ENCODING, // Owned by the encoder
+        };
+
+        struct Slot
+        {
+            VkBuffer Buffer = VK_NULL_HANDLE;
+            VkDeviceMemory Memory = VK_NULL_HANDLE;
+            VkDeviceSize Capacity = 0;
+            bool Coherent = false;
+            void *Mapped = nullptr;
+            uint64_t Serial = 0;
+            uint64_t Index = 0;
+            uint64_t TimeNs = 0;
+            uint32_t Width = 0;
+            uint32_t Height = 0;
+            uint32_t Format = 0;
+            std::atomic<uint32_t> State{SLOT_FREE};
+        };
+
+        bool reserve(Slot &slot, VkDeviceSize size);
+        void release(Slot &slot);
+        void encoderMain();
+
+        VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+        VkDevice m_Device = VK_NULL_HANDLE;
+        const VkAllocationCallbacks *m_Allocator = nullptr;
+        Slot m_Slots[STAGING_SLOTS];
+        // Slots are used strictly in turn, so frames reach the encoder in order
+        uint32_t m_NextCopy = 0;   // Frame thread
+        uint32_t m_NextPoll = 0;   // Frame thread
+        uint32_t m_NextEncode = 0; // Encoder
+        uint64_t m_FrameIndex = 0;
+        uint64_t m_StartNs = 0;
+        bool m_WarnedFormat = false;
+
+        FrameLogWriter m_Writer;
+        std::string m_Path;
+        std::thread m_Encoder;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        bool m_Stop = false;
+
+        // Frame thread
+        uint32_t m_Captured = 0;
+        uint32_t m_Dropped = 0;
+        double m_RecordMs = 0.0;
+        float m_MaxRecordMs = 0.0f;
+        // Encoder
+        uint32_t m_Encoded = 0;
+        uint64_t m_RawBytes = 0;
+        uint64_t m_WrittenBytes = 0;
+        double m_EncodeMs = 0.0;
+        float m_MaxEncodeMs = 0.0f;
+    };
+}
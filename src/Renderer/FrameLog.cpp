@@ -0,0 +1,118 @@
+#include "Renderer/FrameLog.h"
+#include "Assets/Lz4.h"
+#include <string.h>
+
+namespace Calculator
+{
+    // 8 bytes at a time, the staging buffers and vectors are always suitably aligned
+    static void xorPixels(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t x, y;
+            memcpy(&x, a + i, 8);
+            memcpy(&y, b + i, 8);
+            x ^= y;
+            memcpy(out + i, &x, 8);
+        }
+        for (; i < size; i++)
+            out[i] = a[i] ^ b[i];
+    }
+
+    bool FrameLogWriter::Open(const char *path)
+    {
+        Close();
+        m_File = fopen(path, "wb");
+        if (m_File == nullptr)
+            return false;
+        m_Width = m_Height = m_Format = 0;
+        m_SinceKeyFrame = 0;
+        m_KeyFrames = 0;
+        if (fwrite(FRAME_LOG_MAGIC, sizeof(FRAME_LOG_MAGIC), 1, m_File) != 1 ||
+            fwrite(&FRAME_LOG_VERSION, sizeof(FRAME_LOG_VERSION), 1, m_File) != 1)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void FrameLogWriter::Close()
+    {
+        if (m_File != nullptr)
+            fclose(m_File);
+        m_File = nullptr;
+    }
+
+    size_t FrameLogWriter::Write(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t format, uint64_t index, uint64_t timeNs)
+    {
+        if (m_File == nullptr)
+            return 0;
+        size_t size = (size_t)width * height * 4;
+        bool key = width != m_Width || height != m_Height || format != m_Format || m_SinceKeyFrame >= KEY_FRAME_INTERVAL;
+        const uint8_t *source = pixels;
+        if (!key)
+        {
+            m_Delta.resize(size);
+            xorPixels(pixels, m_Previous.data(), m_Delta.data(), size);
+            source = m_Delta.data();
+        }
+        m_Compressed.resize(Lz4CompressBound(size));
+        size_t compressed = Lz4Compress(source, size, m_Compressed.data(), m_Compressed.size());
+
+        FrameLogRecord record = {};
+        record.Index = index;
+        record.TimeNs = timeNs;
+        record.Width = width;
+        record.Height = height;
+        record.Format = format;
+        record.Flags = key ? FRAME_LOG_KEY_FRAME : 0;
+        record.CompressedSize = (uint32_t)compressed;
+        if (fwrite(&record, sizeof(record), 1, m_File) != 1 || fwrite(m_Compressed.data(), 1, compressed, m_File) != compressed)
+        {
+            Close();
+            return 0;
+        }
+
+        m_Previous.assign(pixels, pixels + size);
+        m_Width = width;
+        m_Height = height;
+        m_Format = format;
+        m_SinceKeyFrame = key ? 1 : m_SinceKeyFrame + 1;
+        m_KeyFrames += key ? 1 : 0;
+        return sizeof(record) + compressed;
+    }
+
+    bool FrameLogReader::Open(const char *path)
+    {
+        m_Previous.clear();
+        if (!m_File.Open(path) || m_File.Size() < sizeof(FRAME_LOG_MAGIC) + sizeof(uint32_t) ||
+            memcmp(m_File.Data(), FRAME_LOG_MAGIC, sizeof(FRAME_LOG_MAGIC)) != 0)
+            return false;
+        uint32_t version;
+        memcpy(&version, m_File.Data() + sizeof(FRAME_LOG_MAGIC), sizeof(version));
+        m_Offset = sizeof(FRAME_LOG_MAGIC) + sizeof(version);
+        return version == FRAME_LOG_VERSION;
+    }
+
+    bool FrameLogReader::Next(FrameLogRecord &record, std::vector<uint8_t> &pixels)
+    {
+        if (!m_File.IsOpen() || m_File.Size() - m_Offset < sizeof(record))
+            return false;
+        memcpy(&record, m_File.Data() + m_Offset, sizeof(record));
+        size_t size = (size_t)record.Width * record.Height * 4;
+        bool key = (record.Flags & FRAME_LOG_KEY_FRAME) != 0;
+        if (m_File.Size() - m_Offset - sizeof(record) < record.CompressedSize || (!key && m_Previous.size() != size))
+            return false;
+
+        pixels.resize(size);
+        if (!Lz4Decompress(m_File.Data() + m_Offset + sizeof(record), record.CompressedSize, pixels.data(), size))
+            return false;
+        if (!key)
+            xorPixels(pixels.data(), m_Previous.data(), pixels.data(), size);
+        m_Previous = pixels;
+        m_Offset += sizeof(record) + record.CompressedSize;
+        return true;
+    }
+}
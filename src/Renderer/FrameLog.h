@@ -0,0 +1,70 @@
+#pragma once
+#include "Core/Files.h"
+#include <cstdint>
+#include <stdio.h>
+#include <vector>
+
+namespace Calculator
+{
+    static constexpr char FRAME_LOG_MAGIC[8] = {'C', 'A', 'L', 'C', 'F', 'L', 'O', 'G'};
+    static constexpr uint32_t FRAME_LOG_VERSION = 1;
+    static constexpr uint32_t FRAME_LOG_KEY_FRAME = 1; // FrameLogRecord::Flags
+
+    // Precedes each frame's LZ4 block
+    struct FrameLogRecord
+    {
+        uint64_t Index;  // Frame number in the session, gaps are frames the capture dropped
+        uint64_t TimeNs; // Since the recording started
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t Format; // VkFormat, always 4 bytes per pixel
+        uint32_t Flags;
+        uint32_t CompressedSize;
+        uint32_t Reserved;
+    };
+
+    // Lossless frame recording: the magic and version, then a FrameLogRecord and an LZ4 block per frame. A frame is
+    // stored as is, a key frame, or XORed with the previous one, which turns everything that did not change into
+    // zeros that compress to almost nothing. Key frames come every KEY_FRAME_INTERVAL frames and whenever the size
+    // changes, so a log cut short by a crash still decodes up to its last complete record.
+    class FrameLogWriter
+    {
+    public:
+        static constexpr uint32_t KEY_FRAME_INTERVAL = 120;
+
+        ~FrameLogWriter() { Close(); }
+
+        bool Open(const char *path);
+        void Close();
+        bool IsOpen() const { return m_File != nullptr; }
+
+        // pixels holds width * height tightly packed 4 byte pixels. Returns the bytes written, 0 on failure.
+        size_t Write(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t format, uint64_t index, uint64_t timeNs);
+        uint32_t GetKeyFrames() const { return m_KeyFrames; }
+
+    private:
+        FILE *m_File = nullptr;
+        std::vector<uint8_t> m_Previous;
+        std::vector<uint8_t> m_Delta;
+        std::vector<uint8_t> m_Compressed;
+        uint32_t m_Width = 0;
+        uint32_t m_Height = 0;
+        uint32_t m_Format = 0;
+        uint32_t m_SinceKeyFrame = 0;
+        uint32_t m_KeyFrames = 0;
+    };
+
+    class FrameLogReader
+    {
+    public:
+        bool Open(const char *path);
+
+        // Decodes the next frame, false at the end of the log or at a truncated or corrupt record
+        bool Next(FrameLogRecord &record, std::vector<uint8_t> &pixels);
+
+    private:
+        MappedFile m_File;
+        size_t m_Offset = 0;
+        std::vector<uint8_t> m_Previous;
+    };
+}
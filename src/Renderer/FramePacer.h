@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "Calculator/InputEvents.h"
+
+namespace Calculator
+{
+    // Low-latency pacing for FIFO presentation. Without it, a frame samples input and then blocks in
+    // vkAcquireNextImageKHR/vkWaitForFences until the next vblank, so input is always a full wait old.
+    // When enabled, the frame start is delayed to just before the predicted vblank instead.
+    // Vblanks are observed as the moments a blocking swapchain wait returns.
+    class FramePacer
+    {
+        static constexpr uint64_t SAFETY_MARGIN = 1500000;   // 1.5ms of slack left before the vblank
+        static constexpr uint64_t BLOCKED_THRESHOLD = 500000; // Waits shorter than this did not block on a vblank
+
+        bool m_Enabled = false;
+        uint64_t m_RefreshPeriod = 0;
+        uint64_t m_LastVblank = 0;
+        uint64_t m_FrameStart = 0;
+        uint64_t m_WaitBegin = 0;
+        double m_PreWaitWork = 0.0; // Moving average of frame start -> swapchain wait, in ns
+
+        static void sleepUntil(uint64_t target)
+        {
+            // OS sleeps overshoot, so sleep coarsely and yield for the last millisecond
+            uint64_t now = InputClockNow();
+            if (target > now + 1000000)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(target - now - 1000000));
+            while (InputClockNow() < target)
+                std::this_thread::yield();
+        }
+
+    public:
+        void Configure(bool enabled, int refreshRate)
+        {
+            m_Enabled = enabled;
+            m_RefreshPeriod = refreshRate > 0 ? 1000000000ull / refreshRate : 0;
+        }
+
+        bool IsEnabled() const { return m_Enabled; }
+
+        void BeginFrame()
+        {
+            if (m_Enabled && m_LastVblank != 0 && m_RefreshPeriod != 0)
+            {
+                uint64_t now = InputClockNow();
+                uint64_t nextVblank = m_LastVblank + ((now - m_LastVblank) / m_RefreshPeriod + 1) * m_RefreshPeriod;
+                uint64_t lead = (uint64_t)m_PreWaitWork + SAFETY_MARGIN;
+                // Already too late for this vblank: start right away rather than skipping one
+                if (nextVblank > now + lead)
+                    sleepUntil(nextVblank - lead);
+            }
+            m_FrameStart = InputClockNow();
+        }
+
+        void BeginSwapchainWait()
+        {
+            m_WaitBegin = InputClockNow();
+            double work = (double)(m_WaitBegin - m_FrameStart);
+            m_PreWaitWork = m_PreWaitWork == 0.0 ? work : m_PreWaitWork * 0.9 + work * 0.1;
+        }
+
+        void EndSwapchainWait()
+        {
+            uint64_t now = InputClockNow();
+            if (now - m_WaitBegin > BLOCKED_THRESHOLD)
+                m_LastVblank = now;
+        }
+    };
+}
@@ -0,0 +1,130 @@
+#include "Renderer/FrameScheduler.h"
+#include "Calculator/InputEvents.h"
+#include <stdio.h>
+
+namespace Calculator
+{
+    static VkSemaphore createBinarySemaphore(VkDevice device, const VkAllocationCallbacks *allocator)
+    {
+        VkSemaphoreCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        if (vkCreateSemaphore(device, &info, allocator, &semaphore) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+        return semaphore;
+    }
+
+    bool FrameScheduler::Init(VkDevice device, uint32_t queueFamily, const VkAllocationCallbacks *allocator, uint32_t framesInFlight)
+    {
+        m_Device = device;
+        m_Allocator = allocator;
+
+        VkSemaphoreTypeCreateInfo type_info = {};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+        VkSemaphoreCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        info.pNext = &type_info;
+        if (vkCreateSemaphore(device, &info, allocator, &m_Timeline) != VK_SUCCESS)
+        {
+            fprintf(stderr, "[vulkan] Could not create a timeline semaphore, using per-image fences\n");
+            m_Timeline = VK_NULL_HANDLE;
+            return false;
+        }
+
+        m_Frames.resize(framesInFlight < MAX_FRAMES_IN_FLIGHT ? framesInFlight : MAX_FRAMES_IN_FLIGHT);
+        for (uint32_t i = 0; i < (uint32_t)m_Frames.size(); i++)
+        {
+            Frame &frame = m_Frames[i];
+            frame.Index = i;
+
+            VkCommandPoolCreateInfo pool_info = {};
+            pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            pool_info.queueFamilyIndex = queueFamily;
+            VkCommandBufferAllocateInfo buffer_info = {};
+            buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            buffer_info.commandBufferCount = 1;
+            if (vkCreateCommandPool(device, &pool_info, allocator, &frame.CommandPool) != VK_SUCCESS)
+            {
+                frame.CommandPool = VK_NULL_HANDLE;
+                Destroy();
+                return false;
+            }
+            buffer_info.commandPool = frame.CommandPool;
+            if (vkAllocateCommandBuffers(device, &buffer_info, &frame.CommandBuffer) != VK_SUCCESS)
+            {
+                Destroy();
+                return false;
+            }
+        }
+        m_Current = 0;
+        return true;
+    }
+
+    void FrameScheduler::destroySemaphores()
+    {
+        for (Frame &frame : m_Frames)
+        {
+            if (frame.ImageAcquired != VK_NULL_HANDLE)
+                vkDestroySemaphore(m_Device, frame.ImageAcquired, m_Allocator);
+            frame.ImageAcquired = VK_NULL_HANDLE;
+        }
+        for (VkSemaphore semaphore : m_RenderComplete)
+            vkDestroySemaphore(m_Device, semaphore, m_Allocator);
+        m_RenderComplete.clear();
+    }
+
+    void FrameScheduler::Destroy()
+    {
+        destroySemaphores();
+        for (Frame &frame : m_Frames)
+            if (frame.CommandPool != VK_NULL_HANDLE)
+                vkDestroyCommandPool(m_Device, frame.CommandPool, m_Allocator);
+        m_Frames.clear();
+        if (m_Timeline != VK_NULL_HANDLE)
+            vkDestroySemaphore(m_Device, m_Timeline, m_Allocator);
+        m_Timeline = VK_NULL_HANDLE;
+    }
+
+    void FrameScheduler::OnSwapchainCreated(uint32_t imageCount)
+    {
+        if (!IsEnabled())
+            return;
+        destroySemaphores();
+        for (Frame &frame : m_Frames)
+            frame.ImageAcquired = createBinarySemaphore(m_Device, m_Allocator);
+        m_RenderComplete.resize(imageCount);
+        for (VkSemaphore &semaphore : m_RenderComplete)
+            semaphore = createBinarySemaphore(m_Device, m_Allocator);
+    }
+
+    FrameScheduler::Frame &FrameScheduler::BeginFrame(uint64_t *waitNs)
+    {
+        m_Current = (m_Current + 1) % (uint32_t)m_Frames.size();
+        Frame &frame = m_Frames[m_Current];
+        uint64_t start = InputClockNow();
+        if (frame.Serial != 0)
+        {
+            VkSemaphoreWaitInfo info = {};
+            info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            info.semaphoreCount = 1;
+            info.pSemaphores = &m_Timeline;
+            info.pValues = &frame.Serial;
+            VkResult err = vkWaitSemaphores(m_Device, &info, UINT64_MAX);
+            if (err != VK_SUCCESS)
+                fprintf(stderr, "[vulkan] vkWaitSemaphores failed: %d\n", err);
+        }
+        *waitNs = InputClockNow() - start;
+        return frame;
+    }
+
+    uint64_t FrameScheduler::GetCompletedSerial() const
+    {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(m_Device, m_Timeline, &value);
+        return value;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace Calculator
+{
+    // Frames in flight paced by one timeline semaphore instead of the per-swapchain-image fences of
+    // ImGui_ImplVulkanH_Window. Each frame slot owns its command pool and acquire semaphore, so the number of frames
+    // the CPU may run ahead is independent of the swapchain image count. A submission signals its serial on the
+    // timeline, and a slot is reused once the serial it last submitted has been reached.
+    class FrameScheduler
+    {
+    public:
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 8;
+
+        struct Frame
+        {
+            VkCommandPool CommandPool = VK_NULL_HANDLE;
+            VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+            VkSemaphore ImageAcquired = VK_NULL_HANDLE;
+            uint64_t Serial = 0; // Last submitted from this slot, 0 if never
+            uint32_t Index = 0;
+        };
+
+        // Needs a device created with the timelineSemaphore feature. Returns false and stays disabled on failure.
+        bool Init(VkDevice device, uint32_t queueFamily, const VkAllocationCallbacks *allocator, uint32_t framesInFlight);
+        void Destroy();
+
+        bool IsEnabled() const { return m_Timeline != VK_NULL_HANDLE; }
+        uint32_t GetFramesInFlight() const { return (uint32_t)m_Frames.size(); }
+        VkSemaphore GetTimeline() const { return m_Timeline; }
+
+        // Call after the swapchain was (re)created, with the device idle. Recreates the per-image present semaphores,
+        // and the acquire semaphores in case an acquire that was never waited on left one signaled.
+        void OnSwapchainCreated(uint32_t imageCount);
+
+        // Advances to the next slot and blocks until its previous submission has completed. waitNs receives the time spent blocked.
+        Frame &BeginFrame(uint64_t *waitNs);
+        VkSemaphore GetRenderComplete(uint32_t imageIndex) const { return m_RenderComplete[imageIndex]; }
+        uint64_t GetCompletedSerial() const;
+
+    private:
+        void destroySemaphores();
+
+        VkDevice m_Device = VK_NULL_HANDLE;
+        const VkAllocationCallbacks *m_Allocator = nullptr;
+        VkSemaphore m_Timeline = VK_NULL_HANDLE;
+        std::vector<Frame> m_Frames;
+        std::vector<VkSemaphore> m_RenderComplete;
+        uint32_t m_Current = 0;
+    };
+}
@@ -0,0 +1,258 @@
+#include "Renderer/HostAllocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace Calculator
+{
+    namespace
+    {
+        // Sits right before every pointer handed to the driver
+        struct BlockHeader
+        {
+            uint32_t Offset;   // From the start of the malloc block, large allocations only
+            uint8_t SizeClass; // LARGE_CLASS for allocations that bypass the size classes
+            uint8_t Scope;
+            uint16_t Unused;
+            uint64_t Size; // As requested, this is what the accounting counts
+        };
+        static_assert(sizeof(BlockHeader) == 16, "Pooled blocks rely on a 16 byte header to keep 16 byte alignment");
+
+        constexpr uint8_t LARGE_CLASS = 0xFF;
+
+        BlockHeader *headerOf(void *memory)
+        {
+            return (BlockHeader *)memory - 1;
+        }
+
+        size_t blockSize(int sizeClass)
+        {
+            return HostAllocator::MIN_BLOCK_SIZE << sizeClass;
+        }
+
+        // -1 when the allocation has to go to malloc
+        int sizeClassFor(size_t size, size_t alignment)
+        {
+            if (alignment > sizeof(BlockHeader))
+                return -1;
+            size_t total = size + sizeof(BlockHeader);
+            for (int i = 0; i < HostAllocator::SIZE_CLASS_COUNT; i++)
+                if (total <= blockSize(i))
+                    return i;
+            return -1;
+        }
+
+        void atomicMax(std::atomic<uint64_t> &target, uint64_t value)
+        {
+            uint64_t current = target.load(std::memory_order_relaxed);
+            while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+                ;
+        }
+    }
+
+    HostAllocator::HostAllocator()
+    {
+        m_Callbacks.pUserData = this;
+        m_Callbacks.pfnAllocation = allocateCallback;
+        m_Callbacks.pfnReallocation = reallocateCallback;
+        m_Callbacks.pfnFree = freeCallback;
+        m_Callbacks.pfnInternalAllocation = internalAllocationCallback;
+        m_Callbacks.pfnInternalFree = internalFreeCallback;
+    }
+
+    HostAllocator::~HostAllocator()
+    {
+        for (SizeClass &sizeClass : m_Classes)
+        {
+            void *chunk = sizeClass.Chunks;
+            while (chunk != nullptr)
+            {
+                void *next = *(void **)chunk;
+                ::free(chunk);
+                chunk = next;
+            }
+        }
+    }
+
+    bool HostAllocator::account(int scope, int64_t bytes)
+    {
+        if (bytes > 0)
+        {
+            uint64_t limit = m_Limit.load(std::memory_order_relaxed);
+            if (limit != 0 && m_TotalLive.load(std::memory_order_relaxed) + (uint64_t)bytes > limit)
+            {
+                m_Failures.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            atomicMax(m_Peak[scope], m_Live[scope].fetch_add((uint64_t)bytes, std::memory_order_relaxed) + (uint64_t)bytes);
+            atomicMax(m_TotalPeak, m_TotalLive.fetch_add((uint64_t)bytes, std::memory_order_relaxed) + (uint64_t)bytes);
+        }
+        else
+        {
+            m_Live[scope].fetch_sub((uint64_t)-bytes, std::memory_order_relaxed);
+            m_TotalLive.fetch_sub((uint64_t)-bytes, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    void *HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        if (size == 0)
+            return nullptr;
+        if (!account(scope, (int64_t)size))
+            return nullptr;
+        m_Allocations[scope].fetch_add(1, std::memory_order_relaxed);
+
+        BlockHeader *header;
+        int sizeClassIndex = sizeClassFor(size, alignment);
+        if (sizeClassIndex >= 0)
+        {
+            SizeClass &sizeClass = m_Classes[sizeClassIndex];
+            std::lock_guard<std::mutex> lock(sizeClass.Mutex);
+            if (sizeClass.FreeList == nullptr)
+            {
+                // The first block of a chunk holds the chunk list link, the rest go on the free list
+                uint8_t *chunk = (uint8_t *)malloc(CHUNK_SIZE);
+                if (chunk == nullptr)
+                {
+                    account(scope, -(int64_t)size);
+                    m_Failures.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                *(void **)chunk = sizeClass.Chunks;
+                sizeClass.Chunks = chunk;
+                size_t stride = blockSize(sizeClassIndex);
+                for (size_t offset = CHUNK_SIZE - stride; offset >= stride; offset -= stride)
+                {
+                    *(void **)(chunk + offset) = sizeClass.FreeList;
+                    sizeClass.FreeList = chunk + offset;
+                }
+                m_Pooled.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+            }
+            header = (BlockHeader *)sizeClass.FreeList;
+            sizeClass.FreeList = *(void **)sizeClass.FreeList;
+            header->Offset = 0;
+            header->SizeClass = (uint8_t)sizeClassIndex;
+        }
+        else
+        {
+            if (alignment < sizeof(BlockHeader))
+                alignment = sizeof(BlockHeader);
+            uint8_t *base = (uint8_t *)malloc(size + alignment + sizeof(BlockHeader));
+            if (base == nullptr)
+            {
+                account(scope, -(int64_t)size);
+                m_Failures.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            uintptr_t user = ((uintptr_t)base + sizeof(BlockHeader) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+            header = (BlockHeader *)user - 1;
+            header->Offset = (uint32_t)(user - (uintptr_t)base);
+            header->SizeClass = LARGE_CLASS;
+        }
+        header->Scope = (uint8_t)scope;
+        header->Unused = 0;
+        header->Size = size;
+        return header + 1;
+    }
+
+    void HostAllocator::free(void *memory)
+    {
+        if (memory == nullptr)
+            return;
+        BlockHeader *header = headerOf(memory);
+        account(header->Scope, -(int64_t)header->Size);
+        if (header->SizeClass == LARGE_CLASS)
+        {
+            ::free((uint8_t *)memory - header->Offset);
+            return;
+        }
+        SizeClass &sizeClass = m_Classes[header->SizeClass];
+        std::lock_guard<std::mutex> lock(sizeClass.Mutex);
+        *(void **)header = sizeClass.FreeList;
+        sizeClass.FreeList = header;
+    }
+
+    void *HostAllocator::reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        if (original == nullptr)
+            return allocate(size, alignment, scope);
+        if (size == 0)
+        {
+            free(original);
+            return nullptr;
+        }
+
+        // Grow or shrink in place while the block still fits
+        BlockHeader *header = headerOf(original);
+        if (header->SizeClass != LARGE_CLASS && alignment <= sizeof(BlockHeader) && size + sizeof(BlockHeader) <= blockSize(header->SizeClass))
+        {
+            if (!account(header->Scope, (int64_t)size - (int64_t)header->Size))
+                return nullptr;
+            header->Size = size;
+            return original;
+        }
+
+        // The original stays valid when this fails, as the spec requires
+        void *memory = allocate(size, alignment, scope);
+        if (memory == nullptr)
+            return nullptr;
+        memcpy(memory, original, size < header->Size ? size : (size_t)header->Size);
+        free(original);
+        return memory;
+    }
+
+    HostAllocationStats HostAllocator::GetStats() const
+    {
+        HostAllocationStats stats;
+        for (int scope = 0; scope < HOST_ALLOCATION_SCOPE_COUNT; scope++)
+        {
+            stats.LiveBytes[scope] = m_Live[scope].load(std::memory_order_relaxed);
+            stats.PeakBytes[scope] = m_Peak[scope].load(std::memory_order_relaxed);
+            stats.Allocations[scope] = m_Allocations[scope].load(std::memory_order_relaxed);
+        }
+        stats.TotalLiveBytes = m_TotalLive.load(std::memory_order_relaxed);
+        stats.TotalPeakBytes = m_TotalPeak.load(std::memory_order_relaxed);
+        stats.InternalBytes = m_Internal.load(std::memory_order_relaxed);
+        stats.PooledBytes = m_Pooled.load(std::memory_order_relaxed);
+        stats.Failures = m_Failures.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void HostAllocator::Report(FILE *out) const
+    {
+        HostAllocationStats stats = GetStats();
+        fprintf(out, "[host memory] live %.1f KiB, peak %.1f KiB, %.1f KiB in size class chunks, %.1f KiB driver internal",
+                stats.TotalLiveBytes / 1024.0, stats.TotalPeakBytes / 1024.0, stats.PooledBytes / 1024.0, stats.InternalBytes / 1024.0);
+        if (stats.Failures > 0)
+            fprintf(out, ", %llu failed", (unsigned long long)stats.Failures);
+        fprintf(out, "\n");
+        for (int scope = 0; scope < HOST_ALLOCATION_SCOPE_COUNT; scope++)
+            fprintf(out, "[host memory]   %-8s live %8.1f KiB  peak %8.1f KiB  %llu allocations\n", HOST_ALLOCATION_SCOPE_NAMES[scope],
+                    stats.LiveBytes[scope] / 1024.0, stats.PeakBytes[scope] / 1024.0, (unsigned long long)stats.Allocations[scope]);
+    }
+
+    void *VKAPI_PTR HostAllocator::allocateCallback(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        return ((HostAllocator *)userData)->allocate(size, alignment, scope);
+    }
+
+    void *VKAPI_PTR HostAllocator::reallocateCallback(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+    {
+        return ((HostAllocator *)userData)->reallocate(original, size, alignment, scope);
+    }
+
+    void VKAPI_PTR HostAllocator::freeCallback(void *userData, void *memory)
+    {
+        ((HostAllocator *)userData)->free(memory);
+    }
+
+    void VKAPI_PTR HostAllocator::internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+    {
+        ((HostAllocator *)userData)->m_Internal.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void VKAPI_PTR HostAllocator::internalFreeCallback(void *userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+    {
+        ((HostAllocator *)userData)->m_Internal.fetch_sub(size, std::memory_order_relaxed);
+    }
+}
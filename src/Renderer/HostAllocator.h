@@ -0,0 +1,88 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdio.h>
+
+namespace Calculator
+{
+    static constexpr int HOST_ALLOCATION_SCOPE_COUNT = 5;
+
+    static const char *HOST_ALLOCATION_SCOPE_NAMES[HOST_ALLOCATION_SCOPE_COUNT] = {
+        "command",
+        "object",
+        "cache",
+        "device",
+        "instance",
+    };
+
+    struct HostAllocationStats
+    {
+        uint64_t LiveBytes[HOST_ALLOCATION_SCOPE_COUNT] = {};
+        uint64_t PeakBytes[HOST_ALLOCATION_SCOPE_COUNT] = {};
+        uint64_t Allocations[HOST_ALLOCATION_SCOPE_COUNT] = {}; // Total number of calls, not live blocks
+        uint64_t TotalLiveBytes = 0;
+        uint64_t TotalPeakBytes = 0;
+        uint64_t InternalBytes = 0; // Reported through pfnInternalAllocation, the driver allocated these itself
+        uint64_t PooledBytes = 0;   // Chunk memory held by the size classes, used or not
+        uint64_t Failures = 0;      // Allocations refused by the limit or by malloc
+    };
+
+    // VkAllocationCallbacks that serve small driver allocations from per-size-class free lists carved out of 64 KiB
+    // chunks and larger or over-aligned ones from malloc, counting live and peak bytes per VkSystemAllocationScope.
+    // Chunks are kept until the allocator is destroyed, so it must outlive every Vulkan object created with it.
+    // Drivers call these from any thread.
+    class HostAllocator
+    {
+    public:
+        static constexpr size_t MIN_BLOCK_SIZE = 32;
+        static constexpr int SIZE_CLASS_COUNT = 8; // 32 bytes to 4 KiB, header included
+        static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+        HostAllocator();
+        ~HostAllocator();
+        HostAllocator(const HostAllocator &) = delete;
+        HostAllocator &operator=(const HostAllocator &) = delete;
+
+        const VkAllocationCallbacks *Callbacks() const { return &m_Callbacks; }
+
+        // Allocations that would take the live total past bytes fail, which Vulkan reports as VK_ERROR_OUT_OF_HOST_MEMORY.
+        // 0 removes the limit.
+        void SetLimit(uint64_t bytes) { m_Limit.store(bytes, std::memory_order_relaxed); }
+
+        HostAllocationStats GetStats() const;
+        void Report(FILE *out) const;
+
+    private:
+        struct SizeClass
+        {
+            std::mutex Mutex;
+            void *FreeList = nullptr;
+            void *Chunks = nullptr; // Linked through the first pointer of each chunk
+        };
+
+        void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void *reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void free(void *memory);
+        bool account(int scope, int64_t bytes);
+
+        static void *VKAPI_PTR allocateCallback(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static void *VKAPI_PTR reallocateCallback(void *userData, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static void VKAPI_PTR freeCallback(void *userData, void *memory);
+        static void VKAPI_PTR internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+        static void VKAPI_PTR internalFreeCallback(void *userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+        VkAllocationCallbacks m_Callbacks;
+        SizeClass m_Classes[SIZE_CLASS_COUNT];
+        std::atomic<uint64_t> m_Live[HOST_ALLOCATION_SCOPE_COUNT] = {};
+        std::atomic<uint64_t> m_Peak[HOST_ALLOCATION_SCOPE_COUNT] = {};
+        std::atomic<uint64_t> m_Allocations[HOST_ALLOCATION_SCOPE_COUNT] = {};
+        std::atomic<uint64_t> m_TotalLive{0};
+        std::atomic<uint64_t> m_TotalPeak{0};
+        std::atomic<uint64_t> m_Internal{0};
+        std::atomic<uint64_t> m_Pooled{0};
+        std::atomic<uint64_t> m_Failures{0};
+        std::atomic<uint64_t> m_Limit{0};
+    };
+}
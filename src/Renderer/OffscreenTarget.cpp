@@ -0,0 +1,312 @@
+#include "Renderer/OffscreenTarget.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace Calculator
+{
+    bool OffscreenTarget::Create(ImGui_ImplVulkanH_Window *wd, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+                                 const VkAllocationCallbacks *allocator, int width, int height, uint32_t imageCount)
+    {
+        IM_ASSERT(wd->Frames == nullptr && wd->Swapchain == VK_NULL_HANDLE);
+        m_Window = wd;
+        m_PhysicalDevice = physicalDevice;
+        m_Device = device;
+        m_Allocator = allocator;
+
+        wd->Width = width;
+        wd->Height = height;
+        wd->SurfaceFormat.format = FORMAT;
+        wd->SurfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+        wd->ImageCount = imageCount;
+        wd->FrameIndex = 0;
+        wd->SemaphoreIndex = 0;
+        wd->Frames = (ImGui_ImplVulkanH_Frame *)IM_ALLOC(sizeof(ImGui_ImplVulkanH_Frame) * imageCount);
+        memset(wd->Frames, 0, sizeof(wd->Frames[0]) * imageCount);
+        m_Memory.assign(imageCount, VK_NULL_HANDLE);
+        if (!createRenderPass())
+        {
+            Destroy();
+            return false;
+        }
+
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            ImGui_ImplVulkanH_Frame &fd = wd->Frames[i];
+            if (!createImage(fd, m_Memory[i]))
+            {
+                Destroy();
+                return false;
+            }
+
+            // Same per-image resources as the backend creates, the fence starts signaled for the first wait
+            VkCommandPoolCreateInfo pool_info = {};
+            pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            pool_info.queueFamilyIndex = queueFamily;
+            VkCommandBufferAllocateInfo buffer_info = {};
+            buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            buffer_info.commandBufferCount = 1;
+            VkFenceCreateInfo fence_info = {};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            if (vkCreateCommandPool(m_Device, &pool_info, m_Allocator, &fd.CommandPool) != VK_SUCCESS)
+            {
+                fd.CommandPool = VK_NULL_HANDLE;
+                Destroy();
+                return false;
+            }
+            buffer_info.commandPool = fd.CommandPool;
+            if (vkAllocateCommandBuffers(m_Device, &buffer_info, &fd.CommandBuffer) != VK_SUCCESS ||
+                vkCreateFence(m_Device, &fence_info, m_Allocator, &fd.Fence) != VK_SUCCESS)
+            {
+                Destroy();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void OffscreenTarget::Destroy()
+    {
+        if (m_Window == nullptr)
+            return;
+        ImGui_ImplVulkanH_Window *wd = m_Window;
+        for (uint32_t i = 0; i < wd->ImageCount; i++)
+        {
+            ImGui_ImplVulkanH_Frame &fd = wd->Frames[i];
+            vkDestroyFence(m_Device, fd.Fence, m_Allocator);
+            if (fd.CommandPool != VK_NULL_HANDLE)
+            {
+                vkFreeCommandBuffers(m_Device, fd.CommandPool, 1, &fd.CommandBuffer);
+                vkDestroyCommandPool(m_Device, fd.CommandPool, m_Allocator);
+            }
+            vkDestroyFramebuffer(m_Device, fd.Framebuffer, m_Allocator);
+            vkDestroyImageView(m_Device, fd.BackbufferView, m_Allocator);
+            vkDestroyImage(m_Device, fd.Backbuffer, m_Allocator);
+            vkFreeMemory(m_Device, m_Memory[i], m_Allocator);
+        }
+        IM_FREE(wd->Frames);
+        wd->Frames = nullptr;
+        wd->ImageCount = 0;
+        vkDestroyRenderPass(m_Device, wd->RenderPass, m_Allocator);
+        wd->RenderPass = VK_NULL_HANDLE;
+        m_Memory.clear();
+        m_Window = nullptr;
+    }
+
+    // The images are left ready to be copied from after every frame, so a readback needs no layout transition
+    bool OffscreenTarget::createRenderPass()
+    {
+        VkAttachmentDescription attachment = {};
+        attachment.format = FORMAT;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = m_Window->ClearEnable ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        VkAttachmentReference color_attachment = {};
+        color_attachment.attachment = 0;
+        color_attachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &color_attachment;
+        VkSubpassDependency dependencies[2] = {};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        VkRenderPassCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        info.attachmentCount = 1;
+        info.pAttachments = &attachment;
+        info.subpassCount = 1;
+        info.pSubpasses = &subpass;
+        info.dependencyCount = 2;
+        info.pDependencies = dependencies;
+        if (vkCreateRenderPass(m_Device, &info, m_Allocator, &m_Window->RenderPass) != VK_SUCCESS)
+        {
+            m_Window->RenderPass = VK_NULL_HANDLE;
+            return false;
+        }
+        return true;
+    }
+
+    bool OffscreenTarget::createImage(ImGui_ImplVulkanH_Frame &fd, VkDeviceMemory &memory)
+    {
+        VkImageCreateInfo image_info = {};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = FORMAT;
+        image_info.extent.width = (uint32_t)m_Window->Width;
+        image_info.extent.height = (uint32_t)m_Window->Height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_Device, &image_info, m_Allocator, &fd.Backbuffer) != VK_SUCCESS)
+        {
+            fd.Backbuffer = VK_NULL_HANDLE;
+            return false;
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_Device, fd.Backbuffer, &requirements);
+        VkMemoryAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = requirements.size;
+        alloc_info.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (alloc_info.memoryTypeIndex == UINT32_MAX || vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &memory) != VK_SUCCESS)
+        {
+            fprintf(stderr, "[vulkan] Could not allocate a %dx%d offscreen image\n", m_Window->Width, m_Window->Height);
+            memory = VK_NULL_HANDLE;
+            return false;
+        }
+        if (vkBindImageMemory(m_Device, fd.Backbuffer, memory, 0) != VK_SUCCESS)
+            return false;
+
+        VkImageViewCreateInfo view_info = {};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = fd.Backbuffer;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = FORMAT;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(m_Device, &view_info, m_Allocator, &fd.BackbufferView) != VK_SUCCESS)
+        {
+            fd.BackbufferView = VK_NULL_HANDLE;
+            return false;
+        }
+
+        VkFramebufferCreateInfo framebuffer_info = {};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = m_Window->RenderPass;
+        framebuffer_info.attachmentCount = 1;
+        framebuffer_info.pAttachments = &fd.BackbufferView;
+        framebuffer_info.width = (uint32_t)m_Window->Width;
+        framebuffer_info.height = (uint32_t)m_Window->Height;
+        framebuffer_info.layers = 1;
+        if (vkCreateFramebuffer(m_Device, &framebuffer_info, m_Allocator, &fd.Framebuffer) != VK_SUCCESS)
+        {
+            fd.Framebuffer = VK_NULL_HANDLE;
+            return false;
+        }
+        return true;
+    }
+
+    // Prefers a type with every preferred flag, and falls back to one with only the required flags
+    uint32_t OffscreenTarget::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const
+    {
+        VkPhysicalDeviceMemoryProperties properties;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &properties);
+        const VkMemoryPropertyFlags passes[2] = {required | preferred, required};
+        for (VkMemoryPropertyFlags flags : passes)
+            for (uint32_t i = 0; i < properties.memoryTypeCount; i++)
+                if ((typeBits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & flags) == flags)
+                    return i;
+        return UINT32_MAX;
+    }
+
+    bool OffscreenTarget::Readback(VkQueue queue, uint32_t imageIndex, std::vector<uint8_t> &pixels)
+    {
+        if (m_Window == nullptr || imageIndex >= m_Window->ImageCount || vkDeviceWaitIdle(m_Device) != VK_SUCCESS)
+            return false;
+        ImGui_ImplVulkanH_Frame &fd = m_Window->Frames[imageIndex];
+        VkDeviceSize size = (VkDeviceSize)m_Window->Width * m_Window->Height * 4;
+
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        bool ok = vkCreateBuffer(m_Device, &buffer_info, m_Allocator, &buffer) == VK_SUCCESS;
+        if (ok)
+        {
+            VkMemoryRequirements requirements;
+            vkGetBufferMemoryRequirements(m_Device, buffer, &requirements);
+            VkMemoryAllocateInfo alloc_info = {};
+            alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            alloc_info.allocationSize = requirements.size;
+            alloc_info.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+            ok = alloc_info.memoryTypeIndex != UINT32_MAX &&
+                 vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &memory) == VK_SUCCESS &&
+                 vkBindBufferMemory(m_Device, buffer, memory, 0) == VK_SUCCESS;
+        }
+
+        // The render pass left the image in TRANSFER_SRC_OPTIMAL and made its writes visible to transfers
+        if (ok)
+        {
+            VkCommandBufferBeginInfo begin_info = {};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            ok = vkResetCommandPool(m_Device, fd.CommandPool, 0) == VK_SUCCESS &&
+                 vkBeginCommandBuffer(fd.CommandBuffer, &begin_info) == VK_SUCCESS;
+        }
+        if (ok)
+        {
+            VkBufferImageCopy region = {};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent.width = (uint32_t)m_Window->Width;
+            region.imageExtent.height = (uint32_t)m_Window->Height;
+            region.imageExtent.depth = 1;
+            vkCmdCopyImageToBuffer(fd.CommandBuffer, fd.Backbuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(fd.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+            VkSubmitInfo submit_info = {};
+            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers = &fd.CommandBuffer;
+            ok = vkEndCommandBuffer(fd.CommandBuffer) == VK_SUCCESS &&
+                 vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS &&
+                 vkQueueWaitIdle(queue) == VK_SUCCESS;
+        }
+
+        void *mapped = nullptr;
+        if (ok && vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) == VK_SUCCESS)
+        {
+            // Harmless on coherent memory, needed on the rest
+            VkMappedMemoryRange range = {};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = memory;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+            pixels.resize((size_t)size);
+            memcpy(pixels.data(), mapped, (size_t)size);
+            vkUnmapMemory(m_Device, memory);
+        }
+        else
+            ok = false;
+
+        vkDestroyBuffer(m_Device, buffer, m_Allocator);
+        vkFreeMemory(m_Device, memory, m_Allocator);
+        if (!ok)
+            fprintf(stderr, "[vulkan] Offscreen readback failed\n");
+        return ok;
+    }
+}
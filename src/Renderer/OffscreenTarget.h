@@ -0,0 +1,38 @@
+#pragma once
+#include "backends/imgui_impl_vulkan.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace Calculator
+{
+    // Stands in for the window surface and swapchain when rendering headless: a ring of color images, each with the
+    // command pool, fence and framebuffer ImGui_ImplVulkanH_CreateOrResizeWindow would create for a swapchain image.
+    // The ImGui_ImplVulkanH_Window it fills has no Swapchain, which is how FrameRender tells it apart.
+    class OffscreenTarget
+    {
+    public:
+        static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+        ~OffscreenTarget() { Destroy(); }
+
+        // wd must be empty, and must not be passed to ImGui_ImplVulkanH_DestroyWindow: Destroy frees what this filled in
+        bool Create(ImGui_ImplVulkanH_Window *wd, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+                    const VkAllocationCallbacks *allocator, int width, int height, uint32_t imageCount);
+        void Destroy();
+
+        // Waits for the device, then copies the image to tightly packed RGBA8 rows. Only call outside of a frame.
+        bool Readback(VkQueue queue, uint32_t imageIndex, std::vector<uint8_t> &pixels);
+
+    private:
+        bool createRenderPass();
+        bool createImage(ImGui_ImplVulkanH_Frame &fd, VkDeviceMemory &memory);
+        uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const;
+
+        ImGui_ImplVulkanH_Window *m_Window = nullptr;
+        VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+        VkDevice m_Device = VK_NULL_HANDLE;
+        const VkAllocationCallbacks *m_Allocator = nullptr;
+        std::vector<VkDeviceMemory> m_Memory; // Per image, the frames only hold the image
+    };
+}
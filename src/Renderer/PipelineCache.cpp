@@ -0,0 +1,98 @@
+#include "Renderer/PipelineCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "Core/Files.h"
+
+namespace Calculator
+{
+    // Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, which starts every cache blob
+    struct PipelineCacheHeader
+    {
+        uint32_t HeaderSize;
+        uint32_t HeaderVersion;
+        uint32_t VendorID;
+        uint32_t DeviceID;
+        uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+    };
+
+    static std::filesystem::path getPipelineCachePath(const VkPhysicalDeviceProperties &properties)
+    {
+        std::filesystem::path dir = GetCacheDirectory();
+        if (dir.empty())
+            return {};
+        char name[64];
+        snprintf(name, sizeof(name), "pipeline-%04x-%04x.bin", properties.vendorID, properties.deviceID);
+        return dir / name;
+    }
+
+    static bool isCompatible(const uint8_t *data, size_t size, const VkPhysicalDeviceProperties &properties)
+    {
+        if (size < sizeof(PipelineCacheHeader))
+            return false;
+        PipelineCacheHeader header;
+        memcpy(&header, data, sizeof(header));
+        return header.HeaderSize >= sizeof(PipelineCacheHeader) &&
+               header.HeaderSize <= size &&
+               header.HeaderVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               header.VendorID == properties.vendorID &&
+               header.DeviceID == properties.deviceID &&
+               memcmp(header.PipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    VkPipelineCache CreatePipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *allocator, bool *hit)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        std::filesystem::path path = getPipelineCachePath(properties);
+        MappedFile file;
+        if (!path.empty() && file.Open(path) && !isCompatible(file.Data(), file.Size(), properties))
+        {
+            fprintf(stderr, "[cache] Ignoring %s, it was written by another device or driver\n", path.string().c_str());
+            file.Close();
+        }
+
+        VkPipelineCacheCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        info.initialDataSize = file.Size();
+        info.pInitialData = file.Data();
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        VkResult err = vkCreatePipelineCache(device, &info, allocator, &cache);
+        if (err != VK_SUCCESS && file.IsOpen())
+        {
+            // The driver rejected the blob despite a matching header, start empty
+            info.initialDataSize = 0;
+            info.pInitialData = nullptr;
+            file.Close();
+            err = vkCreatePipelineCache(device, &info, allocator, &cache);
+        }
+        if (err != VK_SUCCESS)
+            cache = VK_NULL_HANDLE;
+        if (hit)
+            *hit = file.IsOpen();
+        return cache;
+    }
+
+    void SavePipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, VkPipelineCache cache)
+    {
+        if (cache == VK_NULL_HANDLE)
+            return;
+
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0)
+            return;
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+            return;
+        data.resize(size);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        std::filesystem::path path = getPipelineCachePath(properties);
+        if (path.empty())
+            return;
+
+        WriteFileAtomic(path, data.data(), data.size());
+    }
+}
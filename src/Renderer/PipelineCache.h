@@ -0,0 +1,12 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+namespace Calculator
+{
+    // Creates a pipeline cache seeded from this device's cache file when its header matches the device's
+    // vendor, device and pipelineCacheUUID, and an empty one otherwise. hit is set when the file was used.
+    VkPipelineCache CreatePipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks *allocator, bool *hit = nullptr);
+
+    // Writes the cache back atomically, so a crash never leaves a truncated cache behind
+    void SavePipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, VkPipelineCache cache);
+}
@@ -0,0 +1,97 @@
+#include "Renderer/RenderThread.h"
+#include "Profiling/Trace.h"
+
+namespace Calculator
+{
+    void RenderThread::Start(RenderFn render)
+    {
+        if (IsRunning())
+            return;
+        m_Render = std::move(render);
+        m_Stop = false;
+        m_Thread = std::thread([this]() { run(); });
+    }
+
+    void RenderThread::Stop()
+    {
+        if (!IsRunning())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+    }
+
+    RenderFrame &RenderThread::Publish()
+    {
+        m_Frames[m_Back].Status = RenderFrame::State::Pending;
+        uint32_t previous = m_Ready.exchange(m_Back | NEW_FRAME, std::memory_order_acq_rel);
+        m_Back = previous & ~NEW_FRAME;
+        {
+            // Pairs with the predicate check in run, so the wake up cannot fall between the check and the wait
+            std::lock_guard<std::mutex> lock(m_Mutex);
+        }
+        m_Wake.notify_one();
+        return m_Frames[m_Back];
+    }
+
+    void RenderThread::Pause()
+    {
+        if (!IsRunning())
+            return;
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_PauseRequested = true;
+        m_Wake.notify_one();
+        m_PausedChanged.wait(lock, [this]() { return m_Paused; });
+    }
+
+    void RenderThread::Resume()
+    {
+        if (!IsRunning())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_PauseRequested = false;
+        }
+        m_Wake.notify_one();
+    }
+
+    // The frame given back keeps its status, Pending tells the main thread it was never rendered
+    void RenderThread::takeReady()
+    {
+        if ((m_Ready.load(std::memory_order_acquire) & NEW_FRAME) == 0)
+            return;
+        m_Front = m_Ready.exchange(m_Front, std::memory_order_acq_rel) & ~NEW_FRAME;
+    }
+
+    void RenderThread::run()
+    {
+        TraceSetThreadName("Render");
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this]()
+                            { return m_Stop || m_PauseRequested || (m_Ready.load(std::memory_order_acquire) & NEW_FRAME) != 0; });
+                if (m_Stop)
+                    return;
+                if (m_PauseRequested)
+                {
+                    takeReady();
+                    m_Paused = true;
+                    m_PausedChanged.notify_all();
+                    m_Wake.wait(lock, [this]() { return m_Stop || !m_PauseRequested; });
+                    m_Paused = false;
+                    continue;
+                }
+            }
+
+            takeReady();
+            RenderFrame &frame = m_Frames[m_Front];
+            m_Render(frame);
+            frame.Status = RenderFrame::State::Rendered;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Renderer/DrawDataSnapshot.h"
+
+namespace Calculator
+{
+    // What the render thread measured for a frame, handed back to the main thread with the frame
+    struct FrameTimings
+    {
+        float GpuWaitMs = 0.0f;
+        float GpuMs = -1.0f; // Render pass time of an earlier frame that finished meanwhile, negative if none did
+        float FrameRenderMs = 0.0f;
+        float FramePresentMs = 0.0f;
+        uint64_t SubmitTime = 0;
+        uint64_t PresentTime = 0; // 0 if the frame was not presented
+    };
+
+    struct RenderFrame
+    {
+        enum class State
+        {
+            Empty,    // Nothing to report
+            Pending,  // Published, and replaced by a newer frame or dropped by a pause before it was rendered
+            Rendered, // Timings are filled in
+        };
+
+        DrawDataSnapshot DrawData;
+        std::vector<uint64_t> Inputs; // Timestamps of the input events applied before this frame
+        FrameTimings Timings;
+        State Status = State::Empty;
+    };
+
+    // Renders and presents snapshots of the main viewport's draw data on its own thread, so the main thread polls
+    // input and builds the UI without ever waiting on vkAcquireNextImageKHR, the frame fences or vkQueuePresentKHR.
+    // Frames are handed over through a triple-buffered mailbox swapped with atomic exchanges: the main thread
+    // always owns one frame to fill, the render thread one to render, and the newest published frame waits in
+    // between, replaced if the render thread falls behind.
+    class RenderThread
+    {
+    public:
+        using RenderFn = std::function<void(RenderFrame &)>;
+
+        ~RenderThread() { Stop(); }
+
+        void Start(RenderFn render);
+        void Stop();
+        bool IsRunning() const { return m_Thread.joinable(); }
+
+        // Main thread only. The frame to fill before Publish.
+        RenderFrame &Back() { return m_Frames[m_Back]; }
+
+        // Hands the back frame over and returns the new back frame, which carries the outcome of an older frame
+        RenderFrame &Publish();
+
+        // True while the last published frame has not been taken by the render thread
+        bool HasPendingFrame() const { return (m_Ready.load(std::memory_order_acquire) & NEW_FRAME) != 0; }
+
+        // Blocks until the render thread is between frames, and keeps it there until Resume. A published frame that
+        // was not rendered yet is dropped, as it may use resources the main thread is about to replace.
+        // In between, the main thread may recreate the swapchain, reload textures or idle the device.
+        void Pause();
+        void Resume();
+
+    private:
+        static constexpr uint32_t NEW_FRAME = 4; // Set in m_Ready while the frame in it has not been taken
+
+        void run();
+        void takeReady();
+
+        RenderFrame m_Frames[3];
+        uint32_t m_Back = 0;  // Main thread
+        uint32_t m_Front = 1; // Render thread
+        std::atomic<uint32_t> m_Ready{2};
+
+        RenderFn m_Render;
+        std::thread m_Thread;
+        // Only held to sleep and wake, never while rendering
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::condition_variable m_PausedChanged;
+        bool m_Stop = false;
+        bool m_PauseRequested = false;
+        bool m_Paused = false;
+    };
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+struct ImDrawList;
+
+// Implemented in imgui_impl.cpp, next to the ImGui Vulkan backend whose pipeline layout and vertex shader it shares
+namespace Calculator
+{
+    // Call after ImGui_ImplVulkan_Init. Returns false if the SDF pipeline is unavailable, SDF fonts must not be used then.
+    bool CreateSdfTextPipeline(VkRenderPass renderPass);
+    void DestroySdfTextPipeline();
+    bool IsSdfTextAvailable();
+
+    // The command buffer the main viewport's draw data is recorded into, set around ImGui_ImplVulkan_RenderDrawData
+    void SetSdfTextCommandBuffer(VkCommandBuffer commandBuffer);
+
+    // Text added to drawList between these two calls is drawn with the distance field shader
+    void BeginSdfText(ImDrawList *drawList);
+    void EndSdfText(ImDrawList *drawList);
+}
@@ -0,0 +1,279 @@
+#include "Renderer/SoftwarePresenter.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define GLFW_EXPOSE_NATIVE_WIN32
+#else
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#define GLFW_EXPOSE_NATIVE_X11
+#endif
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <GLFW/glfw3native.h>
+
+namespace Calculator
+{
+#ifdef _WIN32
+    struct SoftwarePresenter::Native
+    {
+        HWND Window = nullptr;
+        HDC MemoryDC = nullptr;
+        HBITMAP Bitmap = nullptr;
+        HGDIOBJ OldBitmap = nullptr;
+    };
+#else
+    struct SoftwarePresenter::Native
+    {
+        Display *Dpy = nullptr;
+        Window Win = 0;
+        Visual *Vis = nullptr;
+        int Depth = 0;
+        GC Gc = nullptr;
+        XImage *Image = nullptr;
+        XShmSegmentInfo Shm = {};
+        bool UseShm = false; // Cleared for good once attaching a segment fails, eg. for a remote X server
+    };
+
+    // XShmAttach reports failure asynchronously, through the error handler
+    static bool s_ShmAttachFailed = false;
+
+    static int ShmErrorHandler(Display *, XErrorEvent *)
+    {
+        s_ShmAttachFailed = true;
+        return 0;
+    }
+#endif
+
+    SoftwarePresenter::SoftwarePresenter() = default;
+
+    SoftwarePresenter::~SoftwarePresenter()
+    {
+        Shutdown();
+    }
+
+    bool SoftwarePresenter::Init(GLFWwindow *window)
+    {
+        Shutdown();
+        m_Window = window;
+        if (window == nullptr)
+            return true;
+
+        m_Native = std::make_unique<Native>();
+        Native &n = *m_Native;
+#ifdef _WIN32
+        n.Window = glfwGetWin32Window(window);
+        n.MemoryDC = CreateCompatibleDC(nullptr);
+        if (n.Window == nullptr || n.MemoryDC == nullptr)
+        {
+            Shutdown();
+            return false;
+        }
+#else
+        // Null when GLFW runs on Wayland
+        n.Dpy = glfwGetX11Display();
+        n.Win = glfwGetX11Window(window);
+        XWindowAttributes attributes;
+        if (n.Dpy == nullptr || n.Win == 0 || !XGetWindowAttributes(n.Dpy, n.Win, &attributes))
+        {
+            Shutdown();
+            return false;
+        }
+        // The framebuffer is written as 0xAARRGGBB, which only a 24 or 32 bit TrueColor visual takes as is
+        n.Vis = attributes.visual;
+        n.Depth = attributes.depth;
+        if (n.Vis->red_mask != 0xFF0000 || n.Vis->green_mask != 0xFF00 || n.Vis->blue_mask != 0xFF || n.Depth < 24)
+        {
+            fprintf(stderr, "[software] Unsupported X visual, depth %d\n", n.Depth);
+            Shutdown();
+            return false;
+        }
+        n.Gc = XCreateGC(n.Dpy, n.Win, 0, nullptr);
+        n.UseShm = XShmQueryExtension(n.Dpy);
+#endif
+        return true;
+    }
+
+    void SoftwarePresenter::Shutdown()
+    {
+        release();
+        if (m_Native)
+        {
+#ifdef _WIN32
+            if (m_Native->MemoryDC != nullptr)
+                DeleteDC(m_Native->MemoryDC);
+#else
+            if (m_Native->Gc != nullptr)
+                XFreeGC(m_Native->Dpy, m_Native->Gc);
+#endif
+            m_Native.reset();
+        }
+        m_Memory.clear();
+        m_Memory.shrink_to_fit();
+        m_Window = nullptr;
+    }
+
+    SoftwareFramebuffer SoftwarePresenter::Acquire(int width, int height)
+    {
+        if (width <= 0 || height <= 0)
+            return SoftwareFramebuffer();
+        if (width != m_Framebuffer.Width || height != m_Framebuffer.Height)
+        {
+            release();
+            if (!resize(width, height))
+            {
+                release();
+                return SoftwareFramebuffer();
+            }
+        }
+#ifdef _WIN32
+        // GDI may batch the last BitBlt, it must be done reading the bitmap before it is drawn into
+        if (m_Native)
+            GdiFlush();
+#endif
+        return m_Framebuffer;
+    }
+
+    void SoftwarePresenter::Present()
+    {
+        if (!m_Native || m_Framebuffer.Pixels == nullptr)
+            return;
+        Native &n = *m_Native;
+#ifdef _WIN32
+        HDC dc = GetDC(n.Window);
+        BitBlt(dc, 0, 0, m_Framebuffer.Width, m_Framebuffer.Height, n.MemoryDC, 0, 0, SRCCOPY);
+        ReleaseDC(n.Window, dc);
+#else
+        if (n.UseShm)
+        {
+            XShmPutImage(n.Dpy, n.Win, n.Gc, n.Image, 0, 0, 0, 0, m_Framebuffer.Width, m_Framebuffer.Height, False);
+            // The server reads the segment asynchronously, the next frame must not be rendered before it is done
+            XSync(n.Dpy, False);
+        }
+        else
+        {
+            XPutImage(n.Dpy, n.Win, n.Gc, n.Image, 0, 0, 0, 0, m_Framebuffer.Width, m_Framebuffer.Height);
+            XFlush(n.Dpy);
+        }
+#endif
+    }
+
+    const char *SoftwarePresenter::GetMethod() const
+    {
+        if (!m_Native)
+            return "memory";
+#ifdef _WIN32
+        return "GDI DIB section";
+#else
+        return m_Native->UseShm ? "X11 MIT-SHM" : "X11 XPutImage";
+#endif
+    }
+
+    bool SoftwarePresenter::resize(int width, int height)
+    {
+        if (!m_Native)
+        {
+            m_Memory.resize((size_t)width * height);
+            m_Framebuffer = {m_Memory.data(), width, height, width};
+            return true;
+        }
+        Native &n = *m_Native;
+#ifdef _WIN32
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(info.bmiHeader);
+        info.bmiHeader.biWidth = width;
+        info.bmiHeader.biHeight = -height; // Top-down
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+        void *bits = nullptr;
+        n.Bitmap = CreateDIBSection(n.MemoryDC, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+        if (n.Bitmap == nullptr)
+            return false;
+        n.OldBitmap = SelectObject(n.MemoryDC, n.Bitmap);
+        m_Framebuffer = {(uint32_t *)bits, width, height, width};
+        return true;
+#else
+        if (n.UseShm)
+        {
+            n.Image = XShmCreateImage(n.Dpy, n.Vis, n.Depth, ZPixmap, nullptr, &n.Shm, width, height);
+            if (n.Image != nullptr)
+            {
+                n.Shm.shmid = shmget(IPC_PRIVATE, (size_t)n.Image->bytes_per_line * height, IPC_CREAT | 0600);
+                n.Shm.shmaddr = n.Shm.shmid >= 0 ? (char *)shmat(n.Shm.shmid, nullptr, 0) : (char *)-1;
+                n.Shm.readOnly = False;
+                bool attached = false;
+                if (n.Shm.shmaddr != (char *)-1)
+                {
+                    s_ShmAttachFailed = false;
+                    XErrorHandler previous = XSetErrorHandler(ShmErrorHandler);
+                    attached = XShmAttach(n.Dpy, &n.Shm);
+                    XSync(n.Dpy, False);
+                    XSetErrorHandler(previous);
+                    attached = attached && !s_ShmAttachFailed;
+                }
+                // Removed once the last process detaches, so the segment does not outlive a crash
+                if (n.Shm.shmid >= 0)
+                    shmctl(n.Shm.shmid, IPC_RMID, nullptr);
+                if (attached)
+                {
+                    n.Image->data = n.Shm.shmaddr;
+                    m_Framebuffer = {(uint32_t *)n.Image->data, width, height, n.Image->bytes_per_line / 4};
+                    return true;
+                }
+                if (n.Shm.shmaddr != (char *)-1)
+                    shmdt(n.Shm.shmaddr);
+                XDestroyImage(n.Image);
+                n.Image = nullptr;
+            }
+            fprintf(stderr, "[software] MIT-SHM unavailable, sending frames over the X connection\n");
+            n.UseShm = false;
+        }
+        char *data = (char *)malloc((size_t)width * height * 4);
+        n.Image = data != nullptr ? XCreateImage(n.Dpy, n.Vis, n.Depth, ZPixmap, 0, data, width, height, 32, width * 4) : nullptr;
+        if (n.Image == nullptr)
+        {
+            free(data);
+            return false;
+        }
+        m_Framebuffer = {(uint32_t *)n.Image->data, width, height, width};
+        return true;
+#endif
+    }
+
+    void SoftwarePresenter::release()
+    {
+        if (m_Native)
+        {
+            Native &n = *m_Native;
+#ifdef _WIN32
+            if (n.Bitmap != nullptr)
+            {
+                SelectObject(n.MemoryDC, n.OldBitmap);
+                DeleteObject(n.Bitmap);
+                n.Bitmap = nullptr;
+            }
+#else
+            if (n.Image != nullptr)
+            {
+                if (n.UseShm)
+                {
+                    XShmDetach(n.Dpy, &n.Shm);
+                    XSync(n.Dpy, False);
+                    shmdt(n.Shm.shmaddr);
+                    n.Image->data = nullptr; // XDestroyImage would free() it
+                }
+                XDestroyImage(n.Image);
+                n.Image = nullptr;
+            }
+#endif
+        }
+        m_Framebuffer = SoftwareFramebuffer();
+    }
+}
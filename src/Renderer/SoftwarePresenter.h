@@ -0,0 +1,41 @@
+#pragma once
+#include "Renderer/SoftwareRasterizer.h"
+#include <memory>
+#include <vector>
+
+struct GLFWwindow;
+
+namespace Calculator
+{
+    // Shows software rendered frames in a GLFW window without any GPU API. The framebuffer is memory the window
+    // system reads directly: a DIB section blitted with GDI on Windows, an MIT-SHM image on X11, or a plain XImage
+    // sent over the connection when the X server is not local. Without a window it is plain memory, for headless runs.
+    class SoftwarePresenter
+    {
+    public:
+        SoftwarePresenter();
+        ~SoftwarePresenter();
+
+        bool Init(GLFWwindow *window);
+        void Shutdown();
+
+        // The framebuffer to render the next frame into, reallocated when the size changed. Null pixels on failure.
+        SoftwareFramebuffer Acquire(int width, int height);
+        const SoftwareFramebuffer &GetFramebuffer() const { return m_Framebuffer; }
+        // Copies the framebuffer to the window, it may be rendered into again once this returns
+        void Present();
+
+        const char *GetMethod() const;
+
+    private:
+        struct Native;
+
+        bool resize(int width, int height);
+        void release();
+
+        GLFWwindow *m_Window = nullptr;
+        std::unique_ptr<Native> m_Native;
+        std::vector<uint32_t> m_Memory; // Headless only
+        SoftwareFramebuffer m_Framebuffer;
+    };
+}
@@ -0,0 +1,458 @@
+#include "Renderer/SoftwareRasterizer.h"
+#include "Profiling/Trace.h"
+#include <algorithm>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Calculator
+{
+    static constexpr int SUBPIXELS = 16;
+    // Triangles with a vertex further out are dropped, which keeps every edge function step within 32 bits
+    static constexpr float GUARD_BAND = 8192.0f;
+    // Within a tile row an edge function changes by less than this, so clamping its value at the start of the row
+    // keeps the sign of every pixel in the row
+    static constexpr int64_t EDGE_CLAMP = (int64_t)1 << 29;
+
+    static inline uint32_t div255(uint32_t x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    static inline int64_t floorDiv(int64_t a, int64_t b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    static inline int32_t clampEdge(int64_t e)
+    {
+        return (int32_t)std::min(std::max(e, -EDGE_CLAMP), EDGE_CLAMP);
+    }
+
+    // ImGui colors are RGBA in memory, the framebuffer is BGRA
+    static inline uint32_t rgbaToBgra(uint32_t c)
+    {
+        return (c & 0xFF00FF00) | ((c & 0xFF) << 16) | ((c >> 16) & 0xFF);
+    }
+
+    static inline uint32_t modulate(uint32_t a, uint32_t b)
+    {
+        uint32_t out = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+            out |= div255(((a >> shift) & 0xFF) * ((b >> shift) & 0xFF)) << shift;
+        return out;
+    }
+
+    // Source over with ImGui's blend state: color by source alpha, alpha by one plus destination times (1 - alpha)
+    static inline uint32_t blend(uint32_t dst, uint32_t src)
+    {
+        uint32_t alpha = src >> 24;
+        uint32_t inv = 255 - alpha;
+        uint32_t b = div255((src & 0xFF) * alpha + (dst & 0xFF) * inv);
+        uint32_t g = div255(((src >> 8) & 0xFF) * alpha + ((dst >> 8) & 0xFF) * inv);
+        uint32_t r = div255(((src >> 16) & 0xFF) * alpha + ((dst >> 16) & 0xFF) * inv);
+        uint32_t a = div255(255 * alpha + (dst >> 24) * inv);
+        return b | g << 8 | r << 16 | a << 24;
+    }
+
+    static inline uint32_t sample(const SoftwareTexture *texture, float u, float v)
+    {
+        int x = std::min(std::max((int)u, 0), texture->Width - 1);
+        int y = std::min(std::max((int)v, 0), texture->Height - 1);
+        return texture->Pixels[(size_t)y * texture->Width + x];
+    }
+
+    void SoftwareTexture::SetRGBA32(const unsigned char *rgba, int width, int height)
+    {
+        Width = width;
+        Height = height;
+        Pixels.resize((size_t)width * height);
+        for (size_t i = 0; i < Pixels.size(); i++, rgba += 4)
+            Pixels[i] = (uint32_t)rgba[2] | (uint32_t)rgba[1] << 8 | (uint32_t)rgba[0] << 16 | (uint32_t)rgba[3] << 24;
+    }
+
+    void SoftwareRasterizer::Init(uint32_t threads)
+    {
+        Shutdown();
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        m_Stop = false;
+        for (uint32_t i = 1; i < threads; i++)
+            m_Workers.emplace_back([this]() { workerMain(); });
+    }
+
+    void SoftwareRasterizer::Shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Start.notify_all();
+        for (std::thread &worker : m_Workers)
+            worker.join();
+        m_Workers.clear();
+    }
+
+    void SoftwareRasterizer::workerMain()
+    {
+        TraceSetThreadName("Raster");
+        uint64_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Start.wait(lock, [this, seen]() { return m_Stop || m_Frame != seen; });
+                if (m_Stop)
+                    return;
+                seen = m_Frame;
+            }
+            runTiles();
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (--m_Busy == 0)
+                    m_Done.notify_one();
+            }
+        }
+    }
+
+    bool SoftwareRasterizer::setupTriangle(const ImDrawVert &v0, const ImDrawVert &v1, const ImDrawVert &v2, const ImVec2 &offset, const ImVec2 &scale,
+                                           const int clip[4], const SoftwareTexture *texture, Triangle &tri) const
+    {
+        const ImDrawVert *v[3] = {&v0, &v1, &v2};
+        int64_t x[3], y[3];
+        for (int i = 0; i < 3; i++)
+        {
+            float fx = (v[i]->pos.x - offset.x) * scale.x;
+            float fy = (v[i]->pos.y - offset.y) * scale.y;
+            if (!(fabsf(fx) < GUARD_BAND && fabsf(fy) < GUARD_BAND))
+                return false;
+            x[i] = (int64_t)lrintf(fx * SUBPIXELS);
+            y[i] = (int64_t)lrintf(fy * SUBPIXELS);
+        }
+        int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+        if (area == 0)
+            return false;
+        // ImGui emits both windings, turn every triangle the same way
+        if (area < 0)
+        {
+            std::swap(v[1], v[2]);
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+        }
+
+        // A pixel is covered when its center, at +8 subpixels, is
+        int64_t minX = std::min({x[0], x[1], x[2]}), maxX = std::max({x[0], x[1], x[2]});
+        int64_t minY = std::min({y[0], y[1], y[2]}), maxY = std::max({y[0], y[1], y[2]});
+        tri.MinX = (int)std::max<int64_t>(clip[0], floorDiv(minX - SUBPIXELS / 2 + SUBPIXELS - 1, SUBPIXELS));
+        tri.MinY = (int)std::max<int64_t>(clip[1], floorDiv(minY - SUBPIXELS / 2 + SUBPIXELS - 1, SUBPIXELS));
+        tri.MaxX = (int)std::min<int64_t>(clip[2], floorDiv(maxX - SUBPIXELS / 2, SUBPIXELS) + 1);
+        tri.MaxY = (int)std::min<int64_t>(clip[3], floorDiv(maxY - SUBPIXELS / 2, SUBPIXELS) + 1);
+        if (tri.MinX >= tri.MaxX || tri.MinY >= tri.MaxY)
+            return false;
+
+        for (int i = 0; i < 3; i++)
+        {
+            int j = (i + 1) % 3;
+            int64_t ex = x[j] - x[i];
+            int64_t ey = y[j] - y[i];
+            tri.A[i] = (int32_t)(-ey * SUBPIXELS);
+            tri.B[i] = (int32_t)(ex * SUBPIXELS);
+            tri.C[i] = ex * (SUBPIXELS / 2 - y[i]) - ey * (SUBPIXELS / 2 - x[i]);
+            // Top-left rule: a pixel center exactly on an edge belongs to the triangle only for top and left edges
+            bool topLeft = (ey == 0 && ex > 0) || ey < 0;
+            if (!topLeft)
+                tri.C[i] -= 1;
+        }
+
+        tri.Texture = texture;
+        tri.ColorVaries = v[0]->col != v[1]->col || v[0]->col != v[2]->col;
+        tri.UvVaries = texture != nullptr && (v[0]->uv.x != v[1]->uv.x || v[0]->uv.x != v[2]->uv.x ||
+                                              v[0]->uv.y != v[1]->uv.y || v[0]->uv.y != v[2]->uv.y);
+        tri.Color = rgbaToBgra(v[0]->col);
+        tri.Texel = texture != nullptr ? sample(texture, v[0]->uv.x * texture->Width, v[0]->uv.y * texture->Height) : 0xFFFFFFFF;
+        if (!tri.ColorVaries && !tri.UvVaries)
+        {
+            tri.Color = modulate(tri.Color, tri.Texel);
+            if ((tri.Color >> 24) == 0)
+                return false;
+        }
+
+        if (tri.ColorVaries || tri.UvVaries)
+        {
+            float fx[3], fy[3];
+            for (int i = 0; i < 3; i++)
+            {
+                fx[i] = (float)x[i] / SUBPIXELS;
+                fy[i] = (float)y[i] / SUBPIXELS;
+            }
+            float det = (fx[1] - fx[0]) * (fy[2] - fy[0]) - (fx[2] - fx[0]) * (fy[1] - fy[0]);
+            auto plane = [&](float a0, float a1, float a2, float out[3])
+            {
+                float dx = ((a1 - a0) * (fy[2] - fy[0]) - (a2 - a0) * (fy[1] - fy[0])) / det;
+                float dy = ((a2 - a0) * (fx[1] - fx[0]) - (a1 - a0) * (fx[2] - fx[0])) / det;
+                out[0] = a0 + dx * (0.5f - fx[0]) + dy * (0.5f - fy[0]);
+                out[1] = dx;
+                out[2] = dy;
+            };
+            if (tri.UvVaries)
+            {
+                float w = (float)texture->Width, h = (float)texture->Height;
+                plane(v[0]->uv.x * w, v[1]->uv.x * w, v[2]->uv.x * w, tri.U);
+                plane(v[0]->uv.y * h, v[1]->uv.y * h, v[2]->uv.y * h, tri.V);
+            }
+            if (tri.ColorVaries)
+            {
+                // In framebuffer order, B G R A
+                static const int SHIFTS[4] = {IM_COL32_B_SHIFT, IM_COL32_G_SHIFT, IM_COL32_R_SHIFT, IM_COL32_A_SHIFT};
+                for (int c = 0; c < 4; c++)
+                    plane((float)((v[0]->col >> SHIFTS[c]) & 0xFF), (float)((v[1]->col >> SHIFTS[c]) & 0xFF),
+                          (float)((v[2]->col >> SHIFTS[c]) & 0xFF), tri.Rgba[c]);
+            }
+        }
+        return true;
+    }
+
+    // Tiles the bounding box touches but an edge excludes entirely are skipped, which matters for long diagonal
+    // triangles like the anti-aliased fringe of a circle
+    void SoftwareRasterizer::binTriangle(uint32_t index)
+    {
+        const Triangle &tri = m_Triangles[index];
+        int tx0 = tri.MinX / TILE_SIZE, tx1 = (tri.MaxX - 1) / TILE_SIZE;
+        int ty0 = tri.MinY / TILE_SIZE, ty1 = (tri.MaxY - 1) / TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                bool outside = false;
+                if (tx0 != tx1 || ty0 != ty1)
+                {
+                    int64_t x0 = tx * TILE_SIZE, x1 = x0 + TILE_SIZE - 1;
+                    int64_t y0 = ty * TILE_SIZE, y1 = y0 + TILE_SIZE - 1;
+                    for (int i = 0; i < 3 && !outside; i++)
+                        outside = tri.A[i] * (tri.A[i] >= 0 ? x1 : x0) + tri.B[i] * (tri.B[i] >= 0 ? y1 : y0) + tri.C[i] < 0;
+                }
+                if (!outside)
+                {
+                    m_Bins[ty * m_TilesX + tx].push_back(index);
+                    m_Stats.TileRefs++;
+                }
+            }
+        }
+    }
+
+#ifdef SOFTWARE_RASTERIZER_SSE2
+    static inline __m128i div255x8(__m128i x)
+    {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    // Four pixels at once, src is the source color times its alpha per 16 bit channel and inv 255 - alpha
+    static inline __m128i blend4(__m128i dst, __m128i src, __m128i inv)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = div255x8(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), inv), src));
+        __m128i hi = div255x8(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), inv), src));
+        return _mm_packus_epi16(lo, hi);
+    }
+#endif
+
+    // Calls shade(x, dst) for every covered pixel of row y in [minX, maxX), e holds the edge values at minX
+    template <typename Shade>
+    static inline void fillSpan(uint32_t *row, int minX, int maxX, const int32_t e[3], const int32_t a[3], Shade &&shade)
+    {
+        int x = minX;
+#ifdef SOFTWARE_RASTERIZER_SSE2
+        __m128i e0 = _mm_add_epi32(_mm_set1_epi32(e[0]), _mm_setr_epi32(0, a[0], 2 * a[0], 3 * a[0]));
+        __m128i e1 = _mm_add_epi32(_mm_set1_epi32(e[1]), _mm_setr_epi32(0, a[1], 2 * a[1], 3 * a[1]));
+        __m128i e2 = _mm_add_epi32(_mm_set1_epi32(e[2]), _mm_setr_epi32(0, a[2], 2 * a[2], 3 * a[2]));
+        __m128i s0 = _mm_set1_epi32(4 * a[0]), s1 = _mm_set1_epi32(4 * a[1]), s2 = _mm_set1_epi32(4 * a[2]);
+        for (; x + 4 <= maxX; x += 4)
+        {
+            // Sign bit set where any edge is negative
+            int outside = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(e0, e1), e2)));
+            if (outside != 0xF)
+                for (int lane = 0; lane < 4; lane++)
+                    if ((outside & (1 << lane)) == 0)
+                        row[x + lane] = shade(x + lane, row[x + lane]);
+            e0 = _mm_add_epi32(e0, s0);
+            e1 = _mm_add_epi32(e1, s1);
+            e2 = _mm_add_epi32(e2, s2);
+        }
+#endif
+        for (; x < maxX; x++)
+        {
+            int32_t dx = x - minX;
+            if (((e[0] + a[0] * dx) | (e[1] + a[1] * dx) | (e[2] + a[2] * dx)) >= 0)
+                row[x] = shade(x, row[x]);
+        }
+    }
+
+    // Neither color nor texture varies: four pixels are blended at once, or stored when opaque
+    static inline void fillSpanSolid(uint32_t *row, int minX, int maxX, const int32_t e[3], const int32_t a[3], uint32_t color)
+    {
+        uint32_t alpha = color >> 24;
+        int x = minX;
+#ifdef SOFTWARE_RASTERIZER_SSE2
+        __m128i e0 = _mm_add_epi32(_mm_set1_epi32(e[0]), _mm_setr_epi32(0, a[0], 2 * a[0], 3 * a[0]));
+        __m128i e1 = _mm_add_epi32(_mm_set1_epi32(e[1]), _mm_setr_epi32(0, a[1], 2 * a[1], 3 * a[1]));
+        __m128i e2 = _mm_add_epi32(_mm_set1_epi32(e[2]), _mm_setr_epi32(0, a[2], 2 * a[2], 3 * a[2]));
+        __m128i s0 = _mm_set1_epi32(4 * a[0]), s1 = _mm_set1_epi32(4 * a[1]), s2 = _mm_set1_epi32(4 * a[2]);
+        __m128i opaque = _mm_set1_epi32((int)color);
+        __m128i src = _mm_setr_epi16((short)((color & 0xFF) * alpha), (short)(((color >> 8) & 0xFF) * alpha),
+                                     (short)(((color >> 16) & 0xFF) * alpha), (short)(255 * alpha),
+                                     (short)((color & 0xFF) * alpha), (short)(((color >> 8) & 0xFF) * alpha),
+                                     (short)(((color >> 16) & 0xFF) * alpha), (short)(255 * alpha));
+        __m128i inv = _mm_set1_epi16((short)(255 - alpha));
+        for (; x + 4 <= maxX; x += 4)
+        {
+            __m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), 31);
+            if (_mm_movemask_epi8(outside) != 0xFFFF)
+            {
+                __m128i *p = (__m128i *)(row + x);
+                __m128i dst = _mm_loadu_si128(p);
+                __m128i out = alpha == 255 ? opaque : blend4(dst, src, inv);
+                _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(outside, dst), _mm_andnot_si128(outside, out)));
+            }
+            e0 = _mm_add_epi32(e0, s0);
+            e1 = _mm_add_epi32(e1, s1);
+            e2 = _mm_add_epi32(e2, s2);
+        }
+#endif
+        for (; x < maxX; x++)
+        {
+            int32_t dx = x - minX;
+            if (((e[0] + a[0] * dx) | (e[1] + a[1] * dx) | (e[2] + a[2] * dx)) >= 0)
+                row[x] = alpha == 255 ? color : blend(row[x], color);
+        }
+    }
+
+    void SoftwareRasterizer::fillTile(uint32_t tile)
+    {
+        int x0 = (int)(tile % m_TilesX) * TILE_SIZE, y0 = (int)(tile / m_TilesX) * TILE_SIZE;
+        int x1 = std::min(x0 + TILE_SIZE, m_Target.Width), y1 = std::min(y0 + TILE_SIZE, m_Target.Height);
+        for (int y = y0; y < y1; y++)
+            std::fill(m_Target.Pixels + (size_t)y * m_Target.Stride + x0, m_Target.Pixels + (size_t)y * m_Target.Stride + x1, m_ClearColor);
+
+        for (uint32_t index : m_Bins[tile])
+        {
+            const Triangle &tri = m_Triangles[index];
+            int minX = std::max(tri.MinX, x0), maxX = std::min(tri.MaxX, x1);
+            int minY = std::max(tri.MinY, y0), maxY = std::min(tri.MaxY, y1);
+            for (int y = minY; y < maxY; y++)
+            {
+                uint32_t *row = m_Target.Pixels + (size_t)y * m_Target.Stride;
+                int32_t e[3];
+                for (int i = 0; i < 3; i++)
+                    e[i] = clampEdge((int64_t)tri.A[i] * minX + (int64_t)tri.B[i] * y + tri.C[i]);
+
+                if (!tri.ColorVaries && !tri.UvVaries)
+                {
+                    fillSpanSolid(row, minX, maxX, e, tri.A, tri.Color);
+                    continue;
+                }
+                float fy = (float)y;
+                fillSpan(row, minX, maxX, e, tri.A, [&tri, fy](int x, uint32_t dst)
+                         {
+                             float fx = (float)x;
+                             uint32_t color = tri.Color;
+                             if (tri.ColorVaries)
+                             {
+                                 color = 0;
+                                 for (int c = 0; c < 4; c++)
+                                 {
+                                     float value = tri.Rgba[c][0] + tri.Rgba[c][1] * fx + tri.Rgba[c][2] * fy;
+                                     color |= (uint32_t)std::min(std::max(value + 0.5f, 0.0f), 255.0f) << (c * 8);
+                                 }
+                             }
+                             uint32_t texel = tri.UvVaries ? sample(tri.Texture, tri.U[0] + tri.U[1] * fx + tri.U[2] * fy, tri.V[0] + tri.V[1] * fx + tri.V[2] * fy) : tri.Texel;
+                             return blend(dst, modulate(color, texel)); });
+            }
+        }
+    }
+
+    void SoftwareRasterizer::runTiles()
+    {
+        uint64_t start = TraceClockNow();
+        uint32_t count = (uint32_t)(m_TilesX * m_TilesY);
+        for (uint32_t tile = m_NextTile.fetch_add(1); tile < count; tile = m_NextTile.fetch_add(1))
+            fillTile(tile);
+        m_RasterNs.fetch_add(TraceClockNow() - start);
+    }
+
+    void SoftwareRasterizer::Render(ImDrawData *drawData, const SoftwareFramebuffer &target, uint32_t clearColor)
+    {
+        PROFILE_SCOPE("SoftwareRasterizer::Render");
+        uint64_t start = TraceClockNow();
+        m_Target = target;
+        m_ClearColor = clearColor;
+        m_TilesX = (target.Width + TILE_SIZE - 1) / TILE_SIZE;
+        m_TilesY = (target.Height + TILE_SIZE - 1) / TILE_SIZE;
+        size_t tiles = (size_t)m_TilesX * m_TilesY;
+        if (m_Bins.size() < tiles)
+            m_Bins.resize(tiles);
+        for (std::vector<uint32_t> &bin : m_Bins)
+            bin.clear();
+        m_Triangles.clear();
+        m_Stats = SoftwareRasterizerStats();
+        m_Stats.Tiles = (uint32_t)tiles;
+        m_Stats.Threads = (uint32_t)m_Workers.size() + 1;
+
+        for (int n = 0; drawData != nullptr && n < drawData->CmdListsCount; n++)
+        {
+            const ImDrawList *list = drawData->CmdLists[n];
+            for (const ImDrawCmd &cmd : list->CmdBuffer)
+            {
+                if (cmd.UserCallback != nullptr)
+                {
+                    if (cmd.UserCallback != ImDrawCallback_ResetRenderState)
+                        cmd.UserCallback(list, &cmd);
+                    continue;
+                }
+                // Truncated like the Vulkan backend's scissor
+                const ImVec2 offset = drawData->DisplayPos, scale = drawData->FramebufferScale;
+                int clip[4] = {
+                    std::max((int)((cmd.ClipRect.x - offset.x) * scale.x), 0),
+                    std::max((int)((cmd.ClipRect.y - offset.y) * scale.y), 0),
+                    std::min((int)((cmd.ClipRect.z - offset.x) * scale.x), target.Width),
+                    std::min((int)((cmd.ClipRect.w - offset.y) * scale.y), target.Height),
+                };
+                if (clip[2] <= clip[0] || clip[3] <= clip[1])
+                    continue;
+
+                const SoftwareTexture *texture = (const SoftwareTexture *)(intptr_t)cmd.GetTexID();
+                const ImDrawIdx *idx = list->IdxBuffer.Data + cmd.IdxOffset;
+                const ImDrawVert *vtx = list->VtxBuffer.Data + cmd.VtxOffset;
+                for (unsigned int i = 0; i + 2 < cmd.ElemCount; i += 3)
+                {
+                    m_Triangles.emplace_back();
+                    if (setupTriangle(vtx[idx[i]], vtx[idx[i + 1]], vtx[idx[i + 2]], offset, scale, clip, texture, m_Triangles.back()))
+                        binTriangle((uint32_t)m_Triangles.size() - 1);
+                    else
+                        m_Triangles.pop_back();
+                }
+            }
+        }
+        m_Stats.Triangles = (uint32_t)m_Triangles.size();
+        m_Stats.SetupMs = (float)((TraceClockNow() - start) / 1.0e6);
+
+        m_NextTile.store(0);
+        m_RasterNs.store(0);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Frame++;
+            m_Busy = (uint32_t)m_Workers.size();
+        }
+        m_Start.notify_all();
+        runTiles();
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Done.wait(lock, [this]() { return m_Busy == 0; });
+        }
+        m_Stats.RasterMs = (float)(m_RasterNs.load() / 1.0e6);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "imgui.h"
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Calculator
+{
+    // BGRA8 pixels, 0xAARRGGBB as a little endian uint32_t: the layout of a 32 bit DIB section and of a depth 24 X11
+    // TrueColor image, so a frame is presented without a conversion
+    struct SoftwareFramebuffer
+    {
+        uint32_t *Pixels = nullptr;
+        int Width = 0;
+        int Height = 0;
+        int Stride = 0; // In pixels
+    };
+
+    // Texture of the software renderer, its address is the ImTextureID
+    struct SoftwareTexture
+    {
+        std::vector<uint32_t> Pixels; // BGRA8
+        int Width = 0;
+        int Height = 0;
+
+        void SetRGBA32(const unsigned char *rgba, int width, int height);
+        ImTextureID GetTexID() const { return (ImTextureID)(intptr_t)this; }
+    };
+
+    struct SoftwareRasterizerStats
+    {
+        uint32_t Triangles = 0; // Left after clipping and culling
+        uint32_t TileRefs = 0;  // Triangles binned, counted once per tile they touch
+        uint32_t Tiles = 0;
+        uint32_t Threads = 0;
+        float SetupMs = 0.0f;  // Triangle setup and binning, on the calling thread
+        float RasterMs = 0.0f; // Clearing and filling the tiles, summed over every thread
+    };
+
+    // Renders ImDrawData on the CPU. Triangles are set up and binned into 64x64 pixel tiles on the calling thread, then
+    // the tiles are filled in parallel, each by one thread in submission order, so no two threads ever blend into the
+    // same pixel and the result does not depend on the thread count.
+    // Coverage uses 1/16 pixel fixed point edge functions with a top-left fill rule: triangles sharing an edge, like
+    // ImGui's anti-aliased fringes, never blend a pixel twice. Textures are sampled nearest, which matches the Vulkan
+    // backend's bilinear filter for the 1:1 font atlas the UI draws from. Four pixels are tested and blended at once with
+    // SSE2 when available.
+    class SoftwareRasterizer
+    {
+    public:
+        static constexpr int TILE_SIZE = 64;
+
+        ~SoftwareRasterizer() { Shutdown(); }
+
+        // threads includes the calling thread, 0 for one per hardware thread
+        void Init(uint32_t threads);
+        void Shutdown();
+
+        void Render(ImDrawData *drawData, const SoftwareFramebuffer &target, uint32_t clearColor);
+        const SoftwareRasterizerStats &GetStats() const { return m_Stats; }
+        uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+
+    private:
+        struct Triangle
+        {
+            // Edge i covers pixel (x, y) where A[i] * x + B[i] * y + C[i] >= 0, C is biased for the fill rule
+            int32_t A[3], B[3];
+            int64_t C[3];
+            int MinX, MinY, MaxX, MaxY; // Pixel bounds within the clip rect, max exclusive
+            // Planes value(x, y) = [0] + [1] * x + [2] * y at pixel centers
+            float U[3], V[3];   // In texels, when UvVaries
+            float Rgba[4][3];   // 0-255, when ColorVaries
+            uint32_t Color;     // BGRA, when !ColorVaries. Already multiplied by Texel when neither varies.
+            uint32_t Texel;     // BGRA, when !UvVaries
+            const SoftwareTexture *Texture;
+            bool ColorVaries;
+            bool UvVaries;
+        };
+
+        bool setupTriangle(const ImDrawVert &v0, const ImDrawVert &v1, const ImDrawVert &v2, const ImVec2 &offset, const ImVec2 &scale,
+                           const int clip[4], const SoftwareTexture *texture, Triangle &tri) const;
+        void binTriangle(uint32_t index);
+        void runTiles();
+        void fillTile(uint32_t tile);
+        void workerMain();
+
+        SoftwareFramebuffer m_Target;
+        uint32_t m_ClearColor = 0;
+        int m_TilesX = 0;
+        int m_TilesY = 0;
+        std::vector<Triangle> m_Triangles;
+        std::vector<std::vector<uint32_t>> m_Bins; // Triangle indices per tile, in submission order
+        std::atomic<uint32_t> m_NextTile{0};
+        std::atomic<uint64_t> m_RasterNs{0};
+        SoftwareRasterizerStats m_Stats;
+
+        std::vector<std::thread> m_Workers;
+        std::mutex m_Mutex;
+        std::condition_variable m_Start;
+        std::condition_variable m_Done;
+        uint64_t m_Frame = 0;
+        uint32_t m_Busy = 0; // Workers still filling tiles of the current frame
+        bool m_Stop = false;
+    };
+}
@@ -1,2 +1,263 @@
 #include "backends/imgui_impl_vulkan.cpp"
-#include "backends/imgui_impl_glfw.cpp"
\ No newline at end of file
+#include "backends/imgui_impl_glfw.cpp"
+
+#include "Renderer/DescriptorAllocator.h"
+#include "Renderer/SdfText.h"
+
+// Distance field variant of the backend's fragment shader, used with its vertex shader and pipeline layout
+/*
+#version 450 core
+layout(location = 0) out vec4 fColor;
+layout(set=0, binding=0) uniform sampler2D sTexture;
+layout(location = 0) in struct { vec4 Color; vec2 UV; } In;
+void main()
+{
+    float d = texture(sTexture, In.UV.st).a;
+    float w = max(fwidth(d), 1.0 / 512.0);
+    fColor = vec4(In.Color.rgb, In.Color.a * smoothstep(0.5 - w, 0.5 + w, d));
+}
+*/
+static uint32_t __glsl_shader_sdf_frag_spv[] =
+{
+    0x07230203, 0x00010000, 0x00000000, 0x00000028, 0x00000000, 0x00020011, 0x00000001, 0x0006000b,
+    0x00000001, 0x4c534c47, 0x6474732e, 0x3035342e, 0x00000000, 0x0003000e, 0x00000000, 0x00000001,
+    0x0007000f, 0x00000004, 0x00000002, 0x6e69616d, 0x00000000, 0x00000003, 0x00000004, 0x00030010,
+    0x00000002, 0x00000007, 0x00040047, 0x00000003, 0x0000001e, 0x00000000, 0x00040047, 0x00000004,
+    0x0000001e, 0x00000000, 0x00040047, 0x00000005, 0x00000022, 0x00000000, 0x00040047, 0x00000005,
+    0x00000021, 0x00000000, 0x00020013, 0x00000006, 0x00030021, 0x00000007, 0x00000006, 0x00030016,
+    0x00000008, 0x00000020, 0x00040017, 0x00000009, 0x00000008, 0x00000004, 0x00040017, 0x0000000a,
+    0x00000008, 0x00000002, 0x00040020, 0x0000000b, 0x00000003, 0x00000009, 0x0004003b, 0x0000000b,
+    0x00000003, 0x00000003, 0x0004001e, 0x0000000c, 0x00000009, 0x0000000a, 0x00040020, 0x0000000d,
+    0x00000001, 0x0000000c, 0x0004003b, 0x0000000d, 0x00000004, 0x00000001, 0x00040015, 0x0000000e,
+    0x00000020, 0x00000001, 0x0004002b, 0x0000000e, 0x0000000f, 0x00000000, 0x0004002b, 0x0000000e,
+    0x00000010, 0x00000001, 0x00040020, 0x00000011, 0x00000001, 0x00000009, 0x00040020, 0x00000012,
+    0x00000001, 0x0000000a, 0x00090019, 0x00000013, 0x00000008, 0x00000001, 0x00000000, 0x00000000,
+    0x00000000, 0x00000001, 0x00000000, 0x0003001b, 0x00000014, 0x00000013, 0x00040020, 0x00000015,
+    0x00000000, 0x00000014, 0x0004003b, 0x00000015, 0x00000005, 0x00000000, 0x0004002b, 0x00000008,
+    0x00000016, 0x3f000000, 0x0004002b, 0x00000008, 0x00000017, 0x3b000000, 0x00050036, 0x00000006,
+    0x00000002, 0x00000000, 0x00000007, 0x000200f8, 0x00000018, 0x00050041, 0x00000011, 0x00000019,
+    0x00000004, 0x0000000f, 0x0004003d, 0x00000009, 0x0000001a, 0x00000019, 0x00050041, 0x00000012,
+    0x0000001b, 0x00000004, 0x00000010, 0x0004003d, 0x0000000a, 0x0000001c, 0x0000001b, 0x0004003d,
+    0x00000014, 0x0000001d, 0x00000005, 0x00050057, 0x00000009, 0x0000001e, 0x0000001d, 0x0000001c,
+    0x00050051, 0x00000008, 0x0000001f, 0x0000001e, 0x00000003, 0x000400d1, 0x00000008, 0x00000020,
+    0x0000001f, 0x0007000c, 0x00000008, 0x00000021, 0x00000001, 0x00000028, 0x00000020, 0x00000017,
+    0x00050083, 0x00000008, 0x00000022, 0x00000016, 0x00000021, 0x00050081, 0x00000008, 0x00000023,
+    0x00000016, 0x00000021, 0x0008000c, 0x00000008, 0x00000024, 0x00000001, 0x00000031, 0x00000022,
+    0x00000023, 0x0000001f, 0x00050051, 0x00000008, 0x00000025, 0x0000001a, 0x00000003, 0x00050085,
+    0x00000008, 0x00000026, 0x00000025, 0x00000024, 0x00060052, 0x00000009, 0x00000027, 0x00000026,
+    0x0000001a, 0x00000003, 0x0003003e, 0x00000003, 0x00000027, 0x000100fd, 0x00010038
+};
+
+static VkShaderModule s_SdfShaderModule = VK_NULL_HANDLE;
+static VkPipeline s_SdfPipeline = VK_NULL_HANDLE;
+// Per thread: the main viewport may be recorded on the render thread while the main thread records platform windows
+static thread_local VkCommandBuffer s_SdfCommandBuffer = VK_NULL_HANDLE;
+
+static void ImGui_ImplVulkan_BindSdfPipeline(const ImDrawList *, const ImDrawCmd *)
+{
+    if (s_SdfCommandBuffer != VK_NULL_HANDLE)
+        vkCmdBindPipeline(s_SdfCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_SdfPipeline);
+}
+
+namespace Calculator
+{
+    bool CreateSdfTextPipeline(VkRenderPass renderPass)
+    {
+        ImGui_ImplVulkan_Data *bd = ImGui_ImplVulkan_GetBackendData();
+        IM_ASSERT(bd != nullptr && "Call after ImGui_ImplVulkan_Init");
+        ImGui_ImplVulkan_InitInfo *v = &bd->VulkanInitInfo;
+
+        VkShaderModuleCreateInfo module_info = {};
+        module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        module_info.codeSize = sizeof(__glsl_shader_sdf_frag_spv);
+        module_info.pCode = (uint32_t *)__glsl_shader_sdf_frag_spv;
+        if (vkCreateShaderModule(v->Device, &module_info, v->Allocator, &s_SdfShaderModule) != VK_SUCCESS)
+            return false;
+
+        VkPipelineShaderStageCreateInfo stage[2] = {};
+        stage[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stage[0].module = bd->ShaderModuleVert;
+        stage[0].pName = "main";
+        stage[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stage[1].module = s_SdfShaderModule;
+        stage[1].pName = "main";
+
+        // Everything below matches the backend's own pipeline
+        VkVertexInputBindingDescription binding_desc[1] = {};
+        binding_desc[0].stride = sizeof(ImDrawVert);
+        binding_desc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkVertexInputAttributeDescription attribute_desc[3] = {};
+        attribute_desc[0].location = 0;
+        attribute_desc[0].binding = binding_desc[0].binding;
+        attribute_desc[0].format = VK_FORMAT_R32G32_SFLOAT;
+        attribute_desc[0].offset = offsetof(ImDrawVert, pos);
+        attribute_desc[1].location = 1;
+        attribute_desc[1].binding = binding_desc[0].binding;
+        attribute_desc[1].format = VK_FORMAT_R32G32_SFLOAT;
+        attribute_desc[1].offset = offsetof(ImDrawVert, uv);
+        attribute_desc[2].location = 2;
+        attribute_desc[2].binding = binding_desc[0].binding;
+        attribute_desc[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+        attribute_desc[2].offset = offsetof(ImDrawVert, col);
+
+        VkPipelineVertexInputStateCreateInfo vertex_info = {};
+        vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertex_info.vertexBindingDescriptionCount = 1;
+        vertex_info.pVertexBindingDescriptions = binding_desc;
+        vertex_info.vertexAttributeDescriptionCount = 3;
+        vertex_info.pVertexAttributeDescriptions = attribute_desc;
+
+        VkPipelineInputAssemblyStateCreateInfo ia_info = {};
+        ia_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        ia_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+        VkPipelineViewportStateCreateInfo viewport_info = {};
+        viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewport_info.viewportCount = 1;
+        viewport_info.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo raster_info = {};
+        raster_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        raster_info.polygonMode = VK_POLYGON_MODE_FILL;
+        raster_info.cullMode = VK_CULL_MODE_NONE;
+        raster_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        raster_info.lineWidth = 1.0f;
+
+        VkPipelineMultisampleStateCreateInfo ms_info = {};
+        ms_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        ms_info.rasterizationSamples = (v->MSAASamples != 0) ? v->MSAASamples : VK_SAMPLE_COUNT_1_BIT;
+
+        VkPipelineColorBlendAttachmentState color_attachment[1] = {};
+        color_attachment[0].blendEnable = VK_TRUE;
+        color_attachment[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        color_attachment[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        color_attachment[0].colorBlendOp = VK_BLEND_OP_ADD;
+        color_attachment[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_attachment[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        color_attachment[0].alphaBlendOp = VK_BLEND_OP_ADD;
+        color_attachment[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+        VkPipelineDepthStencilStateCreateInfo depth_info = {};
+        depth_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+        VkPipelineColorBlendStateCreateInfo blend_info = {};
+        blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        blend_info.attachmentCount = 1;
+        blend_info.pAttachments = color_attachment;
+
+        VkDynamicState dynamic_states[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamic_state = {};
+        dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamic_state.dynamicStateCount = (uint32_t)IM_ARRAYSIZE(dynamic_states);
+        dynamic_state.pDynamicStates = dynamic_states;
+
+        VkGraphicsPipelineCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        info.stageCount = 2;
+        info.pStages = stage;
+        info.pVertexInputState = &vertex_info;
+        info.pInputAssemblyState = &ia_info;
+        info.pViewportState = &viewport_info;
+        info.pRasterizationState = &raster_info;
+        info.pMultisampleState = &ms_info;
+        info.pDepthStencilState = &depth_info;
+        info.pColorBlendState = &blend_info;
+        info.pDynamicState = &dynamic_state;
+        // Sharing the layout keeps the backend's descriptor set and push constants valid across the switch
+        info.layout = bd->PipelineLayout;
+        info.renderPass = renderPass;
+        info.subpass = v->Subpass;
+        if (vkCreateGraphicsPipelines(v->Device, v->PipelineCache, 1, &info, v->Allocator, &s_SdfPipeline) != VK_SUCCESS)
+        {
+            s_SdfPipeline = VK_NULL_HANDLE;
+            DestroySdfTextPipeline();
+            return false;
+        }
+        return true;
+    }
+
+    void DestroySdfTextPipeline()
+    {
+        ImGui_ImplVulkan_Data *bd = ImGui_ImplVulkan_GetBackendData();
+        ImGui_ImplVulkan_InitInfo *v = &bd->VulkanInitInfo;
+        if (s_SdfPipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(v->Device, s_SdfPipeline, v->Allocator);
+        if (s_SdfShaderModule != VK_NULL_HANDLE)
+            vkDestroyShaderModule(v->Device, s_SdfShaderModule, v->Allocator);
+        s_SdfPipeline = VK_NULL_HANDLE;
+        s_SdfShaderModule = VK_NULL_HANDLE;
+    }
+
+    bool IsSdfTextAvailable()
+    {
+        return s_SdfPipeline != VK_NULL_HANDLE;
+    }
+
+    void SetSdfTextCommandBuffer(VkCommandBuffer commandBuffer)
+    {
+        s_SdfCommandBuffer = commandBuffer;
+    }
+
+    void BeginSdfText(ImDrawList *drawList)
+    {
+        drawList->AddCallback(ImGui_ImplVulkan_BindSdfPipeline, nullptr);
+    }
+
+    void EndSdfText(ImDrawList *drawList)
+    {
+        drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+    }
+
+    VkDescriptorSet AddImGuiTexture(DescriptorAllocator &allocator, VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout)
+    {
+        ImGui_ImplVulkan_Data *bd = ImGui_ImplVulkan_GetBackendData();
+        ImGui_ImplVulkan_InitInfo *v = &bd->VulkanInitInfo;
+        VkDescriptorSet set = allocator.Allocate(bd->DescriptorSetLayout);
+        if (set == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+
+        VkDescriptorImageInfo desc_image[1] = {};
+        desc_image[0].sampler = sampler;
+        desc_image[0].imageView = imageView;
+        desc_image[0].imageLayout = imageLayout;
+        VkWriteDescriptorSet write_desc[1] = {};
+        write_desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_desc[0].dstSet = set;
+        write_desc[0].descriptorCount = 1;
+        write_desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write_desc[0].pImageInfo = desc_image;
+        vkUpdateDescriptorSets(v->Device, 1, write_desc, 0, nullptr);
+        return set;
+    }
+
+    void RemoveImGuiTexture(DescriptorAllocator &allocator, VkDescriptorSet set)
+    {
+        allocator.Free(set);
+    }
+
+    void AdoptImGuiFontsTexture(DescriptorAllocator &allocator)
+    {
+        ImGui_ImplVulkan_Data *bd = ImGui_ImplVulkan_GetBackendData();
+        if (bd->FontDescriptorSet == VK_NULL_HANDLE || allocator.Owns(bd->FontDescriptorSet))
+            return;
+        VkDescriptorSet set = AddImGuiTexture(allocator, bd->FontSampler, bd->FontView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        if (set == VK_NULL_HANDLE)
+            return;
+        ImGui_ImplVulkan_RemoveTexture(bd->FontDescriptorSet);
+        bd->FontDescriptorSet = set;
+        ImGui::GetIO().Fonts->SetTexID((ImTextureID)set);
+    }
+
+    void ReleaseImGuiFontsTexture(DescriptorAllocator &allocator)
+    {
+        ImGui_ImplVulkan_Data *bd = ImGui_ImplVulkan_GetBackendData();
+        if (bd == nullptr || !allocator.Owns(bd->FontDescriptorSet))
+            return;
+        RemoveImGuiTexture(allocator, bd->FontDescriptorSet);
+        bd->FontDescriptorSet = VK_NULL_HANDLE;
+        ImGui::GetIO().Fonts->SetTexID(0);
+    }
+}
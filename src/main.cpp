@@ -1,13 +1,182 @@
 #include "Application.h"
+#include "Calculator/ExpressionParser.h"
+#include "Calculator/ScreenSimulator.h"
+#include "Core/Files.h"
+#include "Renderer/FrameLog.h"
 #include "imgui.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
 
 void Calculator::Application::RenderLayer() {
+    // Input is applied before the grid is built, so it shows in this frame, the one LatencyTracker charges it to.
+    // It is hit tested against this frame's layout.
+    m_Calculator.Layout(ImGui::GetMainViewport()->Size);
+    m_Calculator.Update();
+    if (m_InputReplay.IsOpen()) {
+        // Live input would make the session diverge from the recording
+        m_InputQueue.Drain([](const InputEvent &) {});
+        if (!m_InputReplay.Step(m_Calculator))
+            m_Running = false;
+    } else {
+        m_InputQueue.Drain([this](const InputEvent &event) {
+            // Before the calculator takes a paste's text
+            if (m_InputLog.IsOpen())
+                m_InputLog.WriteEvent(event);
+            m_Calculator.OnInputEvent(event);
+            m_Latency.OnInputApplied(event.Timestamp);
+        });
+        if (m_InputLog.IsOpen())
+            m_InputLog.WriteFrame(m_Calculator.GetDisplayHash(), m_Calculator.IsEvaluating());
+    }
     m_Calculator.CreateGrid();
-    m_Calculator.HandleKeyboardInput();
 }
 
-int main() {
-    Calculator::Application *app = new Calculator::Application({400, 590, "Calculator"});
+static VkPresentModeKHR ParsePresentMode(const char *name) {
+    if (strcmp(name, "mailbox") == 0)
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    if (strcmp(name, "immediate") == 0)
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    if (strcmp(name, "fifo-relaxed") == 0)
+        return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+// Writes every frame of a log recorded with --record to <path>-<index>.ppm
+static int DecodeFrameLog(const char *path) {
+    Calculator::FrameLogReader reader;
+    if (!reader.Open(path)) {
+        fprintf(stderr, "[capture] %s is not a frame log\n", path);
+        return 1;
+    }
+    Calculator::FrameLogRecord record;
+    std::vector<uint8_t> pixels, ppm;
+    uint32_t frames = 0;
+    while (reader.Next(record, pixels)) {
+        bool bgra = record.Format == VK_FORMAT_B8G8R8A8_UNORM || record.Format == VK_FORMAT_B8G8R8A8_SRGB;
+        char header[64];
+        int header_size = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", record.Width, record.Height);
+        ppm.assign(header, header + header_size);
+        ppm.resize(header_size + (size_t)record.Width * record.Height * 3);
+        uint8_t *out = ppm.data() + header_size;
+        for (size_t i = 0; i < (size_t)record.Width * record.Height; i++, out += 3) {
+            out[0] = pixels[i * 4 + (bgra ? 2 : 0)];
+            out[1] = pixels[i * 4 + 1];
+            out[2] = pixels[i * 4 + (bgra ? 0 : 2)];
+        }
+        std::string name = std::string(path) + "-" + std::to_string(record.Index) + ".ppm";
+        if (!Calculator::WriteFileAtomic(name.c_str(), ppm.data(), ppm.size())) {
+            fprintf(stderr, "[capture] Could not write %s\n", name.c_str());
+            return 1;
+        }
+        frames++;
+    }
+    printf("[capture] %u frames decoded from %s\n", frames, path);
+    return 0;
+}
+
+// Steps the calculator screen through the headless input script, passes times, and checks where it ends up
+static int Simulate(const Calculator::ApplicationSpec &spec, uint32_t passes) {
+    Calculator::ScreenSimulator simulator(ImVec2((float)spec.Width, (float)spec.Height));
+    simulator.BuildTrace(spec.HeadlessInput);
+    Calculator::ScreenSimulator::Result result = simulator.Run(passes);
+    double seconds = std::max(result.Ms / 1000.0, 1e-9);
+    printf("[simulate] %u passes of \"%s\", %llu events in %.2f ms\n", passes, spec.HeadlessInput.c_str(),
+           (unsigned long long)result.Events, result.Ms);
+    printf("[simulate] %.2f M events/s, %.2f M keys/s\n", result.Events / seconds / 1e6, result.Keys / seconds / 1e6);
+
+    std::string expression, operand2;
+    Calculator::ScreenSimulator::Expected(spec.HeadlessInput, expression, operand2);
+    if (result.Expression != expression || result.Operand2 != operand2) {
+        fprintf(stderr, "[simulate] Ended with \"%s\" \"%s\", expected \"%s\" \"%s\"\n", result.Expression.c_str(),
+                result.Operand2.c_str(), expression.c_str(), operand2.c_str());
+        return 1;
+    }
+    printf("[simulate] final state \"%s\" \"%s\" as expected\n", result.Expression.c_str(), result.Operand2.c_str());
+    return 0;
+}
+
+// Streams a file through the paste parser, as if its text had been pasted, and prints the value and the costs
+static int ParseFile(const char *path) {
+    Calculator::MappedFile file;
+    if (!file.Open(path)) {
+        fprintf(stderr, "[paste] Could not open %s\n", path);
+        return 1;
+    }
+    Calculator::ExpressionParser parser;
+    Calculator::CancelToken cancel;
+    std::atomic<float> progress{0.0f};
+    if (!parser.Parse((const char *)file.Data(), file.Size(), cancel, progress)) {
+        parser.Report(stderr);
+        return 1;
+    }
+    std::string value = Calculator::CalculatorData::FormatResult(parser.Evaluate());
+    parser.Report(stdout);
+    printf("[paste] %s = %s\n", path, value.c_str());
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Calculator::ApplicationSpec spec = {400, 590, "Calculator"};
+    uint32_t simulatePasses = 0;
+    const char *parsePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--low-latency") == 0)
+            spec.LowLatency = true;
+        else if (strcmp(arg, "--latency") == 0)
+            spec.ReportLatency = true;
+        else if (strcmp(arg, "--profiler") == 0)
+            spec.ShowProfiler = true;
+        else if (strcmp(arg, "--startup-timing") == 0)
+            spec.StartupTiming = true;
+        else if (strncmp(arg, "--trace=", 8) == 0)
+            spec.TracePath = arg + 8;
+        else if (strncmp(arg, "--present-mode=", 15) == 0)
+            spec.PresentMode = ParsePresentMode(arg + 15);
+        else if (strncmp(arg, "--host-memory-limit=", 20) == 0)
+            spec.HostMemoryLimitMiB = (uint32_t)strtoul(arg + 20, nullptr, 10);
+        else if (strncmp(arg, "--frames-in-flight=", 19) == 0)
+            spec.FramesInFlight = (uint32_t)strtoul(arg + 19, nullptr, 10);
+        else if (strcmp(arg, "--render-thread") == 0)
+            spec.RenderThread = true;
+        else if (strncmp(arg, "--slow-present=", 15) == 0)
+            spec.SlowPresentMs = (uint32_t)strtoul(arg + 15, nullptr, 10);
+        else if (strncmp(arg, "--headless=", 11) == 0)
+            spec.HeadlessFrames = (uint32_t)strtoul(arg + 11, nullptr, 10);
+        else if (strncmp(arg, "--headless-input=", 17) == 0)
+            spec.HeadlessInput = arg + 17;
+        else if (strncmp(arg, "--capture=", 10) == 0)
+            spec.CapturePath = arg + 10;
+        else if (strncmp(arg, "--renderer=", 11) == 0)
+            spec.SoftwareRenderer = strcmp(arg + 11, "software") == 0;
+        else if (strncmp(arg, "--software-threads=", 19) == 0)
+            spec.SoftwareThreads = (uint32_t)strtoul(arg + 19, nullptr, 10);
+        else if (strncmp(arg, "--record=", 9) == 0)
+            spec.RecordPath = arg + 9;
+        else if (strncmp(arg, "--decode-frame-log=", 19) == 0)
+            return DecodeFrameLog(arg + 19);
+        else if (strncmp(arg, "--record-input=", 15) == 0)
+            spec.InputLogPath = arg + 15;
+        else if (strncmp(arg, "--replay=", 9) == 0)
+            spec.ReplayPath = arg + 9;
+        else if (strcmp(arg, "--replay-unthrottled") == 0)
+            spec.ReplayUnthrottled = true;
+        else if (strncmp(arg, "--simulate=", 11) == 0)
+            simulatePasses = (uint32_t)strtoul(arg + 11, nullptr, 10);
+        else if (strncmp(arg, "--parse=", 8) == 0)
+            parsePath = arg + 8;
+    }
+    if (simulatePasses > 0)
+        return Simulate(spec, simulatePasses);
+    if (parsePath != nullptr)
+        return ParseFile(parsePath);
+
+    Calculator::Application *app = new Calculator::Application(spec);
     app->Run();
+    delete app;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,213 @@
+// Builds assets.pak, the fonts and images the calculator loads at startup.
+//
+//   AssetPack --root <repository> -o <assets.pak> [--cpp <blob.cpp>] [--store]
+//
+// --cpp also writes the pack as a single array for builds with CALCULATOR_EMBED_ASSETS,
+// --store skips compression.
+#include <cstdint>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "imgui.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "Assets/AssetPack.h"
+#include "Assets/Lz4.h"
+#include "Core/Files.h"
+#include "Core/Hash.h"
+
+// The repository keeps its only copy of these as C arrays
+#include "../../misc/fonts/Droid.embed"
+#include "../../misc/fonts/Roboto-Medium.embed"
+#include "../../misc/fonts/Salsa.embed"
+#include "../../src/WindowImages.embed"
+
+using namespace Calculator;
+
+struct Asset
+{
+    std::string Name;
+    std::vector<uint8_t> Data;
+    AssetKind Kind = AssetKind::Raw;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+};
+
+// ImGui's stb_decompress is internal, but the atlas keeps the decompressed TTF as the font's data
+static Asset decompressFont(const char *name, const void *data, int size)
+{
+    ImFontAtlas atlas;
+    atlas.AddFontFromMemoryCompressedTTF(data, size, 16.0f);
+    const ImFontConfig &config = atlas.ConfigData.back();
+    Asset asset;
+    asset.Name = name;
+    asset.Data.assign((const uint8_t *)config.FontData, (const uint8_t *)config.FontData + config.FontDataSize);
+    return asset;
+}
+
+// Decoded here so the application gets RGBA pixels without a PNG decoder
+static bool decodeImage(Asset &asset, const char *name, const stbi_uc *data, int size)
+{
+    int width, height;
+    stbi_uc *pixels = stbi_load_from_memory(data, size, &width, &height, nullptr, 4);
+    if (pixels == nullptr)
+    {
+        fprintf(stderr, "AssetPack: could not decode %s: %s\n", name, stbi_failure_reason());
+        return false;
+    }
+    asset.Name = name;
+    asset.Data.assign(pixels, pixels + (size_t)width * height * 4);
+    asset.Kind = AssetKind::ImageRGBA8;
+    asset.Width = (uint32_t)width;
+    asset.Height = (uint32_t)height;
+    stbi_image_free(pixels);
+    return true;
+}
+
+static bool readFile(const std::filesystem::path &path, std::vector<uint8_t> &data)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        fprintf(stderr, "AssetPack: could not open %s\n", path.string().c_str());
+        return false;
+    }
+    data.assign(file.Data(), file.Data() + file.Size());
+    return true;
+}
+
+static std::vector<uint8_t> buildPack(const std::vector<Asset> &assets, bool compress)
+{
+    std::vector<uint8_t> pack(sizeof(AssetPackHeader));
+    std::vector<AssetPackEntry> entries;
+    for (const Asset &asset : assets)
+    {
+        pack.resize((pack.size() + 15) & ~(size_t)15);
+        AssetPackEntry entry = {};
+        snprintf(entry.Name, sizeof(entry.Name), "%s", asset.Name.c_str());
+        entry.Offset = pack.size();
+        entry.Size = asset.Data.size();
+        entry.Hash = HashBytes(asset.Data.data(), asset.Data.size());
+        entry.Kind = asset.Kind;
+        entry.Width = asset.Width;
+        entry.Height = asset.Height;
+
+        std::vector<uint8_t> compressed;
+        if (compress)
+        {
+            compressed.resize(Lz4CompressBound(asset.Data.size()));
+            compressed.resize(Lz4Compress(asset.Data.data(), asset.Data.size(), compressed.data(), compressed.size()));
+        }
+        // Not worth a decompression pass unless it saves at least an eighth
+        if (!compressed.empty() && compressed.size() < asset.Data.size() - asset.Data.size() / 8)
+        {
+            entry.Codec = AssetCodec::Lz4;
+            pack.insert(pack.end(), compressed.begin(), compressed.end());
+        }
+        else
+        {
+            entry.Codec = AssetCodec::None;
+            pack.insert(pack.end(), asset.Data.begin(), asset.Data.end());
+        }
+        entry.StoredSize = pack.size() - entry.Offset;
+        entries.push_back(entry);
+        printf("%-24s %8zu -> %8llu bytes%s\n", entry.Name, asset.Data.size(), (unsigned long long)entry.StoredSize,
+               entry.Codec == AssetCodec::Lz4 ? " (lz4)" : "");
+    }
+
+    pack.resize((pack.size() + 15) & ~(size_t)15);
+    AssetPackHeader header = {};
+    memcpy(header.Magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC));
+    header.Version = ASSET_PACK_VERSION;
+    header.EntryCount = (uint32_t)entries.size();
+    header.IndexOffset = pack.size();
+    pack.insert(pack.end(), (const uint8_t *)entries.data(), (const uint8_t *)(entries.data() + entries.size()));
+    memcpy(pack.data(), &header, sizeof(header));
+    return pack;
+}
+
+static bool writeOutput(const std::filesystem::path &path, const void *data, size_t size)
+{
+    std::error_code ec;
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), ec);
+    return WriteFileAtomic(path, data, size);
+}
+
+static bool writeBlobSource(const std::filesystem::path &path, const std::vector<uint8_t> &pack)
+{
+    std::string source = "// Generated by tools/AssetPack, do not edit\n#include <cstddef>\n\nnamespace Calculator\n{\n";
+    source += "    alignas(16) extern const unsigned char g_AssetPackBlob[] = {";
+    char byte[24];
+    for (size_t i = 0; i < pack.size(); i++)
+    {
+        snprintf(byte, sizeof(byte), "%s%u,", i % 32 == 0 ? "\n        " : "", pack[i]);
+        source += byte;
+    }
+    source += "\n    };\n    extern const size_t g_AssetPackBlobSize = sizeof(g_AssetPackBlob);\n}\n";
+    return writeOutput(path, source.data(), source.size());
+}
+
+int main(int argc, char **argv)
+{
+    std::filesystem::path root = ".", output, blobSource;
+    bool compress = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--root") == 0 && i + 1 < argc)
+            root = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--cpp") == 0 && i + 1 < argc)
+            blobSource = argv[++i];
+        else if (strcmp(argv[i], "--store") == 0)
+            compress = false;
+        else
+        {
+            fprintf(stderr, "usage: AssetPack --root <repository> -o <assets.pak> [--cpp <blob.cpp>] [--store]\n");
+            return 2;
+        }
+    }
+    if (output.empty() && blobSource.empty())
+    {
+        fprintf(stderr, "AssetPack: nothing to write, pass -o and/or --cpp\n");
+        return 2;
+    }
+
+    std::vector<Asset> assets;
+    assets.push_back(decompressFont("fonts/droid.ttf", Droid_compressed_data, (int)sizeof(Droid_compressed_data)));
+    assets.push_back(decompressFont("fonts/salsa.ttf", SalsaFont_compressed_data, (int)sizeof(SalsaFont_compressed_data)));
+    assets.push_back(decompressFont("fonts/roboto-medium.ttf", g_RobotoMedium_compressed_data, (int)sizeof(g_RobotoMedium_compressed_data)));
+
+    std::vector<uint8_t> png;
+    if (!readFile(root / "images" / "calc.png", png))
+        return 1;
+    const struct
+    {
+        const char *Name;
+        const uint8_t *Data;
+        size_t Size;
+    } images[] = {
+        {"icons/app", png.data(), png.size()},
+        {"icons/window-close", g_WindowCloseIcon, sizeof(g_WindowCloseIcon)},
+        {"icons/window-minimize", g_WindowMinimizeIcon, sizeof(g_WindowMinimizeIcon)},
+        {"icons/window-maximize", g_WindowMaximizeIcon, sizeof(g_WindowMaximizeIcon)},
+        {"icons/window-restore", g_WindowRestoreIcon, sizeof(g_WindowRestoreIcon)},
+    };
+    for (const auto &image : images)
+    {
+        Asset asset;
+        if (!decodeImage(asset, image.Name, image.Data, (int)image.Size))
+            return 1;
+        assets.push_back(std::move(asset));
+    }
+
+    std::vector<uint8_t> pack = buildPack(assets, compress);
+    if (!output.empty() && !writeOutput(output, pack.data(), pack.size()))
+        return 1;
+    if (!blobSource.empty() && !writeBlobSource(blobSource, pack))
+        return 1;
+    printf("%zu assets, %zu bytes\n", assets.size(), pack.size());
+    return 0;
+}
@@ -0,0 +1,34 @@
+project "AssetPack"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "off"
+	targetdir ("../../bin/")
+	objdir ("../../bin-int/%{prj.name}")
+
+	files
+	{
+		"AssetPack.cpp",
+		"../../src/Assets/Lz4.cpp",
+		"../../src/Core/Files.cpp",
+	}
+
+	includedirs
+	{
+		"../../src/",
+		"../../ext/imgui/",
+		"../../ext/stb",
+	}
+
+	links
+	{
+		"ImGui",
+	}
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"